@@ -0,0 +1,301 @@
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "datagenerator.h"
+#include "datatypes.h"
+#include "decisiontreeclassifier.h"
+#include "exceptions.h"
+#include "indexeddecisiontree.h"
+#include "table.h"
+#include "timing.h"
+
+using namespace balsa;
+
+namespace
+{
+class Options
+{
+public:
+
+    Options():
+    pointCount( 100000 ),
+    warmupCount( 1 ),
+    repetitionCount( 5 ),
+    jsonOutput( false )
+    {
+    }
+
+    static std::string getUsage()
+    {
+        std::stringstream ss;
+        ss << "Usage:" << std::endl
+           << std::endl
+           << "   balsa_bench [options]" << std::endl
+           << std::endl
+           << " Options:" << std::endl
+           << std::endl
+           << "   -p <points>      : Number of generated data points (default: 100000)." << std::endl
+           << "   -w <warmups>     : Number of untimed warmup runs per benchmark (default: 1)." << std::endl
+           << "   -r <repetitions> : Number of timed runs per benchmark (default: 5)." << std::endl
+           << "   -j               : Write the results as JSON instead of CSV." << std::endl
+           << std::endl
+           << "Benchmarks the hot training- and classification kernels in isolation, over a" << std::endl
+           << "deterministically generated dataset, and writes the per-benchmark timing" << std::endl
+           << "statistics (in seconds) to the standard output." << std::endl;
+        return ss.str();
+    }
+
+    static Options parseOptions( int argc, char ** argv )
+    {
+        // Put all arguments in a stringstream.
+        std::stringstream args;
+        for ( int i = 0; i < argc; ++i ) args << ' ' << argv[i];
+
+        // Discard the executable name.
+        std::string token;
+        args >> token;
+        token = "";
+
+        // Parse all flags.
+        Options options;
+        while ( args >> token )
+        {
+            // Stop if the token is not a flag.
+            assert( token.size() );
+            if ( token[0] != '-' ) break;
+
+            // Parse the flags.
+            if ( token == "-p" )
+            {
+                if ( !( args >> options.pointCount ) ) throw ParseError( "Missing parameter to -p option." );
+                if ( options.pointCount == 0 ) throw ParseError( "Invalid parameter to -p option (must be positive)." );
+            }
+            else if ( token == "-w" )
+            {
+                if ( !( args >> options.warmupCount ) ) throw ParseError( "Missing parameter to -w option." );
+            }
+            else if ( token == "-r" )
+            {
+                if ( !( args >> options.repetitionCount ) ) throw ParseError( "Missing parameter to -r option." );
+                if ( options.repetitionCount == 0 ) throw ParseError( "Invalid parameter to -r option (must be positive)." );
+            }
+            else if ( token == "-j" )
+            {
+                options.jsonOutput = true;
+            }
+            else
+            {
+                throw ParseError( std::string( "Unknown option: " ) + token );
+            }
+
+            // Clear the token, so a trailing flag is not mistaken for a
+            // positional argument when the stream runs out.
+            token = "";
+        }
+
+        // There are no positional arguments.
+        if ( token.size() ) throw ParseError( std::string( "Unexpected argument: " ) + token );
+
+        // Return results.
+        return options;
+    }
+
+    unsigned int pointCount;
+    unsigned int warmupCount;
+    unsigned int repetitionCount;
+    bool         jsonOutput;
+};
+
+/**
+ * The timing statistics of one benchmark.
+ */
+class BenchmarkResult
+{
+public:
+
+    BenchmarkResult( const std::string & name, const std::vector<StopWatch::Seconds> & times ):
+    m_name( name ),
+    m_repetitions( times.size() ),
+    m_minimum( times.front() ),
+    m_mean( 0 ),
+    m_maximum( times.front() )
+    {
+        for ( auto time : times )
+        {
+            m_minimum = std::min( m_minimum, time );
+            m_maximum = std::max( m_maximum, time );
+            m_mean += time;
+        }
+        m_mean /= times.size();
+    }
+
+    std::string        m_name;
+    std::size_t        m_repetitions;
+    StopWatch::Seconds m_minimum;
+    StopWatch::Seconds m_mean;
+    StopWatch::Seconds m_maximum;
+};
+
+/**
+ * Runs a benchmark body a number of untimed warmup runs, followed by a number
+ * of timed runs, and returns the times of the timed runs.
+ */
+template <typename Body>
+std::vector<StopWatch::Seconds> measure( unsigned int warmupCount, unsigned int repetitionCount, Body && body )
+{
+    // Run the untimed warmups.
+    for ( unsigned int i = 0; i < warmupCount; ++i ) body();
+
+    // Run and time the repetitions.
+    std::vector<StopWatch::Seconds> times;
+    times.reserve( repetitionCount );
+    StopWatch watch;
+    for ( unsigned int i = 0; i < repetitionCount; ++i )
+    {
+        watch.start();
+        body();
+        times.push_back( watch.stop() );
+    }
+    return times;
+}
+
+/**
+ * Writes the benchmark results to a stream in CSV form.
+ */
+void writeCSV( std::ostream & out, const std::vector<BenchmarkResult> & results )
+{
+    out << "benchmark,repetitions,min,mean,max" << std::endl;
+    for ( auto & result : results )
+        out << result.m_name << ',' << result.m_repetitions << ',' << result.m_minimum << ',' << result.m_mean << ',' << result.m_maximum << std::endl;
+}
+
+/**
+ * Writes the benchmark results to a stream in JSON form.
+ */
+void writeJSON( std::ostream & out, const std::vector<BenchmarkResult> & results )
+{
+    out << '[' << std::endl;
+    for ( std::size_t i = 0; i < results.size(); ++i )
+    {
+        auto & result = results[i];
+        out << "  {\"benchmark\": \"" << result.m_name << "\", \"repetitions\": " << result.m_repetitions
+            << ", \"min\": " << result.m_minimum << ", \"mean\": " << result.m_mean << ", \"max\": " << result.m_maximum << '}'
+            << ( i + 1 < results.size() ? "," : "" ) << std::endl;
+    }
+    out << ']' << std::endl;
+}
+
+} // namespace
+
+int main( int argc, char ** argv )
+{
+    try
+    {
+        // Parse the command-line options.
+        auto options = Options::parseOptions( argc, argv );
+
+        // Construct a deterministic multi-source model with a 2-D checkerboard.
+        typedef double                                   FeatureType;
+        typedef Table<FeatureType>::ConstIterator        FeatureIterator;
+        typedef Table<Label>::ConstIterator              LabelIterator;
+        CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+        black->addDimension( 16, 1.0 );
+        black->addDimension( 32, 0.75 );
+        CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+        white->addDimension( 16, 1.0 );
+        white->addDimension( 32, 0.75 );
+        SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+        blackSource->addFeatureGenerator( black );
+        SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+        whiteSource->addFeatureGenerator( white );
+        MultiSourceGenerator<FeatureType> generator( 0, 2 );
+        generator.addSource( 1, blackSource );
+        generator.addSource( 1, whiteSource );
+
+        // Generate a data- and label set.
+        Table<FeatureType> points( 2 );
+        Table<Label>       truth( 1 );
+        generator.generate( options.pointCount, points, truth );
+        const unsigned int featureCount = points.getColumnCount();
+        const unsigned int pointCount   = points.getRowCount();
+
+        // Collect the results of all benchmarks.
+        std::vector<BenchmarkResult> results;
+        const unsigned int           warmups     = options.warmupCount;
+        const unsigned int           repetitions = options.repetitionCount;
+
+        // Benchmark the construction of a sapling, which builds the sorted
+        // per-feature point index used during training.
+        results.push_back( BenchmarkResult( "index-construction", measure( warmups, repetitions, [&]()
+            { IndexedDecisionTree<FeatureIterator, LabelIterator> sapling( points.begin(), truth.begin(), featureCount, pointCount, featureCount ); } ) ) );
+
+        // Benchmark the growth of a full tree from a pre-built sapling. Growth
+        // is dominated by the split-scanning kernel (findBestSplitForFeature),
+        // which is not separately callable, so it is exercised through here.
+        IndexedDecisionTree<FeatureIterator, LabelIterator> sapling( points.begin(), truth.begin(), featureCount, pointCount, featureCount );
+        const std::vector<unsigned int>                     multiplicities( pointCount, 1 );
+        results.push_back( BenchmarkResult( "tree-growth", measure( warmups, repetitions, [&]()
+            {
+                IndexedDecisionTree<FeatureIterator, LabelIterator> tree( sapling, multiplicities );
+                tree.seed( 0 );
+                tree.grow();
+            } ) ) );
+
+        // Benchmark bulk-classification against a fully grown tree.
+        IndexedDecisionTree<FeatureIterator, LabelIterator> grownTree( sapling, multiplicities );
+        grownTree.seed( 0 );
+        grownTree.grow();
+        auto      classifier = grownTree.getDecisionTree();
+        VoteTable votes( pointCount, classifier->getClassCount() );
+        results.push_back( BenchmarkResult( "classify-and-vote", measure( warmups, repetitions, [&]()
+            { classifier->classifyAndVote( points.begin(), points.end(), votes ); } ) ) );
+
+        // Benchmark reading cell data with on-the-fly type conversion.
+        std::stringstream cellData;
+        Table<float>      narrowPoints( pointCount, featureCount );
+        std::copy( points.begin(), points.end(), narrowPoints.begin() );
+        narrowPoints.writeCellData( cellData );
+        Table<FeatureType> conversionTarget( pointCount, featureCount );
+        results.push_back( BenchmarkResult( "read-cell-data-as", measure( warmups, repetitions, [&]()
+            {
+                cellData.clear();
+                cellData.seekg( 0 );
+                conversionTarget.readCellDataAs<float>( cellData );
+            } ) ) );
+
+        // Benchmark parsing the dataset from CSV text.
+        std::stringstream csvBuilder;
+        for ( unsigned int row = 0; row < pointCount; ++row )
+        {
+            for ( unsigned int col = 0; col < featureCount; ++col )
+            {
+                if ( col ) csvBuilder << ',';
+                csvBuilder << points( row, col );
+            }
+            csvBuilder << '\n';
+        }
+        const std::string csvText = csvBuilder.str();
+        results.push_back( BenchmarkResult( "parse-csv", measure( warmups, repetitions, [&]()
+            {
+                std::stringstream csv( csvText );
+                parseCSV<FeatureType>( csv );
+            } ) ) );
+
+        // Write the results.
+        if ( options.jsonOutput )
+            writeJSON( std::cout, results );
+        else
+            writeCSV( std::cout, results );
+    }
+    catch ( Exception & e )
+    {
+        std::cerr << e.getMessage() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Finish.
+    return EXIT_SUCCESS;
+}
@@ -2,13 +2,17 @@
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "config.h"
 #include "datatypes.h"
 #include "exceptions.h"
+#include "messagequeue.h"
+#include "performancereport.h"
 #include "randomforestclassifier.h"
 #include "table.h"
 #include "timing.h"
@@ -23,7 +27,14 @@ public:
 
     Options():
     threadCount( 1 ),
-    maxPreload( 1 )
+    maxPreload( 1 ),
+    chunkRows( 0 ),
+    memoryMap( false ),
+    dataParallel( false ),
+    voteCounterBits( 32 ),
+    earlyStoppingInterval( 0 ),
+    writeProbabilities( false ),
+    serveMode( false )
     {
     }
 
@@ -38,7 +49,33 @@ public:
            << std::endl
            << "   -t <thread count>   : Number of threads (default: 1)." << std::endl
            << "   -p <preload count>  : Number of trees to preload (default: 1)." << std::endl
+           << "   -b <chunk rows>     : Classify in chunks of the given number of rows, keeping" << std::endl
+           << "                         memory usage bounded (default: 0, load whole files)." << std::endl
+           << "   -m                  : Memory-map the model file instead of loading it." << std::endl
+           << "   -dp                 : Parallelize over the data points instead of over the" << std::endl
+           << "                         trees, avoiding per-thread vote tables. Recommended" << std::endl
+           << "                         when there are many more points than trees." << std::endl
+           << "   -vw <bits>          : Width of the vote counters: 8, 16 or 32 (default: 32)." << std::endl
+           << "                         Narrower counters shrink the vote tables; the tree" << std::endl
+           << "                         count of the model must fit the chosen width." << std::endl
+           << "   -es <interval>      : Check every <interval> trees whether points are already" << std::endl
+           << "                         decided, and stop voting on those that are. The labels" << std::endl
+           << "                         are identical to those of a full evaluation. Takes" << std::endl
+           << "                         effect with -t 1 and -p 0 only (default: 0, off)." << std::endl
+           << "   -prob               : Also write the fraction of votes each class received," << std::endl
+           << "                         as a float table, to <input>-probabilities.balsa. The" << std::endl
+           << "                         fractions come out of the same pass as the labels." << std::endl
+           << "   -serve              : Run as a persistent classification server. The model is" << std::endl
+           << "                         loaded once, after which requests of the form" << std::endl
+           << "                         '<datapoint file> [<output file>]' are read from" << std::endl
+           << "                         standard input, one per line, and answered with a" << std::endl
+           << "                         'DONE <output file>' line on standard output. This" << std::endl
+           << "                         amortizes the model load over many small requests," << std::endl
+           << "                         e.g. when driven through a pipe by another process." << std::endl
+           << "                         Unless -p is given, the entire model is kept resident." << std::endl
            << "   -cw <label> <weight>: Sets class weight (see below). (default: 1)." << std::endl
+           << "   -perf <file>        : Writes a JSON performance report of the run (per-stage" << std::endl
+           << "                         timers and counters) to the given file." << std::endl
            << std::endl
            << "The class/label for each point is determined by counting the votes of a set of" << std::endl
            << "independently trained, randomized decision trees. The user can provide a class" << std::endl
@@ -61,6 +98,7 @@ public:
 
         // Parse all flags.
         Options options;
+        bool    preloadSpecified = false;
 
         while ( args >> token )
         {
@@ -76,6 +114,40 @@ public:
             else if ( token == "-p" )
             {
                 if ( !( args >> options.maxPreload ) ) throw ParseError( "Missing parameter to -p option." );
+                preloadSpecified = true;
+            }
+            else if ( token == "-b" )
+            {
+                if ( !( args >> options.chunkRows ) ) throw ParseError( "Missing parameter to -b option." );
+            }
+            else if ( token == "-m" )
+            {
+                options.memoryMap = true;
+            }
+            else if ( token == "-dp" )
+            {
+                options.dataParallel = true;
+            }
+            else if ( token == "-vw" )
+            {
+                if ( !( args >> options.voteCounterBits ) ) throw ParseError( "Missing parameter to -vw option." );
+                if ( options.voteCounterBits != 8 && options.voteCounterBits != 16 && options.voteCounterBits != 32 ) throw ParseError( "Invalid parameter to -vw option (must be 8, 16 or 32)." );
+            }
+            else if ( token == "-es" )
+            {
+                if ( !( args >> options.earlyStoppingInterval ) ) throw ParseError( "Missing parameter to -es option." );
+            }
+            else if ( token == "-prob" )
+            {
+                options.writeProbabilities = true;
+            }
+            else if ( token == "-serve" )
+            {
+                options.serveMode = true;
+            }
+            else if ( token == "-perf" )
+            {
+                if ( !( args >> options.performanceReportFile ) ) throw ParseError( "Missing parameter to -perf option." );
             }
             else if ( token == "-cw" )
             {
@@ -103,7 +175,12 @@ public:
             if ( !path.has_filename() ) throw ParseError( "Input path has no filename." );
             options.dataFiles.push_back( fileName );
         }
-        if ( options.dataFiles.size() == 0 ) throw ParseError( "No input files." );
+        if ( options.dataFiles.size() == 0 && !options.serveMode ) throw ParseError( "No input files." );
+        if ( options.dataFiles.size() != 0 && options.serveMode ) throw ParseError( "In server mode, input files are read from standard input." );
+
+        // In server mode, keep the entire model resident unless the user asked
+        // for a specific preload count.
+        if ( options.serveMode && !preloadSpecified ) options.maxPreload = 0;
 
         // Return  results.
         return options;
@@ -113,10 +190,18 @@ public:
     std::vector<std::string>                     dataFiles;
     unsigned int                                 threadCount;
     unsigned int                                 maxPreload;
+    unsigned int                                 chunkRows;
+    bool                                         memoryMap;
+    bool                                         dataParallel;
+    unsigned int                                 voteCounterBits;
+    unsigned int                                 earlyStoppingInterval;
+    bool                                         writeProbabilities;
+    bool                                         serveMode;
+    std::string                                  performanceReportFile;
     std::vector<std::tuple<unsigned int, float>> m_classWeights;
 };
 
-std::string createOutputFileName( const std::string & inputFilePath )
+std::string createOutputFileName( const std::string & inputFilePath, const std::string & suffix = "-predictions" )
 {
     // Extract the base name and the extensions.
     auto path = std::filesystem::path( inputFilePath );
@@ -124,10 +209,269 @@ std::string createOutputFileName( const std::string & inputFilePath )
     // Create the output file name.
     auto extension = path.extension();
     if ( extension != ".balsa" ) extension += ".balsa";
-    std::string outFile = path.stem().string() + "-predictions" + extension.string();
+    std::string outFile = path.stem().string() + suffix + extension.string();
     return outFile;
 }
 
+/**
+ * Load, classify and store a single datapoint file, adding the time spent in
+ * each stage to the running totals. If no output file name is given, it is
+ * derived from the input file name.
+ */
+void classifyDataFile( RandomForestClassifier & classifier, const Options & options, const std::string & dataFile, const std::string & outputFile, StopWatch::Seconds & dataLoadTime, StopWatch::Seconds & classificationTime, StopWatch::Seconds & labelStoreTime )
+{
+    // Determine the output file names.
+    const std::string labelFile       = outputFile.empty() ? createOutputFileName( dataFile ) : outputFile;
+    const std::string probabilityFile = createOutputFileName( outputFile.empty() ? dataFile : outputFile, "-probabilities" );
+
+    // Classify the file in fixed-size chunks of rows, if requested.
+    if ( options.chunkRows > 0 )
+    {
+        // Open the data file and read the table dimensions.
+        StopWatch watch;
+        watch.start();
+        BalsaFileParser dataParser( dataFile );
+        TableHeader     header = dataParser.enterTable();
+        if ( !options.serveMode ) std::cout << "Streaming dataset: " << header.columnCount << " features x " << header.rowCount << " points." << std::endl;
+        dataLoadTime += watch.getElapsedTime();
+
+        if ( header.columnCount != classifier.getFeatureCount() )
+            throw ClientError( "Feature count mismatch: data has "
+                + std::to_string( header.columnCount ) + " features, model expects "
+                + std::to_string( classifier.getFeatureCount() ) + "." );
+
+        // Open the output file and start the label table.
+        BalsaFileWriter fileWriter( labelFile, "balsa_classify", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
+        fileWriter.startTable<Label>( header.rowCount, 1 );
+
+        // Open the probability output file, if requested.
+        std::unique_ptr<BalsaFileWriter> probabilityWriter;
+        if ( options.writeProbabilities )
+        {
+            probabilityWriter.reset( new BalsaFileWriter( probabilityFile, "balsa_classify", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH ) );
+            probabilityWriter->startTable<float>( header.rowCount, classifier.getClassCount() );
+        }
+
+        // Read, classify and store the data one chunk of rows at a time. The
+        // session reuses the vote table across the equally sized chunks.
+        ClassificationSession session;
+        while ( true )
+        {
+            // Read a chunk of rows.
+            watch.start();
+            auto chunk = dataParser.parseTableRowsAs<double>( options.chunkRows );
+            watch.stop();
+            dataLoadTime += watch.getElapsedTime();
+            if ( chunk.getRowCount() == 0 ) break;
+
+            // Classify the chunk.
+            watch.start();
+            Table<Label> labels( chunk.getRowCount(), 1 );
+            Table<float> probabilities( options.writeProbabilities ? chunk.getRowCount() : 0, classifier.getClassCount() );
+            if ( options.writeProbabilities )
+                classifier.classify( chunk.begin(), chunk.end(), labels.begin(), probabilities, session );
+            else
+                classifier.classify( chunk.begin(), chunk.end(), labels.begin(), session );
+            watch.stop();
+            classificationTime += watch.getElapsedTime();
+
+            // Append the labels and probabilities to the output tables.
+            watch.start();
+            fileWriter.writeTableRows( labels );
+            if ( probabilityWriter ) probabilityWriter->writeTableRows( probabilities );
+            watch.stop();
+            labelStoreTime += watch.getElapsedTime();
+        }
+
+        // Finalize the input- and output tables.
+        watch.start();
+        dataParser.leaveTable();
+        fileWriter.finishTable();
+        if ( probabilityWriter ) probabilityWriter->finishTable();
+        watch.stop();
+        labelStoreTime += watch.getElapsedTime();
+        return;
+    }
+
+    // Load the data.
+    StopWatch watch;
+    if ( !options.serveMode ) std::cout << "Ingesting data..." << std::endl;
+    watch.start();
+    auto dataSet = readTableAs<double>( dataFile );
+    if ( !options.serveMode ) std::cout << "Dataset loaded: " << dataSet.getColumnCount() << " features x " << dataSet.getRowCount() << " points." << std::endl;
+    dataLoadTime += watch.getElapsedTime();
+
+    if ( dataSet.getColumnCount() != classifier.getFeatureCount() )
+        throw ClientError( "Feature count mismatch: data has "
+            + std::to_string( dataSet.getColumnCount() ) + " features, model expects "
+            + std::to_string( classifier.getFeatureCount() ) + "." );
+
+    // Classify the data.
+    watch.start();
+    Table<Label> labels( dataSet.getRowCount(), 1 );
+    Table<float> probabilities( options.writeProbabilities ? dataSet.getRowCount() : 0, classifier.getClassCount() );
+    if ( options.writeProbabilities )
+        classifier.classify( dataSet.begin(), dataSet.end(), labels.begin(), probabilities );
+    else
+        classifier.classify( dataSet.begin(), dataSet.end(), labels.begin() );
+    watch.stop();
+    classificationTime += watch.getElapsedTime();
+
+    // Store the labels and probabilities.
+    watch.start();
+    BalsaFileWriter fileWriter( labelFile, "balsa_classify", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
+    fileWriter.writeTable( labels );
+    if ( options.writeProbabilities )
+    {
+        BalsaFileWriter probabilityWriter( probabilityFile, "balsa_classify", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
+        probabilityWriter.writeTable( probabilities );
+    }
+    watch.stop();
+    labelStoreTime += watch.getElapsedTime();
+}
+
+/**
+ * A loaded dataset travelling from the reader stage to the classification
+ * stage of the batch pipeline.
+ */
+struct PipelineDataset
+{
+    typedef std::shared_ptr<PipelineDataset> SharedPointer;
+
+    std::string        dataFile;
+    Table<double>      dataSet;
+    StopWatch::Seconds loadTime;
+};
+
+/**
+ * A classification result travelling from the classification stage to the
+ * writer stage of the batch pipeline.
+ */
+struct PipelineResult
+{
+    typedef std::shared_ptr<PipelineResult> SharedPointer;
+
+    std::string  dataFile;
+    Table<Label> labels;
+    Table<float> probabilities;
+};
+
+/**
+ * Classify a batch of datapoint files through a three-stage pipeline: a reader
+ * thread loads the next file while the calling thread classifies the current
+ * one and a writer thread stores the labels of the previous one, so that disk
+ * I/O overlaps with classification. The output files are identical to those of
+ * the sequential path.
+ */
+void classifyBatchPipelined( RandomForestClassifier & classifier, const Options & options, StopWatch::Seconds & dataLoadTime, StopWatch::Seconds & classificationTime, StopWatch::Seconds & labelStoreTime )
+{
+    // Let the reader run at most two files ahead of the classifier, and the
+    // classifier at most two files ahead of the writer, to bound memory usage.
+    BoundedMessageQueue<PipelineDataset::SharedPointer> loadedDatasets( 2 );
+    BoundedMessageQueue<PipelineResult::SharedPointer>  classifiedDatasets( 2 );
+
+    // Reader stage: load the files in order, followed by an end-of-batch marker.
+    std::exception_ptr readerError;
+    std::thread        reader(
+        [&]()
+        {
+            try
+            {
+                for ( auto & dataFile : options.dataFiles )
+                {
+                    StopWatch watch;
+                    watch.start();
+                    PipelineDataset::SharedPointer dataset( new PipelineDataset() );
+                    dataset->dataFile = dataFile;
+                    dataset->dataSet  = readTableAs<double>( dataFile );
+                    dataset->loadTime = watch.getElapsedTime();
+                    loadedDatasets.send( dataset );
+                }
+            }
+            catch ( ... )
+            {
+                readerError = std::current_exception();
+            }
+            loadedDatasets.send( nullptr );
+        } );
+
+    // Writer stage: store the labels in order, until the end-of-batch marker.
+    // On failure, keep draining the queue so the classification stage can
+    // finish instead of blocking on a full queue.
+    std::exception_ptr writerError;
+    std::thread        writer(
+        [&]()
+        {
+            while ( auto result = classifiedDatasets.receive() )
+            {
+                if ( writerError ) continue;
+                try
+                {
+                    StopWatch watch;
+                    watch.start();
+                    BalsaFileWriter fileWriter( createOutputFileName( result->dataFile ), "balsa_classify", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
+                    fileWriter.writeTable( result->labels );
+                    if ( options.writeProbabilities )
+                    {
+                        BalsaFileWriter probabilityWriter( createOutputFileName( result->dataFile, "-probabilities" ), "balsa_classify", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
+                        probabilityWriter.writeTable( result->probabilities );
+                    }
+                    watch.stop();
+                    labelStoreTime += watch.getElapsedTime();
+                }
+                catch ( ... )
+                {
+                    writerError = std::current_exception();
+                }
+            }
+        } );
+
+    // Classification stage: classify each dataset as it comes in.
+    std::exception_ptr classifierError;
+    while ( auto dataset = loadedDatasets.receive() )
+    {
+        dataLoadTime += dataset->loadTime;
+        if ( classifierError ) continue;
+        try
+        {
+            if ( dataset->dataSet.getColumnCount() != classifier.getFeatureCount() )
+                throw ClientError( "Feature count mismatch: data has "
+                    + std::to_string( dataset->dataSet.getColumnCount() ) + " features, model expects "
+                    + std::to_string( classifier.getFeatureCount() ) + "." );
+
+            StopWatch watch;
+            watch.start();
+            PipelineResult::SharedPointer result( new PipelineResult() );
+            result->dataFile = dataset->dataFile;
+            result->labels   = Table<Label>( dataset->dataSet.getRowCount(), 1 );
+            if ( options.writeProbabilities )
+            {
+                result->probabilities = Table<float>( dataset->dataSet.getRowCount(), classifier.getClassCount() );
+                classifier.classify( dataset->dataSet.begin(), dataset->dataSet.end(), result->labels.begin(), result->probabilities );
+            }
+            else
+            {
+                classifier.classify( dataset->dataSet.begin(), dataset->dataSet.end(), result->labels.begin() );
+            }
+            watch.stop();
+            classificationTime += watch.getElapsedTime();
+            classifiedDatasets.send( result );
+        }
+        catch ( ... )
+        {
+            classifierError = std::current_exception();
+        }
+    }
+
+    // Shut down the pipeline and report the first failure, if any.
+    classifiedDatasets.send( nullptr );
+    reader.join();
+    writer.join();
+    if ( readerError ) std::rethrow_exception( readerError );
+    if ( classifierError ) std::rethrow_exception( classifierError );
+    if ( writerError ) std::rethrow_exception( writerError );
+}
+
 } // namespace
 
 int main( int argc, char ** argv )
@@ -143,11 +487,16 @@ int main( int argc, char ** argv )
         for ( auto & f : options.dataFiles ) std::cout << ' ' << f << std::endl;
         std::cout << "Threads    : " << options.threadCount << std::endl;
         std::cout << "Preload    : " << options.maxPreload << std::endl;
+        std::cout << "Chunk Rows : " << options.chunkRows << std::endl;
         std::cout << std::endl;
         assert( options.threadCount > 0 );
 
         // Create a random forest classifier.
-        RandomForestClassifier classifier( options.modelFile, options.threadCount - 1, options.maxPreload );
+        RandomForestClassifier classifier( options.modelFile, options.threadCount - 1, options.maxPreload, options.memoryMap );
+        if ( options.dataParallel ) classifier.setParallelizationMode( ParallelizationMode::DATA_PARALLEL );
+        if ( options.voteCounterBits == 8 ) classifier.setVoteCounterWidth( VoteCounterWidth::BITS_8 );
+        if ( options.voteCounterBits == 16 ) classifier.setVoteCounterWidth( VoteCounterWidth::BITS_16 );
+        classifier.setEarlyStoppingInterval( options.earlyStoppingInterval );
 
         // Override the class weights.
         std::vector<float> weights( classifier.getClassCount(), 1.0 );
@@ -165,40 +514,76 @@ int main( int argc, char ** argv )
         StopWatch::Seconds dataLoadTime       = 0;
         StopWatch::Seconds classificationTime = 0;
         StopWatch::Seconds labelStoreTime     = 0;
-        for ( auto & dataFile : options.dataFiles )
-        {
-            // Load the data.
-            StopWatch watch;
-            std::cout << "Ingesting data..." << std::endl;
-            watch.start();
-            auto dataSet = readTableAs<double>( dataFile );
-            std::cout << "Dataset loaded: " << dataSet.getColumnCount() << " features x " << dataSet.getRowCount() << " points." << std::endl;
-            dataLoadTime += watch.getElapsedTime();
+        // Multi-file batches without row chunking go through the pipelined
+        // path, which overlaps file I/O with classification.
+        if ( options.dataFiles.size() > 1 && options.chunkRows == 0 )
+            classifyBatchPipelined( classifier, options, dataLoadTime, classificationTime, labelStoreTime );
+        else
+            for ( auto & dataFile : options.dataFiles )
+                classifyDataFile( classifier, options, dataFile, std::string(), dataLoadTime, classificationTime, labelStoreTime );
 
-            if ( dataSet.getColumnCount() != classifier.getFeatureCount() )
-                throw ClientError( "Feature count mismatch: data has "
-                    + std::to_string( dataSet.getColumnCount() ) + " features, model expects "
-                    + std::to_string( classifier.getFeatureCount() ) + "." );
-
-            // Classify the data.
-            watch.start();
-            Table<Label> labels( dataSet.getRowCount(), 1 );
-            classifier.classify( dataSet.begin(), dataSet.end(), labels.begin() );
-            watch.stop();
-            classificationTime += watch.getElapsedTime();
+        // In server mode, answer classification requests from standard input
+        // until end-of-file. The model stays loaded and the worker threads stay
+        // warm between requests.
+        if ( options.serveMode )
+        {
+            std::cout << "READY" << std::endl;
+            std::string line;
+            while ( std::getline( std::cin, line ) )
+            {
+                // Parse the request: an input file name, with an optional output file name.
+                std::stringstream request( line );
+                std::string       dataFile, outputFile;
+                request >> dataFile >> outputFile;
+                if ( dataFile.empty() ) continue;
 
-            // Store the labels.
-            watch.start();
-            BalsaFileWriter fileWriter( createOutputFileName( dataFile ), "balsa_classify", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
-            fileWriter.writeTable( labels );
-            watch.stop();
-            labelStoreTime += watch.getElapsedTime();
+                // Classify, reporting failures without exiting, so that one bad
+                // request does not take the server down.
+                try
+                {
+                    classifyDataFile( classifier, options, dataFile, outputFile, dataLoadTime, classificationTime, labelStoreTime );
+                    std::cout << "DONE " << ( outputFile.empty() ? createOutputFileName( dataFile ) : outputFile ) << std::endl;
+                }
+                catch ( Exception & e )
+                {
+                    std::cout << "ERROR " << e.getMessage() << std::endl;
+                }
+                catch ( std::exception & e )
+                {
+                    // I/O errors on the data file surface as standard exceptions.
+                    std::cout << "ERROR " << e.what() << std::endl;
+                }
+            }
         }
 
         std::cout << "Timings:" << std::endl
                   << "Data Load Time: " << dataLoadTime << std::endl
                   << "Classification Time: " << classificationTime << std::endl
                   << "Label Store Time: " << labelStoreTime << std::endl;
+
+        // Write the performance report, if requested.
+        if ( !options.performanceReportFile.empty() )
+        {
+            PerformanceReport report;
+            report.add( "tool", "data-load-time", dataLoadTime );
+            report.add( "tool", "classification-time", classificationTime );
+            report.add( "tool", "label-store-time", labelStoreTime );
+
+            auto & classifierStatistics = classifier.getStatistics();
+            report.add( "classifier", "classifiers-applied", classifierStatistics.m_classifiersApplied );
+            report.add( "classifier", "worker-busy-time", classifierStatistics.m_workerBusyTime );
+            report.add( "classifier", "worker-idle-time", classifierStatistics.m_workerIdleTime );
+            report.add( "classifier", "vote-reduction-time", classifierStatistics.m_voteReductionTime );
+
+            auto streamStatistics = classifier.getClassifierStream().getStatistics();
+            report.add( "model-stream", "classifiers-parsed", streamStatistics.m_classifiersParsed );
+            report.add( "model-stream", "bytes-read", streamStatistics.m_bytesRead );
+            report.add( "model-stream", "parse-time", streamStatistics.m_parseTime );
+            report.add( "model-stream", "wait-time", streamStatistics.m_waitTime );
+
+            std::ofstream out( options.performanceReportFile );
+            report.writeJSON( out );
+        }
     }
     catch ( Exception & e )
     {
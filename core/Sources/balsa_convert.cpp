@@ -1,11 +1,11 @@
 #include <cassert>
-#include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
 #include <string>
 
 #include "config.h"
+#include "csvparser.h"
 #include "datatypes.h"
 #include "exceptions.h"
 #include "fileio.h"
@@ -19,7 +19,9 @@ class Options
 {
 public:
 
-    Options()
+    Options():
+    threadCount( 1 ),
+    precision( "double" )
     {
     }
 
@@ -28,9 +30,17 @@ public:
         std::stringstream ss;
         ss << "Usage:" << std::endl
            << std::endl
-           << "   balsa_convert <csv file> <output file>" << std::endl
+           << "   balsa_convert [options] <csv file> <output file>" << std::endl
            << std::endl
-           << "Converts comma separated values (CSV) to double precision Balsa input files.";
+           << " Options:" << std::endl
+           << std::endl
+           << "   -t <thread count>: Number of threads used to parse the file (default: 1)." << std::endl
+           << "   -p <precision>   : Floating point precision of the output file, one of" << std::endl
+           << "                      'half', 'single' or 'double' (default: double). Half" << std::endl
+           << "                      precision files are converted back to single precision" << std::endl
+           << "                      when they are loaded by the other tools." << std::endl
+           << std::endl
+           << "Converts comma separated values (CSV) to floating point Balsa input files.";
         return ss.str();
     }
 
@@ -52,7 +62,25 @@ public:
             // Stop if the token is not a flag.
             assert( token.size() );
             if ( token[0] != '-' ) break;
-            throw ParseError( std::string( "Unknown option: " ) + token );
+
+            // Parse the '-t <threadcount>' option.
+            if ( token == "-t" )
+            {
+                if ( !( args >> options.threadCount ) ) throw ParseError( "Missing parameter to -t option." );
+                if ( options.threadCount == 0 ) throw ParseError( "Thread count must be positive." );
+            }
+
+            // Parse the '-p <precision>' option.
+            else if ( token == "-p" )
+            {
+                if ( !( args >> options.precision ) ) throw ParseError( "Missing parameter to -p option." );
+                if ( options.precision != "half" && options.precision != "single" && options.precision != "double" )
+                    throw ParseError( "Precision must be 'half', 'single', or 'double'." );
+            }
+            else
+            {
+                throw ParseError( std::string( "Unknown option: " ) + token );
+            }
         }
 
         // Parse the filenames.
@@ -66,10 +94,24 @@ public:
         return options;
     }
 
-    std::string csvFile;
-    std::string outputFile;
+    std::string  csvFile;
+    std::string  outputFile;
+    unsigned int threadCount;
+    std::string  precision;
 };
 
+/**
+ * Converts a parsed table to the specified scalar type, element by element.
+ */
+template <typename ScalarType>
+Table<ScalarType> convertTable( const Table<double> & table )
+{
+    Table<ScalarType> result( table.getRowCount(), table.getColumnCount() );
+    auto              out = result.begin();
+    for ( auto value : table ) *out++ = static_cast<ScalarType>( value );
+    return result;
+}
+
 } // namespace
 
 int main( int argc, char ** argv )
@@ -80,13 +122,16 @@ int main( int argc, char ** argv )
         auto options = Options::parseOptions( argc, argv );
 
         // Parse the input file.
-        std::ifstream in;
-        in.open( options.csvFile );
-        auto table = parseCSV<double>( in );
+        auto table = parseCSVFile<double>( options.csvFile, options.threadCount );
 
-        // Write the output file.
+        // Write the output file at the requested precision.
         BalsaFileWriter fileWriter( options.outputFile, "balsa_convert", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
-        fileWriter.writeTable( table );
+        if ( options.precision == "half" )
+            fileWriter.writeTable( convertTable<Float16>( table ) );
+        else if ( options.precision == "single" )
+            fileWriter.writeTable( convertTable<float>( table ) );
+        else
+            fileWriter.writeTable( table );
     }
     catch ( Exception & e )
     {
@@ -4,9 +4,9 @@
 #include <sstream>
 #include <string>
 
+#include "classifierfilestream.h"
 #include "exceptions.h"
 #include "modelevaluation.h"
-#include "randomforestclassifier.h"
 #include "table.h"
 
 using namespace balsa;
@@ -103,12 +103,13 @@ int main( int argc, char ** argv )
         auto dataSet = readTableAs<double>( options.dataFile );
         auto labels  = readTableAs<Label>( options.labelFile );
 
-        // Create a classifier for the model.
-        RandomForestClassifier classifier( options.modelFile, options.threadCount - 1, options.maxPreload );
+        // Open the model file as a classifier stream. The trees are loaded
+        // into memory once and shared by the importance threads.
+        ClassifierFileInputStream classifierStream( options.modelFile, options.maxPreload );
 
         // Calculate the feature importance and print them.
         std::cout << "Analyzing feature importance..." << std::endl;
-        FeatureImportances importances( classifier, dataSet.begin(), dataSet.end(), labels.begin(), dataSet.getColumnCount(), options.repeatCount );
+        FeatureImportances importances( classifierStream, dataSet.begin(), dataSet.end(), labels.begin(), dataSet.getColumnCount(), options.repeatCount, options.threadCount );
         std::cout << "Done." << std::endl;
         std::cout << importances;
     }
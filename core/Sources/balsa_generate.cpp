@@ -1,8 +1,15 @@
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
 #include <iostream>
+#include <mutex>
 #include <random>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "config.h"
 #include "datagenerator.h"
@@ -21,7 +28,9 @@ public:
 
     Options():
     seed( 0 ),
-    pointCount( 1000 )
+    pointCount( 1000 ),
+    threadCount( 1 ),
+    chunkSize( 1048576 )
     {
     }
 
@@ -35,7 +44,9 @@ public:
            << " Options:" << std::endl
            << std::endl
            << "   -p <points> : Number of points to generate (default: 1000)." << std::endl
-           << "   -s <seed>   : Random seed for data generation (default: 0)." << std::endl;
+           << "   -s <seed>   : Random seed for data generation (default: 0)." << std::endl
+           << "   -t <threads>: Number of generator threads (default: 1)." << std::endl
+           << "   -c <points> : Number of points generated per chunk (default: 1048576)." << std::endl;
         return ss.str();
     }
 
@@ -67,6 +78,16 @@ public:
             {
                 if ( !( args >> options.pointCount ) ) throw ParseError( "Missing parameter to -p option." );
             }
+            else if ( token == "-t" )
+            {
+                if ( !( args >> options.threadCount ) ) throw ParseError( "Missing parameter to -t option." );
+                if ( options.threadCount < 1 ) throw ParseError( "Thread count must be positive." );
+            }
+            else if ( token == "-c" )
+            {
+                if ( !( args >> options.chunkSize ) ) throw ParseError( "Missing parameter to -c option." );
+                if ( options.chunkSize < 1 ) throw ParseError( "Chunk size must be positive." );
+            }
             else
             {
                 throw ParseError( std::string( "Unknown option: " ) + token );
@@ -89,8 +110,97 @@ public:
     unsigned int seed;
     unsigned int featureCount;
     unsigned int pointCount;
+    unsigned int threadCount;
+    unsigned int chunkSize;
 };
 
+/**
+ * Generate the dataset with a single generator, writing it out one chunk at a
+ * time. The output is identical to that of a single, whole-dataset generation
+ * pass, but the memory usage is bounded by the chunk size.
+ */
+void generateSequential( const Options & options, DataGenerator<double> & generator, BalsaFileWriter & pointWriter, BalsaFileWriter & labelWriter )
+{
+    Table<double> points( 1 );
+    Table<Label>  labels( 1 );
+    for ( std::size_t firstPoint = 0; firstPoint < options.pointCount; firstPoint += options.chunkSize )
+    {
+        const unsigned int count = std::min<std::size_t>( options.chunkSize, options.pointCount - firstPoint );
+        generator.generate( count, points, labels );
+        pointWriter.writeTableRows( points );
+        labelWriter.writeTableRows( labels );
+    }
+}
+
+/**
+ * Generate the dataset with multiple threads, writing the chunks out in order.
+ *
+ * Each chunk is generated with its own seed, drawn from a seed sequence that
+ * is derived from the master seed, so the output is deterministic for a given
+ * seed, point count and chunk size, regardless of the thread count. Every
+ * thread parses its own generator instance from the configuration, and
+ * reseeds it for each chunk it claims. At most one generated chunk per thread
+ * is held in memory.
+ */
+void generateParallel( const Options & options, const std::string & configuration, BalsaFileWriter & pointWriter, BalsaFileWriter & labelWriter )
+{
+    // Derive an independent seed for each chunk from the master seed.
+    const unsigned int         chunkCount = ( options.pointCount + options.chunkSize - 1 ) / options.chunkSize;
+    std::seed_seq              masterSequence{ options.seed };
+    std::vector<std::uint32_t> chunkSeeds( chunkCount );
+    masterSequence.generate( chunkSeeds.begin(), chunkSeeds.end() );
+
+    // Let the threads claim and generate chunks, and write them out in order.
+    std::atomic<unsigned int> nextChunk( 0 );
+    unsigned int              writeTurn = 0;
+    std::mutex                mutex;
+    std::condition_variable   turnChanged;
+    std::exception_ptr        writeError;
+    std::vector<std::thread>  threads;
+    for ( unsigned int i = 0; i < options.threadCount; ++i )
+    {
+        threads.push_back( std::thread(
+            [&]()
+            {
+                // Parse a private generator instance for this thread.
+                std::istringstream   configStream( configuration );
+                auto                 generator = parseDataGenerator<double>( configStream );
+                Table<double>        points( 1 );
+                Table<Label>         labels( 1 );
+                for ( unsigned int chunk = nextChunk++; chunk < chunkCount; chunk = nextChunk++ )
+                {
+                    // Generate the chunk with its own seed.
+                    generator->seed( chunkSeeds[chunk] );
+                    const std::size_t  firstPoint = static_cast<std::size_t>( chunk ) * options.chunkSize;
+                    const unsigned int count      = std::min<std::size_t>( options.chunkSize, options.pointCount - firstPoint );
+                    generator->generate( count, points, labels );
+
+                    // Wait until it is this chunk's turn to be written.
+                    std::unique_lock<std::mutex> lock( mutex );
+                    while ( writeTurn != chunk && !writeError ) turnChanged.wait( lock );
+                    if ( writeError ) return;
+
+                    // Write the chunk. On failure, record the error and wake
+                    // the other threads, which would otherwise wait forever
+                    // for their turn.
+                    try
+                    {
+                        pointWriter.writeTableRows( points );
+                        labelWriter.writeTableRows( labels );
+                    }
+                    catch ( ... )
+                    {
+                        writeError = std::current_exception();
+                    }
+                    ++writeTurn;
+                    turnChanged.notify_all();
+                }
+            } ) );
+    }
+    for ( auto & thread : threads ) thread.join();
+    if ( writeError ) std::rethrow_exception( writeError );
+}
+
 } // namespace
 
 int main( int argc, char ** argv )
@@ -100,25 +210,27 @@ int main( int argc, char ** argv )
         // Parse the command-line options.
         auto options = Options::parseOptions( argc, argv );
 
-        // Construct a data generator from the configuration file.
+        // Read the generator configuration into memory, so each worker thread
+        // can parse its own generator instance.
         std::ifstream in;
         in.open( options.datagenFile );
-        auto gen = parseDataGenerator<double>( in, options.seed );
-
-        // Generate a data- and label set.
-        Table<double> points( 1 );
-        Table<Label>  labels( 1 );
-        gen->generate( options.pointCount, points, labels );
-
-        // Write the output files.
-        {
-            BalsaFileWriter fileWriter( options.pointFile, "balsa_generate", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
-            fileWriter.writeTable( points );
-        }
-        {
-            BalsaFileWriter fileWriter( options.labelFile, "balsa_generate", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
-            fileWriter.writeTable( labels );
-        }
+        std::stringstream configuration;
+        configuration << in.rdbuf();
+
+        // Construct a data generator from the configuration.
+        auto gen = parseDataGenerator<double>( configuration, options.seed );
+
+        // Open the output files, and generate and write the dataset in chunks.
+        BalsaFileWriter pointWriter( options.pointFile, "balsa_generate", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
+        BalsaFileWriter labelWriter( options.labelFile, "balsa_generate", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
+        pointWriter.startTable<double>( options.pointCount, gen->getFeatureCount() );
+        labelWriter.startTable<Label>( options.pointCount, 1 );
+        if ( options.threadCount == 1 )
+            generateSequential( options, *gen, pointWriter, labelWriter );
+        else
+            generateParallel( options, configuration.str(), pointWriter, labelWriter );
+        pointWriter.finishTable();
+        labelWriter.finishTable();
     }
     catch ( Exception & e )
     {
@@ -19,7 +19,9 @@ class Options
 {
 public:
 
-    Options()
+    Options():
+    threadCount( 1 ),
+    chunkRows( 0 )
     {
     }
 
@@ -28,7 +30,14 @@ public:
         std::stringstream ss;
         ss << "Usage:" << std::endl
            << std::endl
-           << "   balsa_measure <ground_truth_labels> <classifier_labels>" << std::endl;
+           << "   balsa_measure [options] <ground_truth_labels> <classifier_labels>" << std::endl
+           << std::endl
+           << " Options:" << std::endl
+           << std::endl
+           << "   -t <thread count>   : Number of threads (default: 1)." << std::endl
+           << "   -b <chunk rows>     : Evaluate in chunks of the given number of rows," << std::endl
+           << "                         keeping memory usage bounded regardless of the" << std::endl
+           << "                         input size (default: off)." << std::endl;
         return ss.str();
     }
 
@@ -50,7 +59,23 @@ public:
             // Stop if the token is not a flag.
             assert( token.size() );
             if ( token[0] != '-' ) break;
-            throw ParseError( std::string( "Unknown option: " ) + token );
+
+            // Parse the '-t <threadcount>' option.
+            if ( token == "-t" )
+            {
+                if ( !( args >> options.threadCount ) ) throw ParseError( "Missing parameter to -t option." );
+            }
+
+            // Parse the '-b <chunk rows>' option.
+            else if ( token == "-b" )
+            {
+                if ( !( args >> options.chunkRows ) ) throw ParseError( "Missing parameter to -b option." );
+                if ( options.chunkRows < 1 ) throw ParseError( "Chunk size must be positive." );
+            }
+            else
+            {
+                throw ParseError( std::string( "Unknown option: " ) + token );
+            }
         }
 
         // Parse the filenames.
@@ -64,8 +89,10 @@ public:
         return options;
     }
 
-    std::string groundTruthLabelsFile;
-    std::string classifierLabelsFile;
+    std::string  groundTruthLabelsFile;
+    std::string  classifierLabelsFile;
+    unsigned int threadCount;
+    unsigned int chunkRows;
 };
 
 } // namespace
@@ -77,6 +104,52 @@ int main( int argc, char ** argv )
         // Parse the command-line options.
         auto options = Options::parseOptions( argc, argv );
 
+        // Evaluate the label files in fixed-size chunks of rows, if requested.
+        if ( options.chunkRows > 0 )
+        {
+            // Determine the number of classes in a first streaming pass over
+            // both label files, keeping only one chunk in memory at a time.
+            Label       highestClass = 0;
+            std::size_t rowCounts[2] = { 0, 0 };
+            for ( unsigned int file = 0; file < 2; ++file )
+            {
+                BalsaFileParser parser( file == 0 ? options.groundTruthLabelsFile : options.classifierLabelsFile );
+                TableHeader     header = parser.enterTable();
+                if ( header.columnCount != 1 ) throw ParseError( "Unexpected number of columns." );
+                rowCounts[file] = header.rowCount;
+                while ( true )
+                {
+                    auto chunk = parser.parseTableRowsAs<Label>( options.chunkRows );
+                    if ( chunk.getRowCount() == 0 ) break;
+                    for ( auto l : chunk ) highestClass = std::max( highestClass, l );
+                }
+                parser.leaveTable();
+            }
+            if ( rowCounts[0] != rowCounts[1] ) throw ParseError( "The input files have a different number of points." );
+
+            // Accumulate the confusion matrix from aligned chunks of both
+            // files in a second pass, and derive the statistics.
+            assert( options.threadCount > 0 );
+            ModelStatistics stats( highestClass + 1 );
+            BalsaFileParser groundTruthParser( options.groundTruthLabelsFile );
+            BalsaFileParser classifierParser( options.classifierLabelsFile );
+            groundTruthParser.enterTable();
+            classifierParser.enterTable();
+            while ( true )
+            {
+                auto groundTruthChunk = groundTruthParser.parseTableRowsAs<Label>( options.chunkRows );
+                auto classifierChunk  = classifierParser.parseTableRowsAs<Label>( options.chunkRows );
+                if ( groundTruthChunk.getRowCount() == 0 ) break;
+                assert( classifierChunk.getRowCount() == groundTruthChunk.getRowCount() );
+                stats.accumulate( groundTruthChunk.begin(), groundTruthChunk.end(), classifierChunk.begin(), options.threadCount );
+            }
+            groundTruthParser.leaveTable();
+            classifierParser.leaveTable();
+            stats.finalize();
+            std::cout << stats;
+            return EXIT_SUCCESS;
+        }
+
         // Read the gound truth labels and the classifier labels.
         Table<Label> groundTruthLabels = readTableAs<Label>( options.groundTruthLabelsFile );
         Table<Label> classifierLabels  = readTableAs<Label>( options.classifierLabelsFile );
@@ -91,7 +164,8 @@ int main( int argc, char ** argv )
         std::size_t numberOfClasses = highestClass + 1;
 
         // Calculate and print the statistics.
-        ModelStatistics stats( groundTruthLabels.begin(), groundTruthLabels.end(), classifierLabels.begin(), numberOfClasses );
+        assert( options.threadCount > 0 );
+        ModelStatistics stats( groundTruthLabels.begin(), groundTruthLabels.end(), classifierLabels.begin(), numberOfClasses, options.threadCount );
         std::cout << stats;
     }
     catch ( Exception & e )
@@ -1,10 +1,15 @@
 #include <cassert>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string>
+#include <tuple>
 
 #include "classifierfilestream.h"
+#include "classifiervisitor.h"
+#include "compiledforestclassifier.h"
 #include "config.h"
+#include "decisiontreeclassifier.h"
 #include "exceptions.h"
 
 using namespace balsa;
@@ -15,7 +20,11 @@ class Options
 {
 public:
 
-    Options()
+    Options():
+    prune( false ),
+    optimizeLayout( false ),
+    compressTrees( false ),
+    compile( false )
     {
     }
 
@@ -24,7 +33,29 @@ public:
         std::stringstream ss;
         ss << "Usage:" << std::endl
            << std::endl
-           << "   balsa_merge <outfile-name> <balsa-model-file>+" << std::endl;
+           << "   balsa_merge [options] <outfile-name> <balsa-model-file>+" << std::endl
+           << std::endl
+           << " Options:" << std::endl
+           << std::endl
+           << "   -p : Collapse subtrees whose leaves all carry the same label into a single" << std::endl
+           << "        leaf, and drop the unreachable nodes. This does not change the" << std::endl
+           << "        classification results." << std::endl
+           << "   -o : Rewrite the trees in breadth-first node order, packing the top levels" << std::endl
+           << "        of each tree into a contiguous, cache-friendly block. This does not" << std::endl
+           << "        change the classification results." << std::endl
+           << "   -z : Write the trees with the compressed node encoding, typically shrinking" << std::endl
+           << "        the model file several-fold. The output requires balsa file format 1.1" << std::endl
+           << "        readers. This does not change the classification results." << std::endl
+           << "   -f : Compile the input trees into a single fused forest: the node tables of" << std::endl
+           << "        all trees are packed consecutively in breadth-first order, with" << std::endl
+           << "        same-label subtrees collapsed, and each leaf carries its class weight" << std::endl
+           << "        as a precomputed vote increment. Compiled models classify faster, but" << std::endl
+           << "        support plain classification only (no vote fractions or per-tree" << std::endl
+           << "        voting), and require balsa file format 1.2 readers. Cannot be combined" << std::endl
+           << "        with -p, -o or -z." << std::endl
+           << "   -cw <label> <weight> :" << std::endl
+           << "        Sets the class weight to fold into the compiled forest (default: 1)." << std::endl
+           << "        Requires the -f option." << std::endl;
         return ss.str();
     }
 
@@ -50,9 +81,52 @@ public:
             // Stop if the token is not a flag.
             assert( token.size() );
             if ( token[0] != '-' ) break;
-            throw ParseError( std::string( "Unknown option: " ) + token );
+
+            // Parse the '-p' option.
+            if ( token == "-p" )
+            {
+                options.prune = true;
+            }
+
+            // Parse the '-o' option.
+            else if ( token == "-o" )
+            {
+                options.optimizeLayout = true;
+            }
+
+            // Parse the '-z' option.
+            else if ( token == "-z" )
+            {
+                options.compressTrees = true;
+            }
+
+            // Parse the '-f' option.
+            else if ( token == "-f" )
+            {
+                options.compile = true;
+            }
+
+            // Parse the '-cw' option.
+            else if ( token == "-cw" )
+            {
+                unsigned int label  = 0;
+                float        weight = 0;
+                if ( !( args >> label ) ) throw ParseError( "Missing class parameter to -cw option." );
+                if ( !( args >> weight ) ) throw ParseError( "Missing weight parameter to -cw option." );
+                options.classWeights.push_back( std::tuple<unsigned int, float>( label, weight ) );
+            }
+            else
+            {
+                throw ParseError( std::string( "Unknown option: " ) + token );
+            }
         }
 
+        // Check for invalid combinations of options.
+        if ( options.compile && options.prune ) throw ParseError( "The -p option cannot be combined with -f." );
+        if ( options.compile && options.optimizeLayout ) throw ParseError( "The -o option cannot be combined with -f." );
+        if ( options.compile && options.compressTrees ) throw ParseError( "The -z option cannot be combined with -f." );
+        if ( !options.compile && !options.classWeights.empty() ) throw ParseError( "The -cw option requires the -f option." );
+
         // Parse the output file name,
         if ( token.size() == 0 ) throw ParseError( getUsage() );
         options.outputFile = token;
@@ -68,8 +142,61 @@ public:
         return options;
     }
 
-    std::string              outputFile;
-    std::vector<std::string> modelFiles;
+    std::string                                  outputFile;
+    std::vector<std::string>                     modelFiles;
+    bool                                         prune;
+    bool                                         optimizeLayout;
+    bool                                         compressTrees;
+    bool                                         compile;
+    std::vector<std::tuple<unsigned int, float>> classWeights;
+};
+
+/**
+ * A visitor that writes classifiers to an output stream, optionally collapsing
+ * same-label subtrees and/or rewriting the node tables in breadth-first order.
+ */
+class TreeRewriter: public ClassifierVisitor
+{
+public:
+
+    TreeRewriter( ClassifierOutputStream & out, bool prune, bool optimizeLayout ):
+    m_out( out ),
+    m_prune( prune ),
+    m_optimizeLayout( optimizeLayout )
+    {
+    }
+
+    void visit( const EnsembleClassifier & )
+    {
+        throw ClientError( "Nested ensembles cannot be rewritten." );
+    }
+
+    void visit( const DecisionTreeClassifier<float> & classifier )
+    {
+        rewrite( classifier );
+    }
+
+    void visit( const DecisionTreeClassifier<double> & classifier )
+    {
+        rewrite( classifier );
+    }
+
+private:
+
+    template <typename FeatureType>
+    void rewrite( const DecisionTreeClassifier<FeatureType> & classifier )
+    {
+        if ( m_prune && m_optimizeLayout )
+            m_out.write( *classifier.prune()->reorderBreadthFirst() );
+        else if ( m_prune )
+            m_out.write( *classifier.prune() );
+        else
+            m_out.write( *classifier.reorderBreadthFirst() );
+    }
+
+    ClassifierOutputStream & m_out;
+    bool                     m_prune;
+    bool                     m_optimizeLayout;
 };
 
 } // namespace
@@ -83,10 +210,12 @@ int main( int argc, char ** argv )
 
         // Create the output file.
         EnsembleFileOutputStream out( options.outputFile, "balsa_merge", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
+        out.setCompressedTrees( options.compressTrees );
 
         // Append all input models to the merged file.
-        unsigned int classCount   = 0;
-        unsigned int featureCount = 0;
+        std::unique_ptr<ForestCompiler> compiler;
+        unsigned int                    classCount   = 0;
+        unsigned int                    featureCount = 0;
         for ( auto & modelFile : options.modelFiles )
         {
             // Open the input file and make sure the model is compatible with what was merged earlier.
@@ -98,10 +227,40 @@ int main( int argc, char ** argv )
             classCount   = in.getClassCount();
             featureCount = in.getFeatureCount();
 
-            // Append all submodels to the output file.
-            while ( auto submodel = in.next() ) out.write( *submodel );
+            // Create the forest compiler once the class count is known, expanding
+            // the class weight options into a weight for each class.
+            if ( options.compile && !compiler )
+            {
+                std::vector<float> weights( classCount, 1.0 );
+                for ( auto & pair : options.classWeights )
+                {
+                    auto label  = std::get<0>( pair );
+                    auto weight = std::get<1>( pair );
+                    if ( label >= weights.size() ) throw ClientError( "Class out of range: " + std::to_string( label ) );
+                    if ( weight != weight || weight < 0 ) throw ClientError( "Invalid weight: " + std::to_string( weight ) );
+                    weights[label] = weight;
+                }
+                compiler.reset( new ForestCompiler( weights ) );
+            }
+
+            // Append all submodels to the output file (or to the compiled
+            // forest), pruning the trees and rewriting the node layout if
+            // requested.
+            TreeRewriter rewriter( out, options.prune, options.optimizeLayout );
+            while ( auto submodel = in.next() )
+            {
+                if ( options.compile )
+                    submodel->visit( *compiler );
+                else if ( options.prune || options.optimizeLayout )
+                    submodel->visit( rewriter );
+                else
+                    out.write( *submodel );
+            }
         }
 
+        // Write the compiled forest that fuses all input trees.
+        if ( options.compile ) out.write( *compiler->getResult() );
+
         // Close the merged file.
         out.close();
     }
@@ -114,6 +114,12 @@ std::string getCommonTypeName<bool>()
     return "booleans";
 }
 
+template <>
+std::string getCommonTypeName<Float16>()
+{
+    return "half precision floating point numbers";
+}
+
 template <>
 std::string getCommonTypeName<float>()
 {
@@ -227,6 +233,8 @@ int main( int argc, char ** argv )
                     parseAndPrintTable<int16_t>( parser );
                 else if ( parser.atTableOfType<int32_t>() )
                     parseAndPrintTable<int32_t>( parser );
+                else if ( parser.atTableOfType<Float16>() )
+                    parseAndPrintTable<Float16>( parser );
                 else if ( parser.atTableOfType<float>() )
                     parseAndPrintTable<float>( parser );
                 else if ( parser.atTableOfType<double>() )
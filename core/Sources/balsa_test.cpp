@@ -2,15 +2,22 @@
 #include <cstdio>
 #include <cstdlib>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <sstream>
 #include <string>
 
+#include "compiledforestclassifier.h"
+#include "csvparser.h"
 #include "datagenerator.h"
 #include "datatypes.h"
+#include "featurequantizer.h"
+#include "modelevaluation.h"
 #include "randomforestclassifier.h"
 #include "randomforesttrainer.h"
 #include "table.h"
+#include "weightedcoin.h"
 
 using namespace balsa;
 
@@ -144,6 +151,1074 @@ bool testConcentricRings()
     return labels == truth;
 }
 
+template <typename FeatureType>
+bool testTraversalModesAgree()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a single decision tree.
+    NamedTemporaryFile modelFile( "balsa_test_traversal_modes.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 1, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Parse the tree from the model file.
+    BalsaFileParser parser( modelFile );
+    parser.enterEnsemble();
+    auto tree = std::dynamic_pointer_cast<DecisionTreeClassifier<FeatureType>>( parser.parseClassifier() );
+    if ( !tree ) return false;
+
+    // Classify the data with both traversal modes.
+    VoteTable iterativeVotes( points.getRowCount(), tree->getClassCount() );
+    tree->setTraversalMode( TreeTraversalMode::ITERATIVE_BLOCK );
+    tree->classifyAndVote( points.begin(), points.end(), iterativeVotes );
+
+    VoteTable recursiveVotes( points.getRowCount(), tree->getClassCount() );
+    tree->setTraversalMode( TreeTraversalMode::RECURSIVE_PARTITION );
+    tree->classifyAndVote( points.begin(), points.end(), recursiveVotes );
+
+    // Ensure the vote tables are identical.
+    return iterativeVotes == recursiveVotes;
+}
+
+template <typename FeatureType>
+bool testBreadthFirstReorderAgrees()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a single decision tree.
+    NamedTemporaryFile modelFile( "balsa_test_breadth_first_reorder.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 1, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Parse the tree from the model file.
+    BalsaFileParser parser( modelFile );
+    parser.enterEnsemble();
+    auto tree = std::dynamic_pointer_cast<DecisionTreeClassifier<FeatureType>>( parser.parseClassifier() );
+    if ( !tree ) return false;
+
+    // Reorder the nodes of the tree in breadth-first order.
+    auto reordered = tree->reorderBreadthFirst();
+
+    // Classify the data with the original and the reordered tree.
+    VoteTable originalVotes( points.getRowCount(), tree->getClassCount() );
+    tree->classifyAndVote( points.begin(), points.end(), originalVotes );
+
+    VoteTable reorderedVotes( points.getRowCount(), reordered->getClassCount() );
+    reordered->classifyAndVote( points.begin(), points.end(), reorderedVotes );
+
+    // Ensure the vote tables are identical.
+    return originalVotes == reorderedVotes;
+}
+
+template <typename FeatureType>
+bool testParallelizationModesAgree()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a small forest.
+    NamedTemporaryFile modelFile( "balsa_test_parallelization_modes.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Let the forest vote on the data in the tree-parallel mode.
+    RandomForestClassifier classifier( modelFile, 3, 0 );
+    VoteTable              treeParallelVotes( points.getRowCount(), classifier.getClassCount() );
+    classifier.classifyAndVote( points.begin(), points.end(), treeParallelVotes );
+
+    // Let the forest vote on the same data in the data-parallel mode.
+    VoteTable dataParallelVotes( points.getRowCount(), classifier.getClassCount() );
+    classifier.setParallelizationMode( ParallelizationMode::DATA_PARALLEL );
+    classifier.classifyAndVote( points.begin(), points.end(), dataParallelVotes );
+
+    // Ensure the vote tables are identical.
+    return treeParallelVotes == dataParallelVotes;
+}
+
+template <typename FeatureType>
+bool testVoteCounterWidthsAgree()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a small forest.
+    NamedTemporaryFile modelFile( "balsa_test_vote_counter_widths.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Classify the data with each vote counter width.
+    RandomForestClassifier classifier( modelFile, 0, 0 );
+    Table<Label>           labels32( points.getRowCount(), 1 );
+    classifier.classify( points.begin(), points.end(), labels32.begin() );
+
+    Table<Label> labels16( points.getRowCount(), 1 );
+    classifier.setVoteCounterWidth( VoteCounterWidth::BITS_16 );
+    classifier.classify( points.begin(), points.end(), labels16.begin() );
+
+    Table<Label> labels8( points.getRowCount(), 1 );
+    classifier.setVoteCounterWidth( VoteCounterWidth::BITS_8 );
+    classifier.classify( points.begin(), points.end(), labels8.begin() );
+
+    // Ensure the label sets are identical.
+    return labels16 == labels32 && labels8 == labels32;
+}
+
+template <typename FeatureType>
+bool testHistogramSplitFinding()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 10000, points, truth );
+
+    // Train a single decision tree using histogram-based split finding.
+    NamedTemporaryFile modelFile( "balsa_test_histogram_splits.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 1, 1, false, 1.0, false, 64 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Classify the training data.
+    Table<Label>           labels( points.getRowCount(), 1 );
+    RandomForestClassifier classifier( modelFile, 0, 0 );
+    classifier.classify( points.begin(), points.end(), labels.begin() );
+
+    // Histogram splits are approximate, but the tree is still grown until its
+    // leaves are pure, so the classification result must match the ground
+    // truth exactly.
+    return labels == truth;
+}
+
+template <typename FeatureType>
+bool testEarlyStoppingAgrees()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a small forest.
+    NamedTemporaryFile modelFile( "balsa_test_early_stopping.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Classify the data with a full evaluation of the ensemble.
+    RandomForestClassifier classifier( modelFile, 0, 0 );
+    Table<Label>           fullLabels( points.getRowCount(), 1 );
+    classifier.classify( points.begin(), points.end(), fullLabels.begin() );
+
+    // Classify the same data with early stopping enabled.
+    classifier.setEarlyStoppingInterval( 2 );
+    Table<Label> earlyLabels( points.getRowCount(), 1 );
+    classifier.classify( points.begin(), points.end(), earlyLabels.begin() );
+    if ( !( earlyLabels == fullLabels ) ) return false;
+
+    // Repeat the comparison with skewed class weights, which shift the point
+    // at which the leading class becomes uncatchable.
+    classifier.setClassWeights( { 1.0, 2.5 } );
+    classifier.setEarlyStoppingInterval( 0 );
+    classifier.classify( points.begin(), points.end(), fullLabels.begin() );
+    classifier.setEarlyStoppingInterval( 2 );
+    classifier.classify( points.begin(), points.end(), earlyLabels.begin() );
+    return earlyLabels == fullLabels;
+}
+
+template <typename FeatureType>
+bool testOutOfBagError()
+{
+    // Construct a multi-source model with a 2-D checkerboard. Use a coarse
+    // board, so the forest generalizes well to the held-out points.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 4, 1.0 );
+    black->addDimension( 4, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 4, 1.0 );
+    white->addDimension( 4, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a forest on subsamples of the data, with out-of-bag estimation.
+    NamedTemporaryFile modelFile( "balsa_test_out_of_bag.tmp" );
+    EnsembleFileOutputStream outputStream( modelFile );
+    RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 20, 2, false, 0.7, false, 0, std::string(), true );
+    trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+
+    // The vote table must have one row per point and one column per class, and
+    // the checkerboard is easy enough that the error estimate must be small.
+    auto & votes = trainer.getOutOfBagVotes();
+    if ( votes.getRowCount() != points.getRowCount() || votes.getColumnCount() != 2 ) return false;
+    if ( !( trainer.getOutOfBagError() >= 0.0 && trainer.getOutOfBagError() < 0.2 ) ) return false;
+
+    // Repeat with bootstrap sampling.
+    RandomForestTrainer<typename Table<FeatureType>::ConstIterator> bootstrapTrainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 20, 2, false, 1.0, true, 0, std::string(), true );
+    bootstrapTrainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    return bootstrapTrainer.getOutOfBagError() >= 0.0 && bootstrapTrainer.getOutOfBagError() < 0.2;
+}
+
+template <typename FeatureType>
+bool testNodeBudget()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Grow an unbudgeted tree and a budgeted tree from the same data and seed.
+    typedef IndexedDecisionTree<typename Table<FeatureType>::ConstIterator, Table<Label>::ConstIterator> TreeType;
+    TreeType unbounded( points.begin(), truth.begin(), 2, points.getRowCount(), 2 );
+    unbounded.seed( 0 );
+    unbounded.grow();
+
+    TreeType bounded( points.begin(), truth.begin(), 2, points.getRowCount(), 2 );
+    bounded.setNodeBudget( 33 );
+    bounded.seed( 0 );
+    bounded.grow();
+
+    // The budget must be respected, and must actually bind on this dataset.
+    if ( bounded.getNodeCount() > 33 ) return false;
+    if ( unbounded.getNodeCount() <= 33 ) return false;
+
+    // Construct a coarse 4x4 checkerboard, which fits comfortably within a
+    // small node budget.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer coarseBlack( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    coarseBlack->addDimension( 4, 1.0 );
+    coarseBlack->addDimension( 4, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer coarseWhite( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    coarseWhite->addDimension( 4, 1.0 );
+    coarseWhite->addDimension( 4, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer coarseBlackSource( new SingleSourceGenerator<FeatureType>() );
+    coarseBlackSource->addFeatureGenerator( coarseBlack );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer coarseWhiteSource( new SingleSourceGenerator<FeatureType>() );
+    coarseWhiteSource->addFeatureGenerator( coarseWhite );
+    MultiSourceGenerator<FeatureType> coarseGenerator( 0, 2 );
+    coarseGenerator.addSource( 1, coarseBlackSource );
+    coarseGenerator.addSource( 1, coarseWhiteSource );
+    Table<FeatureType> coarsePoints( 2 );
+    Table<Label>       coarseTruth( 1 );
+    coarseGenerator.generate( 1000, coarsePoints, coarseTruth );
+
+    // Train a budgeted forest on the coarse board, and ensure it still
+    // classifies the training data well: best-first growth must spend the
+    // budget on the dominant splits first.
+    NamedTemporaryFile modelFile( "balsa_test_node_budget.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, coarseGenerator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1, false, 1.0, false, 0, std::string(), false, 63 );
+        trainer.train( coarsePoints.begin(), coarsePoints.end(), coarsePoints.getColumnCount(), coarseTruth.begin() );
+    }
+    RandomForestClassifier classifier( modelFile, 0, 0 );
+    Table<Label>           labels( coarsePoints.getRowCount(), 1 );
+    classifier.classify( coarsePoints.begin(), coarsePoints.end(), labels.begin() );
+    std::size_t errors = 0;
+    for ( std::size_t row = 0; row < labels.getRowCount(); ++row )
+        if ( labels( row, 0 ) != coarseTruth( row, 0 ) ) ++errors;
+    return errors < labels.getRowCount() / 10;
+}
+
+template <typename FeatureType>
+bool testWorkStealingAgrees()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a small forest with a single worker thread and a fixed seed,
+    // without work stealing.
+    NamedTemporaryFile plainFile( "balsa_test_work_stealing_plain.tmp" );
+    {
+        getMasterSeedSequence().seed( 99 );
+        EnsembleFileOutputStream                                        outputStream( plainFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Repeat the training run with work stealing enabled. With a single
+    // worker there is nothing to steal, and cooperative growth claims the
+    // leaves in the same order as regular growth, so the model must be
+    // identical.
+    NamedTemporaryFile stealingFile( "balsa_test_work_stealing.tmp" );
+    {
+        getMasterSeedSequence().seed( 99 );
+        EnsembleFileOutputStream                                        outputStream( stealingFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1, false, 1.0, false, 0, std::string(), false, 0, true );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Classify the data with each model, and ensure the labels are identical.
+    RandomForestClassifier plainClassifier( plainFile, 0, 0 );
+    Table<Label>           plainLabels( points.getRowCount(), 1 );
+    plainClassifier.classify( points.begin(), points.end(), plainLabels.begin() );
+    RandomForestClassifier stealingClassifier( stealingFile, 0, 0 );
+    Table<Label>           stealingLabels( points.getRowCount(), 1 );
+    stealingClassifier.classify( points.begin(), points.end(), stealingLabels.begin() );
+    if ( !( stealingLabels == plainLabels ) ) return false;
+
+    // Train a larger forest with several workers and work stealing enabled.
+    // The exact trees now depend on which thread claims which leaf, so only
+    // the quality of the model can be checked: it must still classify the
+    // training data well.
+    NamedTemporaryFile threadedFile( "balsa_test_work_stealing_threaded.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( threadedFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 20, 4, false, 1.0, false, 0, std::string(), false, 0, true );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+    RandomForestClassifier threadedClassifier( threadedFile, 0, 0 );
+    Table<Label>           threadedLabels( points.getRowCount(), 1 );
+    threadedClassifier.classify( points.begin(), points.end(), threadedLabels.begin() );
+    std::size_t errors = 0;
+    for ( std::size_t row = 0; row < threadedLabels.getRowCount(); ++row )
+        if ( threadedLabels( row, 0 ) != truth( row, 0 ) ) ++errors;
+    return errors < threadedLabels.getRowCount() / 10;
+}
+
+template <typename FeatureType>
+bool testIntraTreeParallelGrowth()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set that is large enough to trigger the
+    // parallel partitioning of the top-level nodes.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 50000, points, truth );
+
+    // Grow one tree sequentially, and one with a pool of threads.
+    typedef IndexedDecisionTree<typename Table<FeatureType>::ConstIterator, Table<Label>::ConstIterator> TreeType;
+    TreeType sequential( points.begin(), truth.begin(), 2, points.getRowCount(), 2 );
+    sequential.seed( 0 );
+    sequential.grow();
+
+    TreeType parallel( points.begin(), truth.begin(), 2, points.getRowCount(), 2 );
+    parallel.grow( 4 );
+
+    // The parallel tree may differ from the sequential tree, but both are
+    // grown to full purity, so both must reproduce the training labels.
+    auto sequentialClassifier = sequential.getDecisionTree();
+    auto parallelClassifier   = parallel.getDecisionTree();
+    for ( auto classifier : { sequentialClassifier, parallelClassifier } )
+    {
+        VoteTable votes( points.getRowCount(), 2 );
+        classifier->classifyAndVote( points.begin(), points.end(), votes );
+        std::size_t errors = 0;
+        for ( std::size_t row = 0; row < votes.getRowCount(); ++row )
+            if ( static_cast<Label>( votes.getColumnOfRowMaximum( row ) ) != truth( row, 0 ) ) ++errors;
+        if ( errors >= votes.getRowCount() / 100 ) return false;
+    }
+    return true;
+}
+
+template <typename FeatureType>
+bool testPruneAgrees()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Grow a depth-limited tree. Truncated leaves carry the majority label of
+    // their points, so same-label sibling subtrees are common.
+    typedef IndexedDecisionTree<typename Table<FeatureType>::ConstIterator, Table<Label>::ConstIterator> TreeType;
+    TreeType tree( points.begin(), truth.begin(), 2, points.getRowCount(), 2, 8 );
+    tree.seed( 0 );
+    tree.grow();
+
+    // Prune the tree, and ensure it actually shrank.
+    auto classifier = tree.getDecisionTree();
+    auto pruned     = classifier->prune();
+    if ( !( pruned->getNodeCount() < classifier->getNodeCount() ) ) return false;
+
+    // The pruned tree must produce exactly the same labels.
+    Table<Label> labels( points.getRowCount(), 1 );
+    classifier->classify( points.begin(), points.end(), labels.begin() );
+    Table<Label> prunedLabels( points.getRowCount(), 1 );
+    pruned->classify( points.begin(), points.end(), prunedLabels.begin() );
+    return prunedLabels == labels;
+}
+
+template <typename FeatureType>
+bool testCompiledForestAgrees()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a small forest.
+    NamedTemporaryFile modelFile( "balsa_test_compiled_model.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Classify the data with a full evaluation of the ensemble.
+    RandomForestClassifier classifier( modelFile, 0, 0 );
+    Table<Label>           labels( points.getRowCount(), 1 );
+    classifier.classify( points.begin(), points.end(), labels.begin() );
+
+    // Compile the model into a fused forest, and write it to a file.
+    NamedTemporaryFile compiledFile( "balsa_test_compiled_forest.tmp" );
+    {
+        ClassifierFileInputStream in( modelFile );
+        ForestCompiler            compiler;
+        while ( auto submodel = in.next() ) submodel->visit( compiler );
+        EnsembleFileOutputStream out( compiledFile );
+        out.write( *compiler.getResult() );
+    }
+
+    // The compiled model must produce exactly the same labels, both on the
+    // calling thread and through the sliced multi-threaded fast path.
+    Table<Label> compiledLabels( points.getRowCount(), 1 );
+    {
+        RandomForestClassifier compiled( compiledFile, 0, 0 );
+        compiled.classify( points.begin(), points.end(), compiledLabels.begin() );
+        if ( !( compiledLabels == labels ) ) return false;
+    }
+    {
+        RandomForestClassifier compiled( compiledFile, 3, 0 );
+        compiled.classify( points.begin(), points.end(), compiledLabels.begin() );
+        if ( !( compiledLabels == labels ) ) return false;
+    }
+
+    // Repeat with skewed class weights folded into the leaf vote increments
+    // at compile time. The increments sum exactly in single precision, so the
+    // labels must match a run-time weighted evaluation of the original model.
+    classifier.setClassWeights( { 1.0, 2.5 } );
+    classifier.classify( points.begin(), points.end(), labels.begin() );
+    NamedTemporaryFile weightedFile( "balsa_test_compiled_weighted.tmp" );
+    {
+        ClassifierFileInputStream in( modelFile );
+        ForestCompiler            compiler( { 1.0, 2.5 } );
+        while ( auto submodel = in.next() ) submodel->visit( compiler );
+        EnsembleFileOutputStream out( weightedFile );
+        out.write( *compiler.getResult() );
+    }
+    RandomForestClassifier weighted( weightedFile, 0, 0 );
+    weighted.classify( points.begin(), points.end(), compiledLabels.begin() );
+    return compiledLabels == labels;
+}
+
+bool testFeatureSubsetSampling()
+{
+    // Draw many subsets of 4 values out of 32.
+    const unsigned int        SUBSET_SIZE = 4;
+    const unsigned int        RANGE_SIZE  = 32;
+    const unsigned int        DRAW_COUNT  = 10000;
+    WeightedCoin<>            coin;
+    coin.seed( 42 );
+    std::vector<FeatureID>    subset;
+    std::vector<unsigned int> hits( RANGE_SIZE, 0 );
+    for ( unsigned int draw = 0; draw < DRAW_COUNT; ++draw )
+    {
+        // Each subset must be sorted, of the requested size, and consist of
+        // distinct values from the range.
+        coin.drawSubset( SUBSET_SIZE, RANGE_SIZE, subset );
+        if ( subset.size() != SUBSET_SIZE ) return false;
+        if ( !std::is_sorted( subset.begin(), subset.end() ) ) return false;
+        if ( std::adjacent_find( subset.begin(), subset.end() ) != subset.end() ) return false;
+        if ( subset.back() >= RANGE_SIZE ) return false;
+        for ( auto value : subset ) ++hits[value];
+    }
+
+    // Each value must be drawn with approximately equal probability. The
+    // expected hit count is DRAW_COUNT * SUBSET_SIZE / RANGE_SIZE = 1250;
+    // allow a generous margin around it.
+    for ( auto count : hits )
+    {
+        if ( count < 1000 || count > 1500 ) return false;
+    }
+
+    // Drawing the full range must return the entire range.
+    coin.drawSubset( RANGE_SIZE, RANGE_SIZE, subset );
+    if ( subset.size() != RANGE_SIZE ) return false;
+    for ( unsigned int value = 0; value < RANGE_SIZE; ++value )
+    {
+        if ( subset[value] != value ) return false;
+    }
+
+    // Coins seeded identically must draw identical subsets.
+    WeightedCoin<> reseeded;
+    reseeded.seed( 42 );
+    std::vector<FeatureID> replayed;
+    coin.seed( 42 );
+    for ( unsigned int draw = 0; draw < 100; ++draw )
+    {
+        coin.drawSubset( SUBSET_SIZE, RANGE_SIZE, subset );
+        reseeded.drawSubset( SUBSET_SIZE, RANGE_SIZE, replayed );
+        if ( subset != replayed ) return false;
+    }
+
+    return true;
+}
+
+bool testParseCSVFile()
+{
+    // Write a CSV file with blank lines, padding whitespace, signs and
+    // exponent notation.
+    NamedTemporaryFile csvFile( "balsa_test_csv.tmp" );
+    {
+        std::ofstream out( csvFile );
+        out << "\n"
+            << "1.5, -2 , 3e2\n"
+            << "   \n"
+            << "+4,0.25,-1e-2\n"
+            << "7 ,8,9.125";
+    }
+
+    // Parse the file with the character-at-a-time parser as a reference.
+    std::stringstream reference( "1.5,-2,3e2\n+4,0.25,-1e-2\n7,8,9.125\n" );
+    auto              expected = parseCSV<double>( reference );
+
+    // The file parser must produce the same table, regardless of how the file
+    // is divided over threads.
+    for ( unsigned int threadCount = 1; threadCount <= 8; ++threadCount )
+        if ( !( parseCSVFile<double>( csvFile, threadCount ) == expected ) ) return false;
+    return true;
+}
+
+bool testTableTypeConversionRead()
+{
+    // Fill a table with values that are exactly representable in both single
+    // and double precision.
+    Table<float> original( 1000, 3 );
+    for ( unsigned int row = 0; row < original.getRowCount(); ++row )
+        for ( unsigned int column = 0; column < original.getColumnCount(); ++column )
+            original( row, column ) = row * 0.25f - column;
+
+    // Write the table to a file.
+    NamedTemporaryFile tableFile( "balsa_test_conversion.tmp" );
+    {
+        BalsaFileWriter fileWriter( tableFile );
+        fileWriter.writeTable( original );
+    }
+
+    // Read the table back as doubles, converting on the fly.
+    auto converted = readTableAs<double>( tableFile );
+    if ( converted.getRowCount() != original.getRowCount() ) return false;
+    if ( converted.getColumnCount() != original.getColumnCount() ) return false;
+    for ( unsigned int row = 0; row < original.getRowCount(); ++row )
+        for ( unsigned int column = 0; column < original.getColumnCount(); ++column )
+            if ( converted( row, column ) != original( row, column ) ) return false;
+
+    // Read the table back without conversion.
+    auto identical = readTableAs<float>( tableFile );
+    return identical == original;
+}
+
+bool testFloat16Storage()
+{
+    // Conversion to single precision and back must be lossless for values that
+    // are exactly representable in half precision.
+    const float representable[] = { 0.0f, 1.0f, -1.0f, 0.5f, 1.5f, -2.25f, 1024.0f, 65504.0f, 0.0009765625f, 1.0f / 16777216.0f, 3.0f / 16777216.0f };
+    for ( float value : representable )
+        if ( static_cast<float>( Float16( value ) ) != value ) return false;
+
+    // Narrowing must round to the nearest representable value, breaking ties
+    // to even. The nearest half precision neighbours of 1 are 1 + 2^-10 and
+    // 1 - 2^-11.
+    if ( static_cast<float>( Float16( 1.0f + 0.25f / 1024.0f ) ) != 1.0f ) return false;
+    if ( static_cast<float>( Float16( 1.0f + 0.75f / 1024.0f ) ) != 1.0f + 1.0f / 1024.0f ) return false;
+    if ( static_cast<float>( Float16( 1.0f + 0.5f / 1024.0f ) ) != 1.0f ) return false;
+
+    // Values beyond the half precision range must become infinities, values
+    // below the smallest subnormal must become zero.
+    if ( static_cast<float>( Float16( 1e6f ) ) != std::numeric_limits<float>::infinity() ) return false;
+    if ( static_cast<float>( Float16( -1e6f ) ) != -std::numeric_limits<float>::infinity() ) return false;
+    if ( static_cast<float>( Float16( 1e-10f ) ) != 0.0f ) return false;
+
+    // Fill a table with exactly representable values.
+    Table<Float16> original( 1000, 3 );
+    for ( unsigned int row = 0; row < original.getRowCount(); ++row )
+        for ( unsigned int column = 0; column < original.getColumnCount(); ++column )
+            original( row, column ) = Float16( row * 0.25f - column );
+
+    // Write the table to a file.
+    NamedTemporaryFile tableFile( "balsa_test_float16.tmp" );
+    {
+        BalsaFileWriter fileWriter( tableFile );
+        fileWriter.writeTable( original );
+    }
+
+    // Read the table back as single and double precision, converting on the fly.
+    auto widened = readTableAs<float>( tableFile );
+    if ( widened.getRowCount() != original.getRowCount() ) return false;
+    if ( widened.getColumnCount() != original.getColumnCount() ) return false;
+    for ( unsigned int row = 0; row < original.getRowCount(); ++row )
+        for ( unsigned int column = 0; column < original.getColumnCount(); ++column )
+            if ( widened( row, column ) != row * 0.25f - column ) return false;
+    auto doubled = readTableAs<double>( tableFile );
+    for ( unsigned int row = 0; row < original.getRowCount(); ++row )
+        for ( unsigned int column = 0; column < original.getColumnCount(); ++column )
+            if ( doubled( row, column ) != row * 0.25 - column ) return false;
+
+    // Read the table back without conversion.
+    auto identical = readTableAs<Float16>( tableFile );
+    return identical == original;
+}
+
+template <typename FeatureType>
+bool testVoteFractions()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a small forest.
+    NamedTemporaryFile modelFile( "balsa_test_vote_fractions.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Let the forest vote on the data.
+    RandomForestClassifier classifier( modelFile, 0, 0 );
+    VoteTable              votes( points.getRowCount(), classifier.getClassCount() );
+    classifier.classifyAndVote( points.begin(), points.end(), votes );
+
+    // Classify the data, recording the vote fractions in the same pass.
+    Table<Label> labels( points.getRowCount(), 1 );
+    Table<float> fractions( points.getRowCount(), classifier.getClassCount() );
+    classifier.classify( points.begin(), points.end(), labels.begin(), fractions );
+
+    // The fractions must equal the vote counts divided by the tree count.
+    const float scale = 1.0f / 5;
+    for ( unsigned int row = 0; row < votes.getRowCount(); ++row )
+        for ( unsigned int column = 0; column < votes.getColumnCount(); ++column )
+            if ( fractions( row, column ) != votes( row, column ) * scale ) return false;
+
+    // The labels must match those of a plain classification run.
+    Table<Label> plainLabels( points.getRowCount(), 1 );
+    classifier.classify( points.begin(), points.end(), plainLabels.begin() );
+    return labels == plainLabels;
+}
+
+template <typename FeatureType>
+bool testClassificationSession()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a small forest.
+    NamedTemporaryFile modelFile( "balsa_test_session.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( modelFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Classify the whole set without a session as a reference.
+    RandomForestClassifier classifier( modelFile, 0, 0 );
+    Table<Label>           expected( points.getRowCount(), 1 );
+    classifier.classify( points.begin(), points.end(), expected.begin() );
+
+    // Classify in equally sized chunks, reusing one session across the
+    // chunks. The second pass uses a different chunk size, to exercise the
+    // reallocation on a shape change.
+    ClassificationSession session;
+    const unsigned int    featureCount = points.getColumnCount();
+    for ( std::size_t chunkRows : { 100, 250 } )
+    {
+        Table<Label> labels( points.getRowCount(), 1 );
+        for ( std::size_t row = 0; row < points.getRowCount(); row += chunkRows )
+            classifier.classify( points.begin() + row * featureCount, points.begin() + ( row + chunkRows ) * featureCount, labels.begin() + row, session );
+        if ( !( labels == expected ) ) return false;
+    }
+    return true;
+}
+
+template <typename FeatureType>
+bool testCompressedTreeRoundTrip()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 1000, points, truth );
+
+    // Train a small forest with the plain encoding.
+    NamedTemporaryFile plainFile( "balsa_test_plain.tmp" );
+    NamedTemporaryFile compressedFile( "balsa_test_compressed.tmp" );
+    {
+        EnsembleFileOutputStream                                        outputStream( plainFile );
+        RandomForestTrainer<typename Table<FeatureType>::ConstIterator> trainer( outputStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 5, 1 );
+        trainer.train( points.begin(), points.end(), points.getColumnCount(), truth.begin() );
+    }
+
+    // Rewrite the model with the compressed encoding.
+    {
+        ClassifierFileInputStream in( plainFile );
+        EnsembleFileOutputStream  out( compressedFile );
+        out.setCompressedTrees( true );
+        while ( auto classifier = in.next() ) out.write( *classifier );
+    }
+
+    // The compressed model must be substantially smaller.
+    if ( std::filesystem::file_size( std::string( compressedFile ) ) * 2 > std::filesystem::file_size( std::string( plainFile ) ) ) return false;
+
+    // Both models must produce identical classifications.
+    RandomForestClassifier plainClassifier( plainFile, 0, 0 );
+    RandomForestClassifier compressedClassifier( compressedFile, 0, 0 );
+    Table<Label>           expected( points.getRowCount(), 1 );
+    Table<Label>           labels( points.getRowCount(), 1 );
+    plainClassifier.classify( points.begin(), points.end(), expected.begin() );
+    compressedClassifier.classify( points.begin(), points.end(), labels.begin() );
+    return labels == expected;
+}
+
+bool testModelStatistics()
+{
+    // A small, hand-checkable 3-class case. Rows of the confusion matrix hold
+    // the predicted labels, columns the ground truth labels:
+    //
+    //     2 1 0
+    //     1 3 1
+    //     0 0 2
+    //
+    const std::vector<Label> truth = { 0, 0, 0, 1, 1, 1, 1, 2, 2, 2 };
+    const std::vector<Label> predicted = { 0, 0, 1, 1, 1, 1, 0, 2, 2, 1 };
+    ModelStatistics          stats( truth.begin(), truth.end(), predicted.begin(), 3 );
+
+    // Check the counts for class 1.
+    if ( stats.P( 1, 0 ) != 4 || stats.N( 1, 0 ) != 6 ) return false;
+    if ( stats.TP( 1, 0 ) != 3 || stats.FP( 1, 0 ) != 2 ) return false;
+    if ( stats.FN( 1, 0 ) != 1 || stats.TN( 1, 0 ) != 4 ) return false;
+    if ( stats.PP( 1, 0 ) != 5 || stats.PN( 1, 0 ) != 5 ) return false;
+
+    // Check the overall accuracy.
+    if ( stats.ACC != 0.7 ) return false;
+
+    // Multi-threaded binning must produce identical statistics on a larger,
+    // randomly generated label set, including thread counts that do not divide
+    // the number of points evenly.
+    std::mt19937                                noise( 42 );
+    std::uniform_int_distribution<unsigned int> labelDistribution( 0, 4 );
+    std::vector<Label>                          largeTruth( 9973 );
+    std::vector<Label>                          largePredicted( 9973 );
+    for ( auto & l : largeTruth ) l = labelDistribution( noise );
+    for ( auto & l : largePredicted ) l = labelDistribution( noise );
+    ModelStatistics reference( largeTruth.begin(), largeTruth.end(), largePredicted.begin(), 5 );
+    for ( unsigned int threadCount : { 2, 3, 7 } )
+    {
+        ModelStatistics threaded( largeTruth.begin(), largeTruth.end(), largePredicted.begin(), 5, threadCount );
+        if ( !( threaded.CM == reference.CM ) ) return false;
+        if ( threaded.ACC != reference.ACC ) return false;
+    }
+
+    // Accumulating the labels in chunks must produce identical statistics,
+    // including chunk sizes that do not divide the number of points evenly.
+    for ( std::size_t chunkRows : { 100, 1000, 1021 } )
+    {
+        ModelStatistics chunked( 5 );
+        for ( std::size_t row = 0; row < largeTruth.size(); row += chunkRows )
+        {
+            const std::size_t rows = std::min( chunkRows, largeTruth.size() - row );
+            chunked.accumulate( largeTruth.begin() + row, largeTruth.begin() + row + rows, largePredicted.begin() + row );
+        }
+        chunked.finalize();
+        if ( !( chunked.CM == reference.CM ) ) return false;
+        if ( chunked.ACC != reference.ACC ) return false;
+    }
+    return true;
+}
+
+template <typename CodeType>
+bool testQuantizedTraining()
+{
+    // Construct a multi-source model with a 2-D checkerboard.
+    typedef double                                                    FeatureType;
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer black( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::BLACK ) );
+    black->addDimension( 16, 1.0 );
+    black->addDimension( 32, 0.75 );
+    typename CheckerboardFeatureGenerator<FeatureType>::SharedPointer white( new CheckerboardFeatureGenerator<FeatureType>( CheckerboardFeatureGenerator<FeatureType>::Color::WHITE ) );
+    white->addDimension( 16, 1.0 );
+    white->addDimension( 32, 0.75 );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer blackSource( new SingleSourceGenerator<FeatureType>() );
+    blackSource->addFeatureGenerator( black );
+    typename SingleSourceGenerator<FeatureType>::SharedPointer whiteSource( new SingleSourceGenerator<FeatureType>() );
+    whiteSource->addFeatureGenerator( white );
+    MultiSourceGenerator<FeatureType> generator( 0, 2 );
+    generator.addSource( 1, blackSource );
+    generator.addSource( 1, whiteSource );
+
+    // Generate a data- and label set.
+    Table<FeatureType> points( 2 );
+    Table<Label>       truth( 1 );
+    generator.generate( 10000, points, truth );
+
+    // Train a single decision tree on a quantized copy of the data.
+    NamedTemporaryFile modelFile( "balsa_test_quantized.tmp" );
+    {
+        FeatureQuantizer<FeatureType, CodeType> quantizer( points.begin(), points.end(), points.getColumnCount() );
+        auto                                    codes = quantizer.quantize( points.begin(), points.end() );
+
+        EnsembleFileOutputStream                                     outputStream( modelFile );
+        DequantizingOutputStream<FeatureType, CodeType>              dequantizingStream( outputStream, quantizer );
+        RandomForestTrainer<typename Table<CodeType>::ConstIterator> trainer( dequantizingStream, generator.getFeatureCount(), std::numeric_limits<unsigned int>::max(), 1.0, 1, 1 );
+        trainer.train( codes.begin(), codes.end(), codes.getColumnCount(), truth.begin() );
+    }
+
+    // Classify the original, unquantized training data.
+    Table<Label>           labels( points.getRowCount(), 1 );
+    RandomForestClassifier classifier( modelFile, 0, 0 );
+    classifier.classify( points.begin(), points.end(), labels.begin() );
+
+    // Quantization restricts the split thresholds to the bin edges, so a
+    // small number of points near the cell boundaries may be mislabeled.
+    std::size_t mismatches = 0;
+    for ( unsigned int row = 0; row < labels.getRowCount(); ++row )
+        if ( labels( row, 0 ) != truth( row, 0 ) ) ++mismatches;
+    return mismatches <= points.getRowCount() / 50;
+}
+
 bool execute_test( const std::string & name, bool ( *test )( void ) )
 {
     // Run a single test and return the test result.
@@ -177,6 +1252,43 @@ int main()
         result &= execute_test( "testCheckerboard<double>", testCheckerboard<double> );
         result &= execute_test( "testConcentricRings<float>", testConcentricRings<float> );
         result &= execute_test( "testConcentricRings<double>", testConcentricRings<double> );
+        result &= execute_test( "testTraversalModesAgree<float>", testTraversalModesAgree<float> );
+        result &= execute_test( "testTraversalModesAgree<double>", testTraversalModesAgree<double> );
+        result &= execute_test( "testBreadthFirstReorderAgrees<float>", testBreadthFirstReorderAgrees<float> );
+        result &= execute_test( "testBreadthFirstReorderAgrees<double>", testBreadthFirstReorderAgrees<double> );
+        result &= execute_test( "testParallelizationModesAgree<float>", testParallelizationModesAgree<float> );
+        result &= execute_test( "testParallelizationModesAgree<double>", testParallelizationModesAgree<double> );
+        result &= execute_test( "testVoteCounterWidthsAgree<float>", testVoteCounterWidthsAgree<float> );
+        result &= execute_test( "testVoteCounterWidthsAgree<double>", testVoteCounterWidthsAgree<double> );
+        result &= execute_test( "testHistogramSplitFinding<float>", testHistogramSplitFinding<float> );
+        result &= execute_test( "testHistogramSplitFinding<double>", testHistogramSplitFinding<double> );
+        result &= execute_test( "testEarlyStoppingAgrees<float>", testEarlyStoppingAgrees<float> );
+        result &= execute_test( "testEarlyStoppingAgrees<double>", testEarlyStoppingAgrees<double> );
+        result &= execute_test( "testOutOfBagError<float>", testOutOfBagError<float> );
+        result &= execute_test( "testOutOfBagError<double>", testOutOfBagError<double> );
+        result &= execute_test( "testNodeBudget<float>", testNodeBudget<float> );
+        result &= execute_test( "testNodeBudget<double>", testNodeBudget<double> );
+        result &= execute_test( "testWorkStealingAgrees<float>", testWorkStealingAgrees<float> );
+        result &= execute_test( "testWorkStealingAgrees<double>", testWorkStealingAgrees<double> );
+        result &= execute_test( "testIntraTreeParallelGrowth<float>", testIntraTreeParallelGrowth<float> );
+        result &= execute_test( "testIntraTreeParallelGrowth<double>", testIntraTreeParallelGrowth<double> );
+        result &= execute_test( "testPruneAgrees<float>", testPruneAgrees<float> );
+        result &= execute_test( "testPruneAgrees<double>", testPruneAgrees<double> );
+        result &= execute_test( "testCompiledForestAgrees<float>", testCompiledForestAgrees<float> );
+        result &= execute_test( "testCompiledForestAgrees<double>", testCompiledForestAgrees<double> );
+        result &= execute_test( "testFeatureSubsetSampling", testFeatureSubsetSampling );
+        result &= execute_test( "testTableTypeConversionRead", testTableTypeConversionRead );
+        result &= execute_test( "testFloat16Storage", testFloat16Storage );
+        result &= execute_test( "testParseCSVFile", testParseCSVFile );
+        result &= execute_test( "testVoteFractions<float>", testVoteFractions<float> );
+        result &= execute_test( "testVoteFractions<double>", testVoteFractions<double> );
+        result &= execute_test( "testClassificationSession<float>", testClassificationSession<float> );
+        result &= execute_test( "testClassificationSession<double>", testClassificationSession<double> );
+        result &= execute_test( "testModelStatistics", testModelStatistics );
+        result &= execute_test( "testCompressedTreeRoundTrip<float>", testCompressedTreeRoundTrip<float> );
+        result &= execute_test( "testCompressedTreeRoundTrip<double>", testCompressedTreeRoundTrip<double> );
+        result &= execute_test( "testQuantizedTraining<uint8_t>", testQuantizedTraining<uint8_t> );
+        result &= execute_test( "testQuantizedTraining<uint16_t>", testQuantizedTraining<uint16_t> );
     }
     catch ( Exception & e )
     {
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cassert>
+#include <fstream>
 #include <iostream>
 #include <random>
 #include <sstream>
@@ -7,6 +9,8 @@
 #include "classifierfilestream.h"
 #include "config.h"
 #include "exceptions.h"
+#include "featurequantizer.h"
+#include "performancereport.h"
 #include "randomforesttrainer.h"
 #include "table.h"
 #include "timing.h"
@@ -27,7 +31,17 @@ public:
     threadCount( 1 ),
     featuresToConsider( 0 ), // Will be chosen internally by trainer if 0.
     seed( std::random_device{}() ),
-    writeDotty( false )
+    writeDotty( false ),
+    sampleFraction( 1.0 ),
+    bootstrap( false ),
+    outOfBagError( false ),
+    histogramBinCount( 0 ),
+    nodeBudget( 0 ),
+    quantizeBits( 0 ),
+    shardIndex( 0 ),
+    shardCount( 1 ),
+    compressTrees( false ),
+    workStealing( false )
     {
     }
 
@@ -47,7 +61,44 @@ public:
            << "   -s <random seed> : Random seed (default: a random value)." << std::endl
            << "   -f <count>       : Number of (randomly selected) features to consider per" << std::endl
            << "                      split (default: floor(sqrt(feature count))." << std::endl
-           << "   -g               : Generates Graphviz/Dotty files of all trees." << std::endl;
+           << "   -g               : Generates Graphviz/Dotty files of all trees." << std::endl
+           << "   -ss <fraction>   : Trains each tree on a random subsample of the given" << std::endl
+           << "                      fraction of the data (default: 1, train on all data)." << std::endl
+           << "   -sr              : Draws the per-tree subsamples with replacement" << std::endl
+           << "                      (bootstrap sampling)." << std::endl
+           << "   -oob             : Computes an out-of-bag error estimate: each tree" << std::endl
+           << "                      classifies the points it was not trained on. Requires" << std::endl
+           << "                      a sample fraction below 1 (-ss) or bootstrapping (-sr)." << std::endl
+           << "   -hb <bin count>  : Uses histogram-based (approximate) split finding with" << std::endl
+           << "                      the given number of bins (default: 0, exact splits)." << std::endl
+           << "   -nb <node count> : Limits each tree to the given number of nodes, growing" << std::endl
+           << "                      leaves best-first by impurity reduction, so the budget" << std::endl
+           << "                      is spent where it buys the most accuracy (default: 0," << std::endl
+           << "                      unlimited)." << std::endl
+           << "   -q <bits>        : Quantizes features to 8- or 16-bit codes before" << std::endl
+           << "                      training, shrinking the training index several-fold" << std::endl
+           << "                      at a small cost in split precision (default: 0, off)." << std::endl
+           << "   -sc <file>       : Caches the sorted training index (sapling) in the given" << std::endl
+           << "                      file. The cache is created on the first run, and reused" << std::endl
+           << "                      by later runs on the same data- and label files." << std::endl
+           << "   -perf <file>     : Writes a JSON performance report of the run (per-stage" << std::endl
+           << "                      timers and counters) to the given file." << std::endl
+           << "   -z               : Writes the trees with the compressed node encoding," << std::endl
+           << "                      typically shrinking the model file several-fold. The" << std::endl
+           << "                      model requires balsa file format 1.1 readers." << std::endl
+           << "   -ws              : Lets threads that have run out of trees to train help" << std::endl
+           << "                      grow the remaining trees, by stealing growable leaves" << std::endl
+           << "                      from them. This shortens the tail of a run, where the" << std::endl
+           << "                      last deep trees would otherwise be grown by one thread" << std::endl
+           << "                      each, but makes the trees depend on thread timing: a" << std::endl
+           << "                      fixed seed (-s) no longer reproduces the exact model." << std::endl
+           << "                      Cannot be combined with -nb." << std::endl
+           << "   -sh <idx> <count>: Trains shard <idx> (0-based) of a forest that is split" << std::endl
+           << "                      over <count> training runs, e.g. on separate hosts. Each" << std::endl
+           << "                      shard grows its share of the trees from the seeds those" << std::endl
+           << "                      trees would receive in a single run, so merging the shard" << std::endl
+           << "                      models with balsa_merge (in shard order) reproduces the" << std::endl
+           << "                      forest of a single run with the same seed." << std::endl;
         return ss.str();
     }
 
@@ -98,12 +149,66 @@ public:
             {
                 options.writeDotty = true;
             }
+            else if ( token == "-ss" )
+            {
+                if ( !( args >> options.sampleFraction ) ) throw ParseError( "Missing parameter to -ss option." );
+            }
+            else if ( token == "-sr" )
+            {
+                options.bootstrap = true;
+            }
+            else if ( token == "-oob" )
+            {
+                options.outOfBagError = true;
+            }
+            else if ( token == "-hb" )
+            {
+                if ( !( args >> options.histogramBinCount ) ) throw ParseError( "Missing parameter to -hb option." );
+            }
+            else if ( token == "-nb" )
+            {
+                if ( !( args >> options.nodeBudget ) ) throw ParseError( "Missing parameter to -nb option." );
+            }
+            else if ( token == "-q" )
+            {
+                if ( !( args >> options.quantizeBits ) ) throw ParseError( "Missing parameter to -q option." );
+                if ( options.quantizeBits != 0 && options.quantizeBits != 8 && options.quantizeBits != 16 ) throw ParseError( "Invalid parameter to -q option (must be 8 or 16)." );
+            }
+            else if ( token == "-sc" )
+            {
+                if ( !( args >> options.saplingCacheFile ) ) throw ParseError( "Missing parameter to -sc option." );
+            }
+            else if ( token == "-perf" )
+            {
+                if ( !( args >> options.performanceReportFile ) ) throw ParseError( "Missing parameter to -perf option." );
+            }
+            else if ( token == "-z" )
+            {
+                options.compressTrees = true;
+            }
+            else if ( token == "-ws" )
+            {
+                options.workStealing = true;
+            }
+            else if ( token == "-sh" )
+            {
+                if ( !( args >> options.shardIndex ) ) throw ParseError( "Missing shard index parameter to -sh option." );
+                if ( !( args >> options.shardCount ) ) throw ParseError( "Missing shard count parameter to -sh option." );
+                if ( options.shardCount == 0 ) throw ParseError( "Invalid parameter to -sh option (shard count must be positive)." );
+                if ( options.shardIndex >= options.shardCount ) throw ParseError( "Invalid parameter to -sh option (shard index must be smaller than the shard count)." );
+            }
             else
             {
                 throw ParseError( std::string( "Unknown option: " ) + token );
             }
         }
 
+        // The quantized training path uses a code-typed index that cannot be cached.
+        if ( options.quantizeBits && !options.saplingCacheFile.empty() ) throw ParseError( "The -sc option cannot be combined with -q." );
+
+        // Work stealing distributes the leaf splits of a tree over threads; best-first growth is strictly ordered.
+        if ( options.workStealing && options.nodeBudget != 0 ) throw ParseError( "The -ws option cannot be combined with -nb." );
+
         // Parse the filenames.
         if ( token.size() == 0 ) throw ParseError( getUsage() );
         options.dataFile = token;
@@ -124,7 +229,64 @@ public:
     unsigned int                    featuresToConsider;
     std::random_device::result_type seed;
     bool                            writeDotty;
+    double                          sampleFraction;
+    bool                            bootstrap;
+    bool                            outOfBagError;
+    unsigned int                    histogramBinCount;
+    unsigned int                    nodeBudget;
+    unsigned int                    quantizeBits;
+    std::string                     saplingCacheFile;
+    std::string                     performanceReportFile;
+    unsigned int                    shardIndex;
+    unsigned int                    shardCount;
+    bool                            compressTrees;
+    bool                            workStealing;
 };
+
+/**
+ * Write a JSON performance report of the training run to the given file.
+ */
+template <typename TrainerType>
+void writePerformanceReport( const TrainerType & trainer, const std::string & fileName )
+{
+    auto & statistics = trainer.getStatistics();
+
+    PerformanceReport report;
+    report.add( "trainer", "index-construction-time", statistics.m_indexConstructionTime );
+    report.add( "trainer", "worker-busy-time", statistics.m_workerBusyTime );
+    report.add( "trainer", "worker-idle-time", statistics.m_workerIdleTime );
+    report.add( "trainer", "model-store-time", statistics.m_modelStoreTime );
+    report.add( "trainer", "tree-growth-times", statistics.m_treeGrowthTimes );
+
+    std::ofstream out( fileName );
+    report.writeJSON( out );
+}
+
+/**
+ * Train a random forest on a quantized (discretized) copy of the dataset.
+ * Split thresholds are translated back to real feature values when the trees
+ * are written, so the resulting model file is a regular model over the
+ * original feature space.
+ */
+template <typename CodeType>
+void trainQuantized( const Options & options, unsigned int treeCount, EnsembleFileOutputStream & outputStream, const Table<double> & dataSet, const Table<Label> & labels )
+{
+    // Discretize the features into compact integer codes.
+    FeatureQuantizer<double, CodeType> quantizer( dataSet.begin(), dataSet.end(), dataSet.getColumnCount() );
+    auto                               codes = quantizer.quantize( dataSet.begin(), dataSet.end() );
+
+    // Train on the codes, dequantizing the trees as they are written.
+    DequantizingOutputStream<double, CodeType>                   dequantizingStream( outputStream, quantizer );
+    RandomForestTrainer<typename Table<CodeType>::ConstIterator> trainer( dequantizingStream, options.featuresToConsider, options.maxDepth, options.minPurity, treeCount, options.threadCount, options.writeDotty, options.sampleFraction, options.bootstrap, options.histogramBinCount, std::string(), options.outOfBagError, options.nodeBudget, options.workStealing );
+    trainer.train( codes.begin(), codes.end(), codes.getColumnCount(), labels.begin() );
+
+    // Report the out-of-bag error estimate, if it was computed.
+    if ( options.outOfBagError ) std::cout << "Out-of-bag error: " << trainer.getOutOfBagError() << std::endl;
+
+    // Write the performance report, if requested.
+    if ( !options.performanceReportFile.empty() ) writePerformanceReport( trainer, options.performanceReportFile );
+}
+
 } // namespace
 
 int main( int argc, char ** argv )
@@ -144,10 +306,30 @@ int main( int argc, char ** argv )
         std::cout << "Threads          : " << options.threadCount << std::endl;
         std::cout << "Feat. to Consider: " << options.featuresToConsider << std::endl;
         std::cout << "Random Seed      : " << options.seed << std::endl;
+        std::cout << "Sample Fraction  : " << options.sampleFraction << ( options.bootstrap ? " (with replacement)" : "" ) << std::endl;
+        std::cout << "Split Finding    : " << ( options.histogramBinCount ? "histogram (" + std::to_string( options.histogramBinCount ) + " bins)" : "exact" ) << std::endl;
+        std::cout << "Node Budget      : " << ( options.nodeBudget ? std::to_string( options.nodeBudget ) + " nodes (best-first)" : "unlimited" ) << std::endl;
+        std::cout << "Quantization     : " << ( options.quantizeBits ? std::to_string( options.quantizeBits ) + "-bit codes" : "none" ) << std::endl;
 
         // Seed master seed sequence.
         getMasterSeedSequence().seed( options.seed );
 
+        // Determine the range of trees covered by this shard, and advance the
+        // master seed sequence past the seeds of the preceding shards, so each
+        // tree is grown from the seed it would receive in a single, unsharded
+        // run.
+        unsigned int treeCount = options.treeCount;
+        if ( options.shardCount > 1 )
+        {
+            const unsigned int baseCount  = options.treeCount / options.shardCount;
+            const unsigned int remainder  = options.treeCount % options.shardCount;
+            const unsigned int treeOffset = options.shardIndex * baseCount + std::min( options.shardIndex, remainder );
+            treeCount                     = baseCount + ( options.shardIndex < remainder ? 1 : 0 );
+            if ( treeCount == 0 ) throw ClientError( "The shard count exceeds the number of trees." );
+            for ( unsigned int i = 0; i < treeOffset; ++i ) getMasterSeedSequence().next();
+            std::cout << "Shard            : " << options.shardIndex << " of " << options.shardCount << " (trees " << treeOffset << ".." << ( treeOffset + treeCount - 1 ) << ")." << std::endl;
+        }
+
         // Load training data set.
         StopWatch watch;
         std::cout << "Ingesting data..." << std::endl;
@@ -162,9 +344,27 @@ int main( int argc, char ** argv )
         // Train a random forest on the data.
         std::cout << "Training..." << std::endl;
         EnsembleFileOutputStream outputStream( options.outputFile, "balsa_train", balsa_VERSION_MAJOR, balsa_VERSION_MINOR, balsa_VERSION_PATCH );
-        RandomForestTrainer      trainer( outputStream, options.featuresToConsider, options.maxDepth, options.minPurity, options.treeCount, options.threadCount, options.writeDotty );
+        outputStream.setCompressedTrees( options.compressTrees );
         watch.start();
-        trainer.train( dataSet.begin(), dataSet.end(), dataSet.getColumnCount(), labels.begin() );
+        if ( options.quantizeBits == 8 )
+        {
+            trainQuantized<uint8_t>( options, treeCount, outputStream, dataSet, labels );
+        }
+        else if ( options.quantizeBits == 16 )
+        {
+            trainQuantized<uint16_t>( options, treeCount, outputStream, dataSet, labels );
+        }
+        else
+        {
+            RandomForestTrainer trainer( outputStream, options.featuresToConsider, options.maxDepth, options.minPurity, treeCount, options.threadCount, options.writeDotty, options.sampleFraction, options.bootstrap, options.histogramBinCount, options.saplingCacheFile, options.outOfBagError, options.nodeBudget, options.workStealing );
+            trainer.train( dataSet.begin(), dataSet.end(), dataSet.getColumnCount(), labels.begin() );
+
+            // Report the out-of-bag error estimate, if it was computed.
+            if ( options.outOfBagError ) std::cout << "Out-of-bag error: " << trainer.getOutOfBagError() << std::endl;
+
+            // Write the performance report, if requested.
+            if ( !options.performanceReportFile.empty() ) writePerformanceReport( trainer, options.performanceReportFile );
+        }
         std::cout << "Done (" << watch.stop() << " seconds)." << std::endl;
         const auto trainingTime = watch.getElapsedTime();
 
@@ -1,8 +1,14 @@
 #ifndef CLASSIFIERFILESTREAM_H
 #define CLASSIFIERFILESTREAM_H
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include "classifierstream.h"
 #include "fileio.h"
+#include "timing.h"
 
 namespace balsa
 {
@@ -20,11 +26,36 @@ namespace balsa
  * each dataset in the batch. If enough memory is available, consider setting
  * `maxPreload` to zero. This will cause all classifiers to be loaded into
  * memory once.
+ *
+ * With a positive `maxPreload`, classifiers are parsed ahead of time by a
+ * background thread, so that disk I/O and parsing overlap with classification
+ * instead of stalling it.
  */
 class ClassifierFileInputStream: public ClassifierInputStream
 {
 public:
 
+    /**
+     * Performance statistics collected by the stream since construction.
+     */
+    class Statistics
+    {
+    public:
+
+        Statistics():
+        m_classifiersParsed( 0 ),
+        m_bytesRead( 0 ),
+        m_parseTime( 0 ),
+        m_waitTime( 0 )
+        {
+        }
+
+        std::uint64_t      m_classifiersParsed; // Number of classifiers parsed from the file.
+        std::uint64_t      m_bytesRead;         // Number of bytes read from the file.
+        StopWatch::Seconds m_parseTime;         // Time spent parsing classifiers.
+        StopWatch::Seconds m_waitTime;          // Time next() spent blocked on the prefetcher.
+    };
+
     /**
      * Construct an open classifier input stream.
      *
@@ -36,24 +67,31 @@ public:
      * memory. Calling \c next() always return classifiers from memory, and
      * calling \c rewind() will not cause classifiers to be reloaded.
      *
-     * If set to a positive value \c N, this determines the number of
-     * classifiers that will be read from the input file and cached. Calls
-     * to \c next() will return classifiers from the cache. If the cache is
-     * empty, the next \c N classifiers will be read into the cache. Calling \c
-     * rewind() will empty the cache and reposition the input stream at the
-     * beginning.
+     * If set to a positive value \c N, a background thread reads ahead in the
+     * input file, keeping up to \c N parsed classifiers in the cache. Calls
+     * to \c next() return classifiers from the cache, blocking only when the
+     * reader has overtaken the prefetcher. Calling \c rewind() will empty the
+     * cache and reposition the input stream at the beginning.
      *
      * \param filename Name of the file to open.
      * \param maxPreload The number of classifiers to preload (cache).
+     * \param memoryMap If true, the model file is memory-mapped and parsed
+     *  classifiers are lightweight views of the mapped data (see
+     *  BalsaFileParser).
      */
-    ClassifierFileInputStream( const std::string & filename, unsigned int maxPreload = 0 ):
-    m_fileParser( filename ),
+    ClassifierFileInputStream( const std::string & filename, unsigned int maxPreload = 0, bool memoryMap = false ):
+    m_fileParser( filename, memoryMap ),
     m_maxPreload( maxPreload ),
-    m_cacheIndex( 0 )
+    m_cacheIndex( 0 ),
+    m_endOfStream( false ),
+    m_stopPrefetcher( false )
     {
         EnsembleHeader header = m_fileParser.enterEnsemble();
         m_classCount          = header.classCount;
         m_featureCount        = header.featureCount;
+
+        // With preloading enabled, keep the cache filled from a background thread.
+        if ( m_maxPreload != 0 ) startPrefetcher();
     }
 
     /**
@@ -61,6 +99,11 @@ public:
      */
     ClassifierFileInputStream( const ClassifierFileInputStream & ) = delete;
 
+    ~ClassifierFileInputStream()
+    {
+        stopPrefetcher();
+    }
+
     /**
      * Return the number of classes distinguished by the classifiers in this
      * stream.
@@ -78,15 +121,29 @@ public:
         return m_featureCount;
     }
 
+    /**
+     * Return the number of classifiers in the stream, or 0 if the number is
+     * not known. The number is only known when all classifiers are kept in
+     * memory (maxPreload set to zero); in that case, the first call loads the
+     * model file if that has not happened yet.
+     */
+    unsigned int getClassifierCount()
+    {
+        if ( m_maxPreload != 0 ) return 0;
+        if ( m_cache.empty() ) fetch();
+        return m_cache.size();
+    }
+
     /**
      * Rewind the stream to the beginning.
      */
     void rewind()
     {
-        // Flush the cache, unless *all* classifiers are being kept in memory.
+        // With preloading enabled, stop the prefetcher and flush the cache.
         if ( m_maxPreload != 0 )
         {
-            m_cache.clear();
+            stopPrefetcher();
+            m_prefetched.clear();
         }
 
         // Reset the index of the next classifier to the start of the cache.
@@ -94,6 +151,9 @@ public:
 
         // Seek to the offset of the first classifier in the model file.
         m_fileParser.reenterEnsemble();
+
+        // Resume prefetching from the start of the ensemble.
+        if ( m_maxPreload != 0 ) startPrefetcher();
     }
 
     /**
@@ -102,15 +162,30 @@ public:
      */
     Classifier::SharedPointer next()
     {
-        // Fetch more classifiers if necessary.
-        if ( m_cacheIndex == m_cache.size() )
+        // With preloading enabled, take the next classifier from the prefetch cache.
+        if ( m_maxPreload != 0 )
         {
-            if ( m_maxPreload != 0 || m_cache.empty() )
-            {
-                fetch();
-            }
+            // Wait until the prefetcher has delivered a classifier, or has
+            // reached the end of the stream.
+            std::unique_lock<std::mutex> lock( m_mutex );
+            StopWatch                    watch;
+            watch.start();
+            while ( m_prefetched.empty() && !m_endOfStream ) m_notEmpty.wait( lock );
+            m_statistics.m_waitTime += watch.stop();
+
+            // Return an empty shared pointer if there are no more classifiers.
+            if ( m_prefetched.empty() ) return Classifier::SharedPointer();
+
+            // Pop and return the first classifier, making room for the prefetcher.
+            auto classifier = m_prefetched.front();
+            m_prefetched.pop_front();
+            m_notFull.notify_one();
+            return classifier;
         }
 
+        // Without preloading, all classifiers are kept in memory. Load them on first use.
+        if ( m_cache.empty() ) fetch();
+
         // Return the next classifier from the stream, or and empty shared pointer if
         // there are no more classifiers.
         if ( m_cacheIndex == m_cache.size() )
@@ -123,32 +198,81 @@ public:
         }
     }
 
+    /**
+     * Return the performance statistics collected since construction.
+     *
+     * This is intended to be called when no classification run is in
+     * progress, because the byte count is taken from the file parser, which
+     * the prefetch thread may still be using otherwise.
+     */
+    Statistics getStatistics()
+    {
+        std::lock_guard<std::mutex> lock( m_mutex );
+        Statistics statistics          = m_statistics;
+        statistics.m_classifiersParsed = m_fileParser.getClassifiersParsed();
+        statistics.m_bytesRead         = m_fileParser.getBytesRead();
+        return statistics;
+    }
+
 private:
 
     void fetch()
     {
-        // Flush the cache and reset the index of the next classifier to the start of
-        // the cache.
-        m_cache.clear();
-        m_cacheIndex = 0;
+        // Read all classifiers from the model file into the cache.
+        StopWatch watch;
+        watch.start();
+        while ( m_fileParser.atClassifier() ) m_cache.push_back( m_fileParser.parseClassifier() );
+        m_statistics.m_parseTime += watch.stop();
+    }
 
-        // If the model file contains no more classifiers, do nothing.
-        if ( !m_fileParser.atTree() )
+    void startPrefetcher()
+    {
+        // Launch a thread that keeps the cache filled.
+        assert( !m_prefetchThread.joinable() );
+        m_endOfStream    = false;
+        m_stopPrefetcher = false;
+        m_prefetchThread = std::thread( &ClassifierFileInputStream::prefetchLoop, this );
+    }
+
+    void stopPrefetcher()
+    {
+        // Tell the prefetch thread to finish, and wait for it to join.
+        if ( !m_prefetchThread.joinable() ) return;
         {
-            return;
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_stopPrefetcher = true;
         }
+        m_notFull.notify_all();
+        m_prefetchThread.join();
+    }
 
-        // Read classifiers into the cache, up to the maximum number of
-        // classifiers to preload.
-        while ( m_maxPreload == 0 || m_cache.size() < m_maxPreload )
+    void prefetchLoop()
+    {
+        while ( true )
         {
-            if ( !m_fileParser.atTree() )
+            // Parse the next classifier. The file parser is touched by this
+            // thread only, for as long as the prefetcher runs.
+            Classifier::SharedPointer classifier;
+            StopWatch                 watch;
+            watch.start();
+            if ( m_fileParser.atClassifier() ) classifier = m_fileParser.parseClassifier();
+            watch.stop();
+
+            // Mark the end of the stream when there are no more classifiers.
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_statistics.m_parseTime += watch.getElapsedTime();
+            if ( !classifier )
             {
-                break;
+                m_endOfStream = true;
+                m_notEmpty.notify_all();
+                return;
             }
 
-            auto classifier = m_fileParser.parseClassifier();
-            m_cache.push_back( classifier );
+            // Wait for room in the cache, and append the classifier.
+            while ( m_prefetched.size() >= m_maxPreload && !m_stopPrefetcher ) m_notFull.wait( lock );
+            if ( m_stopPrefetcher ) return;
+            m_prefetched.push_back( classifier );
+            m_notEmpty.notify_one();
         }
     }
 
@@ -158,6 +282,14 @@ private:
     unsigned int                           m_featureCount;
     std::size_t                            m_cacheIndex;
     std::vector<Classifier::SharedPointer> m_cache;
+    std::deque<Classifier::SharedPointer>  m_prefetched;
+    std::thread                            m_prefetchThread;
+    mutable std::mutex                     m_mutex;
+    std::condition_variable                m_notEmpty;
+    std::condition_variable                m_notFull;
+    bool                                   m_endOfStream;
+    bool                                   m_stopPrefetcher;
+    Statistics                             m_statistics;
 };
 
 class EnsembleFileOutputStream: public ClassifierOutputStream
@@ -193,6 +325,15 @@ public:
         close();
     }
 
+    /**
+     * Enable or disable the compressed node encoding for the trees written to
+     * this stream (see BalsaFileWriter::setCompressedTrees()).
+     */
+    void setCompressedTrees( bool enabled )
+    {
+        m_fileWriter.setCompressedTrees( enabled );
+    }
+
 private:
 
     /**
@@ -2,6 +2,7 @@
 #define CLASSIFIERSTREAM_H
 
 #include <cassert>
+#include <vector>
 
 #include "classifier.h"
 
@@ -35,6 +36,15 @@ public:
      */
     virtual unsigned int getFeatureCount() const = 0;
 
+    /**
+     * Return the number of classifiers in this stream, or 0 if the number is
+     * not known in advance (e.g. for a file that is parsed incrementally).
+     */
+    virtual unsigned int getClassifierCount()
+    {
+        return 0;
+    }
+
     /**
      * Rewind the stream to the beginning.
      */
@@ -47,6 +57,81 @@ public:
     virtual Classifier::SharedPointer next() = 0;
 };
 
+/**
+ * A classifier input stream that iterates over an in-memory vector of
+ * classifiers.
+ *
+ * The stream holds a reference to the vector, so several instances can share
+ * one resident copy of an ensemble. This allows e.g. multiple threads to
+ * stream over the same loaded forest independently, each through its own
+ * stream instance.
+ */
+class ClassifierVectorInputStream: public ClassifierInputStream
+{
+public:
+
+    /**
+     * Construct a stream that iterates over a vector of classifiers.
+     *
+     * The vector must be non-empty, and must outlive the stream.
+     */
+    ClassifierVectorInputStream( const std::vector<Classifier::SharedPointer> & classifiers ):
+    m_classifiers( classifiers ),
+    m_index( 0 )
+    {
+        assert( !classifiers.empty() );
+    }
+
+    /**
+     * Return the number of classes distinguished by the classifiers in this
+     * stream.
+     */
+    unsigned int getClassCount() const
+    {
+        return m_classifiers.front()->getClassCount();
+    }
+
+    /**
+     * Return the number of features expected by the classifiers in this
+     * stream.
+     */
+    unsigned int getFeatureCount() const
+    {
+        return m_classifiers.front()->getFeatureCount();
+    }
+
+    /**
+     * Return the number of classifiers in this stream.
+     */
+    unsigned int getClassifierCount()
+    {
+        return m_classifiers.size();
+    }
+
+    /**
+     * Rewind the stream to the beginning.
+     */
+    void rewind()
+    {
+        m_index = 0;
+    }
+
+    /**
+     * Return the next classifier in the stream, or an empty shared pointer when
+     * the end of the stream has been reached.
+     */
+    Classifier::SharedPointer next()
+    {
+        if ( m_index == m_classifiers.size() ) return Classifier::SharedPointer();
+        return m_classifiers[m_index++];
+    }
+
+private:
+
+    const std::vector<Classifier::SharedPointer> & m_classifiers;
+    std::size_t                                    m_index;
+};
+
 /**
  * Abstract interface of a class that can consume a series classifiers.
  */
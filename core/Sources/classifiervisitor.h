@@ -1,6 +1,10 @@
 #ifndef CLASSIFIERVISITOR_H
 #define CLASSIFIERVISITOR_H
 
+#include <cstdint>
+
+#include "exceptions.h"
+
 namespace balsa
 {
 
@@ -8,6 +12,8 @@ namespace balsa
 class EnsembleClassifier;
 template <typename FeatureType>
 class DecisionTreeClassifier;
+template <typename FeatureType>
+class CompiledForestClassifier;
 
 /**
  * Base class for visiting Classifiers.
@@ -23,6 +29,36 @@ public:
     virtual void visit( const EnsembleClassifier & classifier )             = 0;
     virtual void visit( const DecisionTreeClassifier<float> & classifier )  = 0;
     virtual void visit( const DecisionTreeClassifier<double> & classifier ) = 0;
+
+    /**
+     * Visits for decision trees over integral, quantized feature codes.
+     * Such trees only exist as a training-time intermediate (see
+     * FeatureQuantizer), so visitors do not need to support them.
+     */
+    virtual void visit( const DecisionTreeClassifier<uint8_t> & )
+    {
+        throw ClientError( "Decision trees over quantized feature codes are not supported by this operation." );
+    }
+
+    virtual void visit( const DecisionTreeClassifier<uint16_t> & )
+    {
+        throw ClientError( "Decision trees over quantized feature codes are not supported by this operation." );
+    }
+
+    /**
+     * Visits for compiled forest classifiers (see CompiledForestClassifier).
+     * Compiled forests support plain classification only, so most operations
+     * do not need to support them.
+     */
+    virtual void visit( const CompiledForestClassifier<float> & )
+    {
+        throw ClientError( "Compiled forests are not supported by this operation." );
+    }
+
+    virtual void visit( const CompiledForestClassifier<double> & )
+    {
+        throw ClientError( "Compiled forests are not supported by this operation." );
+    }
 };
 
 } // namespace balsa
@@ -0,0 +1,416 @@
+#ifndef COMPILEDFORESTCLASSIFIER_H
+#define COMPILEDFORESTCLASSIFIER_H
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "classifier.h"
+#include "classifiervisitor.h"
+#include "datatypes.h"
+#include "decisiontreeclassifier.h"
+#include "exceptions.h"
+#include "iteratortools.h"
+
+namespace balsa
+{
+
+// Forward declaration.
+class BalsaFileParser;
+
+// Forward declaration.
+class BalsaFileWriter;
+
+// Forward declaration.
+class ForestCompiler;
+
+/**
+ * An inference-optimized representation of an ensemble of decision trees.
+ *
+ * A compiled forest holds the flattened node tables of all trees of an
+ * ensemble packed consecutively, with same-label subtrees collapsed into
+ * single leaves, and with each leaf carrying a precomputed vote increment
+ * into which the class weights have been folded at compile time (see
+ * ForestCompiler). Classification evaluates all trees in one pass over the
+ * packed tables, accumulating the weighted scores directly, so there is no
+ * per-tree dispatch, no vote table, and no separate weighting step.
+ *
+ * The one-time compilation trades generality for per-point inference cost:
+ * compiled forests support plain classification only. Per-class vote counts
+ * and vote fractions are not available, because the individual trees no
+ * longer vote; keep the original model file for operations that need them.
+ */
+template <typename FeatureType>
+class CompiledForestClassifier: public Classifier
+{
+public:
+
+    typedef std::shared_ptr<CompiledForestClassifier>       SharedPointer;
+    typedef std::shared_ptr<const CompiledForestClassifier> ConstSharedPointer;
+
+    static_assert( std::is_arithmetic<FeatureType>::value, "Feature type should be an integral or floating point type." );
+
+    /**
+     * Returns the number of classes distinguished by the classifier.
+     */
+    unsigned int getClassCount() const
+    {
+        return m_classCount;
+    }
+
+    /**
+     * Returns the number of features the classifier expects.
+     */
+    unsigned int getFeatureCount() const
+    {
+        return m_featureCount;
+    }
+
+    /**
+     * Returns the number of trees that were compiled into this forest.
+     */
+    unsigned int getTreeCount() const
+    {
+        return m_treeRoots.getRowCount();
+    }
+
+    /**
+     * Returns the total number of nodes in the packed node tables.
+     */
+    unsigned int getNodeCount() const
+    {
+        return m_leftChildID.getRowCount();
+    }
+
+    /**
+     * Accept a visitor.
+     */
+    void visit( ClassifierVisitor & visitor ) const
+    {
+        visitor.visit( *this );
+    }
+
+    /**
+     * Bulk-classifies a sequence of data points.
+     */
+    template <typename FeatureIterator, typename LabelOutputIterator>
+    void classify( FeatureIterator pointsStart, FeatureIterator pointsEnd, LabelOutputIterator labelsStart ) const
+    {
+        classifyWeighted( pointsStart, pointsEnd, labelsStart, std::vector<float>( m_classCount, 1.0 ) );
+    }
+
+    /**
+     * Bulk-classifies a sequence of data points, applying an additional weight
+     * to the accumulated score of each class before selecting the label.
+     *
+     * The given weights are applied on top of the class weights that were
+     * folded into the leaf vote increments at compile time; pass unit weights
+     * to classify with the compiled weights alone.
+     *
+     * \pre There must be a weight for each class, and the weights must be
+     *  non-negative.
+     */
+    template <typename FeatureIterator, typename LabelOutputIterator>
+    void classifyWeighted( FeatureIterator pointsStart, FeatureIterator pointsEnd, LabelOutputIterator labelsStart, const std::vector<float> & classWeights ) const
+    {
+        // Statically check that the FeatureIterator points to an arithmetical type.
+        typedef std::remove_cv_t<typename iterator_value_type<FeatureIterator>::type> FeatureIteratedType;
+        static_assert( std::is_arithmetic<FeatureIteratedType>::value, "Features must be of an integral or floating point type." );
+
+        // Check the dimensions of the input data.
+        auto entryCount = std::distance( pointsStart, pointsEnd );
+        assert( m_featureCount > 0 );
+        assert( classWeights.size() == m_classCount );
+        if ( entryCount % m_featureCount ) throw ClientError( "Malformed dataset." );
+
+        // Determine the number of points in the input data.
+        const std::size_t pointCount = entryCount / m_featureCount;
+
+        // Walk fixed-size blocks of points through the packed node tables,
+        // accumulating the precomputed weighted vote increments of the leaves
+        // (see DecisionTreeClassifier for the single-tree analog of this
+        // traversal strategy).
+        const std::size_t     treeCount  = m_treeRoots.getRowCount();
+        constexpr std::size_t BLOCK_SIZE = 256;
+        NodeID                currentNodeIDs[BLOCK_SIZE];
+        std::vector<float>    scores( BLOCK_SIZE * m_classCount );
+        for ( std::size_t blockStart = 0; blockStart < pointCount; blockStart += BLOCK_SIZE )
+        {
+            // Reset the accumulated class scores of the block.
+            const std::size_t blockSize = std::min( BLOCK_SIZE, pointCount - blockStart );
+            std::fill( scores.begin(), scores.begin() + blockSize * m_classCount, 0.0f );
+
+            // Let each tree add its leaf vote increments to the class scores.
+            for ( std::size_t tree = 0; tree < treeCount; ++tree )
+            {
+                // Start all points in the block at the root node of the tree.
+                std::fill( currentNodeIDs, currentNodeIDs + blockSize, m_treeRoots( tree, 0 ) );
+
+                // Advance all points in the block by one level, until all points have reached a leaf node.
+                bool anyInteriorNodes = true;
+                while ( anyInteriorNodes )
+                {
+                    anyInteriorNodes = false;
+                    for ( std::size_t point = 0; point < blockSize; ++point )
+                    {
+                        // Points that have reached a leaf node stay there.
+                        const NodeID currentNodeID = currentNodeIDs[point];
+                        const NodeID leftChildID   = m_leftChildID( currentNodeID, 0 );
+                        if ( leftChildID == 0 ) continue;
+                        anyInteriorNodes = true;
+
+                        // Select the left- or right child node by comparing the feature value against the split value.
+                        const auto featureID  = m_splitFeatureID( currentNodeID, 0 );
+                        const auto splitValue = m_splitValue( currentNodeID, 0 );
+                        const bool goLeft     = pointsStart[( blockStart + point ) * m_featureCount + featureID] < splitValue;
+                        currentNodeIDs[point] = goLeft ? leftChildID : m_rightChildID( currentNodeID, 0 );
+                    }
+                }
+
+                // Add the precomputed weighted vote increment of each leaf.
+                for ( std::size_t point = 0; point < blockSize; ++point )
+                {
+                    const NodeID leaf = currentNodeIDs[point];
+                    scores[point * m_classCount + m_label( leaf, 0 )] += m_voteWeight( leaf, 0 );
+                }
+            }
+
+            // Select the class with the highest weighted score for each point.
+            // Ties resolve to the lowest class, matching
+            // Table::getColumnOfWeightedRowMaximum().
+            for ( std::size_t point = 0; point < blockSize; ++point )
+            {
+                const float * pointScores = scores.data() + point * m_classCount;
+                double        topScore    = 0;
+                std::size_t   topColumn   = 0;
+                for ( std::size_t column = 0; column < m_classCount; ++column )
+                {
+                    float score = pointScores[column] * classWeights[column];
+                    if ( score <= topScore ) continue;
+                    topColumn = column;
+                    topScore  = score;
+                }
+                *labelsStart++ = static_cast<Label>( topColumn );
+            }
+        }
+    }
+
+private:
+
+    CompiledForestClassifier( unsigned int classCount, unsigned int featureCount ):
+    m_classCount( classCount ),
+    m_featureCount( featureCount )
+    {
+    }
+
+    friend class BalsaFileParser;
+
+    friend class BalsaFileWriter;
+
+    friend class ForestCompiler;
+
+    unsigned int       m_classCount;
+    unsigned int       m_featureCount;
+    Table<NodeID>      m_treeRoots;      // Root node of each compiled tree.
+    Table<NodeID>      m_leftChildID;    // Child IDs index the packed tables; 0 marks a leaf.
+    Table<NodeID>      m_rightChildID;
+    Table<FeatureID>   m_splitFeatureID;
+    Table<FeatureType> m_splitValue;
+    Table<Label>       m_label;
+    Table<float>       m_voteWeight; // Precomputed weighted vote increment of each leaf.
+
+    // Keeps externally owned storage (e.g. a memory-mapped model file) alive
+    // for as long as the node tables refer to it. Empty when the node tables
+    // own their data.
+    std::shared_ptr<const void> m_backingStore;
+};
+
+/**
+ * A Visitor that compiles a stream of decision tree classifiers into a single
+ * CompiledForestClassifier.
+ *
+ * Each visited tree is packed onto the end of the shared node tables in
+ * breadth-first node order, with subtrees whose leaves all carry the same
+ * label collapsed into a single leaf (see DecisionTreeClassifier::prune() and
+ * reorderBreadthFirst(), which the compilation subsumes). The class weight of
+ * each leaf label is folded into the vote increment the leaf carries, so the
+ * compiled forest applies the weights without a separate weighting pass.
+ */
+class ForestCompiler: public ClassifierVisitor
+{
+public:
+
+    /**
+     * Creates a forest compiler.
+     * \param classWeights Class weights to fold into the leaf vote increments.
+     *  If empty, all classes receive unit weight.
+     * \pre The weights, if given, must be non-negative, and there must be a
+     *  weight for each class of the visited trees.
+     */
+    ForestCompiler( const std::vector<float> & classWeights = std::vector<float>() ):
+    m_classWeights( classWeights ),
+    m_classCount( 0 ),
+    m_featureCount( 0 ),
+    m_doubleFeatures( false )
+    {
+        for ( auto w : m_classWeights ) assert( w >= 0 );
+    }
+
+    void visit( const EnsembleClassifier & )
+    {
+        throw ClientError( "Nested ensembles cannot be compiled." );
+    }
+
+    void visit( const DecisionTreeClassifier<float> & classifier )
+    {
+        if ( m_doubleFeatures ) throw ClientError( "All trees in a compiled forest must use the same feature type." );
+        append( classifier, m_floatSplitValues );
+    }
+
+    void visit( const DecisionTreeClassifier<double> & classifier )
+    {
+        if ( m_classCount != 0 && !m_doubleFeatures ) throw ClientError( "All trees in a compiled forest must use the same feature type." );
+        m_doubleFeatures = true;
+        append( classifier, m_doubleSplitValues );
+    }
+
+    /**
+     * Returns the compiled forest containing all visited trees.
+     * \pre At least one tree has been visited.
+     */
+    Classifier::SharedPointer getResult() const
+    {
+        if ( m_classCount == 0 ) throw ClientError( "There are no trees to compile." );
+        if ( m_doubleFeatures ) return buildResult( m_doubleSplitValues );
+        return buildResult( m_floatSplitValues );
+    }
+
+private:
+
+    /**
+     * Pack the nodes of a tree onto the end of the accumulated node tables,
+     * in breadth-first order, with same-label subtrees collapsed into leaves.
+     */
+    template <typename FeatureType>
+    void append( const DecisionTreeClassifier<FeatureType> & tree, std::vector<FeatureType> & splitValues )
+    {
+        // Establish the class- and feature count from the first tree, and
+        // check subsequent trees against them.
+        if ( m_classCount == 0 )
+        {
+            m_classCount   = tree.getClassCount();
+            m_featureCount = tree.getFeatureCount();
+            if ( m_classWeights.empty() ) m_classWeights.resize( m_classCount, 1.0 );
+            if ( m_classWeights.size() != m_classCount ) throw ClientError( "There must be a class weight for each class." );
+        }
+        if ( tree.getClassCount() != m_classCount ) throw ClientError( "All trees in a compiled forest must have the same class count." );
+        if ( tree.getFeatureCount() != m_featureCount ) throw ClientError( "All trees in a compiled forest must have the same feature count." );
+
+        // Determine for each node whether all the leaves below it carry one
+        // label, and if so, which. Children are created after their parents,
+        // so a reverse scan over the node tables visits children first (as in
+        // DecisionTreeClassifier::prune()).
+        const NodeID       nodeCount = tree.m_leftChildID.getRowCount();
+        std::vector<bool>  collapsible( nodeCount );
+        std::vector<Label> collapsedLabel( nodeCount );
+        for ( NodeID node = nodeCount; node-- > 0; )
+        {
+            const NodeID leftChildID = tree.m_leftChildID( node, 0 );
+            if ( leftChildID == 0 )
+            {
+                collapsible[node]    = true;
+                collapsedLabel[node] = tree.m_label( node, 0 );
+                continue;
+            }
+            const NodeID rightChildID = tree.m_rightChildID( node, 0 );
+            collapsible[node]         = collapsible[leftChildID] && collapsible[rightChildID] && ( collapsedLabel[leftChildID] == collapsedLabel[rightChildID] );
+            collapsedLabel[node]      = collapsedLabel[leftChildID];
+        }
+
+        // Walk the remaining nodes in breadth-first order, treating
+        // collapsible nodes as leaves, so the nodes below them are dropped.
+        std::vector<NodeID> oldIDs;
+        oldIDs.reserve( nodeCount );
+        oldIDs.push_back( NodeID( 0 ) );
+        for ( std::size_t walked = 0; walked < oldIDs.size(); ++walked )
+        {
+            const NodeID oldID = oldIDs[walked];
+            if ( collapsible[oldID] ) continue;
+            oldIDs.push_back( tree.m_leftChildID( oldID, 0 ) );
+            oldIDs.push_back( tree.m_rightChildID( oldID, 0 ) );
+        }
+
+        // Append the packed nodes to the accumulated tables. The position of
+        // a node in the walk, offset by the nodes packed so far, is its new
+        // node ID, and children were enqueued in left-to-right order.
+        const NodeID offset      = m_leftChildIDs.size();
+        const NodeID packedCount = oldIDs.size();
+        m_treeRoots.push_back( offset );
+        for ( NodeID newID = 0, nextChildID = 1; newID < packedCount; ++newID )
+        {
+            // Collapsible nodes become leaves carrying the one label of their
+            // subtree, and the precomputed weighted vote increment.
+            const NodeID oldID = oldIDs[newID];
+            if ( collapsible[oldID] )
+            {
+                const Label label = collapsedLabel[oldID];
+                m_leftChildIDs.push_back( 0 );
+                m_rightChildIDs.push_back( 0 );
+                m_splitFeatureIDs.push_back( 0 );
+                splitValues.push_back( 0 );
+                m_labels.push_back( label );
+                m_voteWeights.push_back( m_classWeights[label] );
+                continue;
+            }
+
+            // Other interior nodes keep their split, with renumbered children.
+            m_leftChildIDs.push_back( offset + nextChildID++ );
+            m_rightChildIDs.push_back( offset + nextChildID++ );
+            m_splitFeatureIDs.push_back( tree.m_splitFeatureID( oldID, 0 ) );
+            splitValues.push_back( tree.m_splitValue( oldID, 0 ) );
+            m_labels.push_back( 0 );
+            m_voteWeights.push_back( 0 );
+        }
+    }
+
+    /**
+     * Create a compiled forest classifier from the accumulated node tables.
+     */
+    template <typename FeatureType>
+    Classifier::SharedPointer buildResult( const std::vector<FeatureType> & splitValues ) const
+    {
+        typename CompiledForestClassifier<FeatureType>::SharedPointer result( new CompiledForestClassifier<FeatureType>( m_classCount, m_featureCount ) );
+        result->m_treeRoots      = Table<NodeID>( m_treeRoots.size(), 1 );
+        result->m_leftChildID    = Table<NodeID>( m_leftChildIDs.size(), 1 );
+        result->m_rightChildID   = Table<NodeID>( m_rightChildIDs.size(), 1 );
+        result->m_splitFeatureID = Table<FeatureID>( m_splitFeatureIDs.size(), 1 );
+        result->m_splitValue     = Table<FeatureType>( splitValues.size(), 1 );
+        result->m_label          = Table<Label>( m_labels.size(), 1 );
+        result->m_voteWeight     = Table<float>( m_voteWeights.size(), 1 );
+        std::copy( m_treeRoots.begin(), m_treeRoots.end(), result->m_treeRoots.begin() );
+        std::copy( m_leftChildIDs.begin(), m_leftChildIDs.end(), result->m_leftChildID.begin() );
+        std::copy( m_rightChildIDs.begin(), m_rightChildIDs.end(), result->m_rightChildID.begin() );
+        std::copy( m_splitFeatureIDs.begin(), m_splitFeatureIDs.end(), result->m_splitFeatureID.begin() );
+        std::copy( splitValues.begin(), splitValues.end(), result->m_splitValue.begin() );
+        std::copy( m_labels.begin(), m_labels.end(), result->m_label.begin() );
+        std::copy( m_voteWeights.begin(), m_voteWeights.end(), result->m_voteWeight.begin() );
+        return result;
+    }
+
+    std::vector<float>     m_classWeights;
+    unsigned int           m_classCount;
+    unsigned int           m_featureCount;
+    bool                   m_doubleFeatures;
+    std::vector<NodeID>    m_treeRoots;
+    std::vector<NodeID>    m_leftChildIDs;
+    std::vector<NodeID>    m_rightChildIDs;
+    std::vector<FeatureID> m_splitFeatureIDs;
+    std::vector<float>     m_floatSplitValues;
+    std::vector<double>    m_doubleSplitValues;
+    std::vector<Label>     m_labels;
+    std::vector<float>     m_voteWeights;
+};
+
+} // namespace balsa
+
+#endif // COMPILEDFORESTCLASSIFIER_H
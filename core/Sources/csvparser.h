@@ -1,6 +1,184 @@
+#ifndef CSVPARSER_H
+#define CSVPARSER_H
+
+#include <charconv>
+#include <cstring>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "exceptions.h"
+#include "fileio.h"
 #include "genericparser.h"
+#include "table.h"
 
 namespace balsa
 {
 
+/**
+ * Parse a CSV file into a Table at high throughput.
+ *
+ * The file is memory-mapped and split into chunks at line boundaries, and the
+ * chunks are parsed concurrently, using fast, locale-independent value
+ * conversion. The accepted format is the same as that of parseCSV():
+ * comma-separated values, with optional blank- and whitespace-only lines, and
+ * rows of equal length.
+ *
+ * \param filename Name of the file to parse.
+ * \param threadCount The number of threads used to parse the file.
+ */
+template <typename CellType>
+Table<CellType> parseCSVFile( const std::string & filename, unsigned int threadCount = 1 )
+{
+    if ( threadCount == 0 ) threadCount = 1;
+
+    // Map the file into memory.
+    MappedFile         file( filename );
+    const char * const fileStart = file.getData();
+    const char * const fileEnd   = fileStart + file.getSize();
+
+    // Whitespace that may surround values. Newlines are row separators.
+    auto isSpace = []( char c )
+    {
+        return c == ' ' || c == '\t' || c == '\r';
+    };
+
+    // Determine the column count from the first line that contains data.
+    std::size_t columnCount = 0;
+    for ( const char * scan = fileStart; scan != fileEnd; )
+    {
+        const char * lineEnd = static_cast<const char *>( std::memchr( scan, '\n', fileEnd - scan ) );
+        if ( !lineEnd ) lineEnd = fileEnd;
+        bool        blank      = true;
+        std::size_t separators = 0;
+        for ( const char * c = scan; c != lineEnd; ++c )
+        {
+            if ( *c == ',' ) ++separators;
+            if ( !isSpace( *c ) ) blank = false;
+        }
+        if ( !blank )
+        {
+            columnCount = separators + 1;
+            break;
+        }
+        scan = ( lineEnd == fileEnd ) ? fileEnd : lineEnd + 1;
+    }
+    if ( columnCount == 0 ) throw ParseError( "No data in CSV file." );
+
+    // Split the file into chunks of roughly equal size, snapping each chunk
+    // boundary forward to the next line boundary.
+    std::vector<const char *> chunkBounds;
+    chunkBounds.push_back( fileStart );
+    for ( unsigned int i = 1; i < threadCount; ++i )
+    {
+        const char * boundary = fileStart + ( file.getSize() * i ) / threadCount;
+        if ( boundary < chunkBounds.back() ) boundary = chunkBounds.back();
+        const char * newline = static_cast<const char *>( std::memchr( boundary, '\n', fileEnd - boundary ) );
+        chunkBounds.push_back( newline ? newline + 1 : fileEnd );
+    }
+    chunkBounds.push_back( fileEnd );
+
+    // Count the number of data rows in each chunk.
+    auto countRows = [&isSpace]( const char * start, const char * end, std::size_t & rows )
+    {
+        std::size_t count = 0;
+        for ( const char * scan = start; scan < end; )
+        {
+            const char * lineEnd = static_cast<const char *>( std::memchr( scan, '\n', end - scan ) );
+            if ( !lineEnd ) lineEnd = end;
+            for ( const char * c = scan; c != lineEnd; ++c )
+            {
+                if ( isSpace( *c ) ) continue;
+                ++count;
+                break;
+            }
+            scan = lineEnd + 1;
+        }
+        rows = count;
+    };
+    std::vector<std::size_t> chunkRows( threadCount, 0 );
+    {
+        std::vector<std::thread> threads;
+        for ( unsigned int i = 0; i < threadCount; ++i )
+            threads.push_back( std::thread( countRows, chunkBounds[i], chunkBounds[i + 1], std::ref( chunkRows[i] ) ) );
+        for ( auto & thread : threads ) thread.join();
+    }
+
+    // Compute the row at which each chunk starts, and the total row count.
+    std::vector<std::size_t> chunkFirstRow( threadCount );
+    std::size_t              rowCount = 0;
+    for ( unsigned int i = 0; i < threadCount; ++i )
+    {
+        chunkFirstRow[i] = rowCount;
+        rowCount += chunkRows[i];
+    }
+
+    // Parse each chunk directly into its own range of rows in the table.
+    Table<CellType> result( rowCount, columnCount );
+    auto            parseChunk = [&isSpace, columnCount]( const char * start, const char * end, CellType * destination, std::exception_ptr & error )
+    {
+        try
+        {
+            for ( const char * scan = start; scan < end; )
+            {
+                const char * lineEnd = static_cast<const char *>( std::memchr( scan, '\n', end - scan ) );
+                if ( !lineEnd ) lineEnd = end;
+
+                // Skip lines that contain no data.
+                const char * cursor = scan;
+                while ( cursor != lineEnd && isSpace( *cursor ) ) ++cursor;
+                scan = lineEnd + 1;
+                if ( cursor == lineEnd ) continue;
+
+                // Parse the values on the line.
+                std::size_t column = 0;
+                while ( true )
+                {
+                    if ( column == columnCount ) throw ParseError( "CSV rows must be of equal length." );
+
+                    // Parse a value. N.B. std::from_chars does not accept a
+                    // leading plus sign; skip it.
+                    if ( *cursor == '+' ) ++cursor;
+                    CellType value{};
+                    auto     conversion = std::from_chars( cursor, lineEnd, value );
+                    if ( conversion.ec != std::errc() ) throw ParseError( "Could not convert the input to a value of the expected type." );
+                    cursor                = conversion.ptr;
+                    destination[column++] = value;
+
+                    // Skip trailing whitespace, and stop at the end of the line.
+                    while ( cursor != lineEnd && isSpace( *cursor ) ) ++cursor;
+                    if ( cursor == lineEnd ) break;
+
+                    // Consume the separator and any whitespace that follows it.
+                    if ( *cursor != ',' ) throw ParseError( std::string( "Expected ',', got '" ) + *cursor + "'." );
+                    ++cursor;
+                    while ( cursor != lineEnd && isSpace( *cursor ) ) ++cursor;
+                }
+                if ( column != columnCount ) throw ParseError( "CSV rows must be of equal length." );
+                destination += columnCount;
+            }
+        }
+        catch ( ... )
+        {
+            error = std::current_exception();
+        }
+    };
+    std::vector<std::exception_ptr> errors( threadCount );
+    {
+        std::vector<std::thread> threads;
+        for ( unsigned int i = 0; i < threadCount; ++i )
+            threads.push_back( std::thread( parseChunk, chunkBounds[i], chunkBounds[i + 1], result.begin() + chunkFirstRow[i] * columnCount, std::ref( errors[i] ) ) );
+        for ( auto & thread : threads ) thread.join();
+    }
+
+    // Propagate the first error that occurred in any of the threads.
+    for ( auto & error : errors )
+        if ( error ) std::rethrow_exception( error );
+
+    return result;
+}
+
 } // namespace balsa
+
+#endif // CSVPARSER_H
@@ -30,6 +30,14 @@ public:
     {
     }
 
+    virtual unsigned int getFeatureCount() const = 0;
+
+    /**
+     * Reseed the random engine of the generator. Generating the same number
+     * of points after reseeding with the same value produces the same data.
+     */
+    virtual void seed( unsigned int seed ) = 0;
+
     virtual void generate( unsigned int pointCount, Table<FeatureType> & points, Table<Label> & labels ) = 0;
 };
 
@@ -304,6 +312,11 @@ public:
         return m_featureCount;
     }
 
+    void seed( unsigned int seed )
+    {
+        m_engine.seed( seed );
+    }
+
     virtual void generate( unsigned int pointCount, Table<FeatureType> & points, Table<Label> & labels )
     {
         // Create the tables.
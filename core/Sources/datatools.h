@@ -77,6 +77,28 @@ public:
         --m_total;
     }
 
+    /**
+     * Add an arbitrary count to the count of a label.
+     * \pre label < exclusiveUpperLimit (constructor parameter).
+     */
+    void add( Label label, std::size_t count )
+    {
+        assert( label < m_data.size() );
+        m_data[label] += count;
+        m_total += count;
+    }
+
+    /**
+     * Subtract an arbitrary count from the count of a label.
+     * \pre getCount( label ) >= count
+     */
+    void subtract( Label label, std::size_t count )
+    {
+        assert( m_data[label] >= count );
+        m_data[label] -= count;
+        m_total -= count;
+    }
+
     /**
      * Returns the stored count of a particular label.
      */
@@ -110,8 +132,9 @@ public:
     FloatType giniImpurity() const
     {
         assert( m_total > 0 );
-        auto squaredCounts = m_data * m_data;
-        return FloatType( 1.0 ) - static_cast<FloatType>( squaredCounts.sum() ) / ( m_total * m_total );
+        std::size_t squaredSum = 0;
+        for ( auto count : m_data ) squaredSum += count * count;
+        return FloatType( 1.0 ) - static_cast<FloatType>( squaredSum ) / ( m_total * m_total );
     }
 
     /**
@@ -28,7 +28,10 @@ typedef uint32_t DataPointID;
 typedef uint32_t NodeID;
 
 /**
- * A table of votes for voted classification. The index is a Label, the value a vote count.
+ * A table of votes for voted classification. The index is a Label, the value a
+ * vote count. This is the default, 32-bit wide counter table; the voting
+ * methods also accept tables of narrower unsigned counters (see
+ * EnsembleClassifier::setVoteCounterWidth()).
  */
 typedef Table<uint32_t> VoteTable;
 
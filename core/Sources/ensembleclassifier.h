@@ -1,21 +1,48 @@
 #ifndef ENSEMBLECLASSIFIER_H
 #define ENSEMBLECLASSIFIER_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <memory>
 #include <thread>
+#include <vector>
 
 #include "classifier.h"
 #include "classifierstream.h"
+#include "compiledforestclassifier.h"
 #include "datatypes.h"
 #include "decisiontreeclassifier.h"
 #include "exceptions.h"
 #include "iteratortools.h"
 #include "messagequeue.h"
+#include "timing.h"
 
 namespace balsa
 {
 
+/**
+ * An enumeration of the available strategies for dividing ensemble
+ * classification work over worker threads.
+ */
+enum class ParallelizationMode
+{
+    TREE_PARALLEL, // Each worker applies a subset of the classifiers to all points, on a private vote table.
+    DATA_PARALLEL  // Each worker applies all classifiers to its own slice of the points, on the shared vote table.
+};
+
+/**
+ * An enumeration of the available integer widths for vote counters.
+ */
+enum class VoteCounterWidth
+{
+    BITS_8,  // One byte per counter; supports ensembles of up to 255 classifiers.
+    BITS_16, // Two bytes per counter; supports ensembles of up to 65535 classifiers.
+    BITS_32  // Four bytes per counter (the default).
+};
+
 /**
  * A Visitor that invokes the classify() template method on a visited Classifier.
  */
@@ -34,6 +61,8 @@ public:
     void visit( const EnsembleClassifier & classifier );
     void visit( const DecisionTreeClassifier<float> & classifier );
     void visit( const DecisionTreeClassifier<double> & classifier );
+    void visit( const CompiledForestClassifier<float> & classifier );
+    void visit( const CompiledForestClassifier<double> & classifier );
 
 private:
 
@@ -45,12 +74,12 @@ private:
 /**
  * A Visitor that invokes the classifyAndVote() template method on a visited Classifier.
  */
-template <typename FeatureIterator>
+template <typename FeatureIterator, typename VoteCounterType>
 class ClassifyAndVoteDispatcher: public ClassifierVisitor
 {
 public:
 
-    ClassifyAndVoteDispatcher( FeatureIterator featureStart, FeatureIterator featureEnd, VoteTable & voteTable ):
+    ClassifyAndVoteDispatcher( FeatureIterator featureStart, FeatureIterator featureEnd, Table<VoteCounterType> & voteTable ):
     m_featureStart( featureStart ),
     m_featureEnd( featureEnd ),
     m_voteTable( voteTable )
@@ -63,9 +92,185 @@ public:
 
 private:
 
-    FeatureIterator m_featureStart;
-    FeatureIterator m_featureEnd;
-    VoteTable &     m_voteTable;
+    FeatureIterator          m_featureStart;
+    FeatureIterator          m_featureEnd;
+    Table<VoteCounterType> & m_voteTable;
+};
+
+/**
+ * A Visitor that classifies points through the fused fast path of a visited
+ * CompiledForestClassifier (see ForestCompiler), leaving classifiers of other
+ * kinds untouched so the caller can fall back to the vote-counting path.
+ */
+template <typename FeatureIterator, typename LabelOutputIterator>
+class CompiledClassifyDispatcher: public ClassifierVisitor
+{
+public:
+
+    CompiledClassifyDispatcher( FeatureIterator featureStart, FeatureIterator featureEnd, LabelOutputIterator labelStart, const std::vector<float> & classWeights, unsigned int maxWorkerThreads, bool voteFractionsRequested ):
+    m_featureStart( featureStart ),
+    m_featureEnd( featureEnd ),
+    m_labelStart( labelStart ),
+    m_classWeights( classWeights ),
+    m_maxWorkerThreads( maxWorkerThreads ),
+    m_voteFractionsRequested( voteFractionsRequested ),
+    m_handled( false ),
+    m_treesApplied( 0 )
+    {
+    }
+
+    void visit( const EnsembleClassifier & )
+    {
+    }
+
+    void visit( const DecisionTreeClassifier<float> & )
+    {
+    }
+
+    void visit( const DecisionTreeClassifier<double> & )
+    {
+    }
+
+    void visit( const CompiledForestClassifier<float> & classifier )
+    {
+        classify( classifier );
+    }
+
+    void visit( const CompiledForestClassifier<double> & classifier )
+    {
+        classify( classifier );
+    }
+
+    /**
+     * Returns true iff the visited classifier was a compiled forest, and the
+     * points have been classified.
+     */
+    bool isHandled() const
+    {
+        return m_handled;
+    }
+
+    /**
+     * Returns the number of compiled trees that were applied.
+     */
+    std::uint64_t getTreesApplied() const
+    {
+        return m_treesApplied;
+    }
+
+private:
+
+    template <typename FeatureType>
+    void classify( const CompiledForestClassifier<FeatureType> & classifier )
+    {
+        // The trees of a compiled forest no longer cast countable votes, so
+        // there are no vote fractions to report.
+        if ( m_voteFractionsRequested ) throw ClientError( "Vote fractions are not available for compiled models." );
+
+        // Classify on the calling thread if no workers may be created.
+        if ( m_maxWorkerThreads == 0 )
+        {
+            classifier.classifyWeighted( m_featureStart, m_featureEnd, m_labelStart, m_classWeights );
+        }
+        else
+        {
+            // Let each worker classify its own slice of the points. The
+            // slices are disjoint, so the workers share no mutable state.
+            const unsigned int featureCount = classifier.getFeatureCount();
+            const std::size_t  pointCount   = std::distance( m_featureStart, m_featureEnd ) / featureCount;
+            std::vector<std::thread>        workers;
+            std::vector<std::exception_ptr> exceptions( m_maxWorkerThreads );
+            for ( unsigned int i = 0; i < m_maxWorkerThreads; ++i )
+            {
+                const std::size_t firstPoint = ( pointCount * i ) / m_maxWorkerThreads;
+                const std::size_t lastPoint  = ( pointCount * ( i + 1 ) ) / m_maxWorkerThreads;
+                workers.push_back( std::thread(
+                    [this, &classifier, &exceptions, i, featureCount, firstPoint, lastPoint]()
+                    {
+                        try
+                        {
+                            classifier.classifyWeighted( m_featureStart + firstPoint * featureCount, m_featureStart + lastPoint * featureCount, m_labelStart + firstPoint, m_classWeights );
+                        }
+                        catch ( ... )
+                        {
+                            exceptions[i] = std::current_exception();
+                        }
+                    } ) );
+            }
+
+            // Wait for all the workers to join, and re-raise the first error.
+            for ( auto & worker : workers ) worker.join();
+            for ( auto & exception : exceptions )
+                if ( exception ) std::rethrow_exception( exception );
+        }
+
+        m_handled      = true;
+        m_treesApplied = classifier.getTreeCount();
+    }
+
+    FeatureIterator            m_featureStart;
+    FeatureIterator            m_featureEnd;
+    LabelOutputIterator        m_labelStart;
+    const std::vector<float> & m_classWeights;
+    unsigned int               m_maxWorkerThreads;
+    bool                       m_voteFractionsRequested;
+    bool                       m_handled;
+    std::uint64_t              m_treesApplied;
+};
+
+/**
+ * Reusable scratch memory for repeated bulk-classification calls.
+ *
+ * EnsembleClassifier::classify() allocates a fresh vote table on every call.
+ * For workloads that classify a long series of similarly sized chunks, that
+ * allocation (and the page faults on first touch) can rival the cost of the
+ * classification itself. Passing a session to classify() keeps the vote table
+ * alive between calls: it is allocated once for the first chunk and merely
+ * cleared for subsequent chunks of the same shape, so steady-state
+ * classification performs no heap allocations at the ensemble level. The
+ * table is reallocated transparently if the chunk shape changes.
+ *
+ * A session is not thread-safe; use one session per classifying thread.
+ */
+class ClassificationSession
+{
+private:
+
+    friend class EnsembleClassifier;
+
+    /**
+     * Returns a zeroed vote table of the requested shape, reusing the
+     * previously allocated table if the shape still matches.
+     */
+    template <typename VoteCounterType>
+    Table<VoteCounterType> & getClearedVoteTable( std::size_t rowCount, std::size_t columnCount )
+    {
+        Table<VoteCounterType> & table = getVoteTable<VoteCounterType>();
+        if ( table.getRowCount() != rowCount || table.getColumnCount() != columnCount )
+            table = Table<VoteCounterType>( rowCount, columnCount );
+        else
+            std::fill( table.begin(), table.end(), VoteCounterType( 0 ) );
+        return table;
+    }
+
+    /**
+     * Returns the cached vote table for the given counter type. Only the
+     * tables of the counter widths that are actually used occupy memory.
+     */
+    template <typename VoteCounterType>
+    Table<VoteCounterType> & getVoteTable()
+    {
+        if constexpr ( std::is_same<VoteCounterType, uint8_t>::value )
+            return m_voteCounts8;
+        else if constexpr ( std::is_same<VoteCounterType, uint16_t>::value )
+            return m_voteCounts16;
+        else
+            return m_voteCounts32;
+    }
+
+    Table<uint8_t>  m_voteCounts8;
+    Table<uint16_t> m_voteCounts16;
+    Table<uint32_t> m_voteCounts32;
 };
 
 /**
@@ -75,6 +280,28 @@ class EnsembleClassifier: public Classifier
 {
 public:
 
+    /**
+     * Performance statistics accumulated over all classification runs since
+     * construction.
+     */
+    class Statistics
+    {
+    public:
+
+        Statistics():
+        m_classifiersApplied( 0 ),
+        m_workerBusyTime( 0 ),
+        m_workerIdleTime( 0 ),
+        m_voteReductionTime( 0 )
+        {
+        }
+
+        std::uint64_t      m_classifiersApplied; // Number of classifiers that have voted.
+        StopWatch::Seconds m_workerBusyTime;     // Total time spent applying classifiers (summed over all threads).
+        StopWatch::Seconds m_workerIdleTime;     // Total time the worker threads spent waiting for jobs.
+        StopWatch::Seconds m_voteReductionTime;  // Time spent adding per-worker vote tables to the shared total.
+    };
+
     /**
      * Creates an ensemble classifier.
      * \param classifierStream A resettable stream of classifiers to apply.
@@ -83,6 +310,9 @@ public:
     EnsembleClassifier( ClassifierInputStream & classifierStream, unsigned int maxWorkerThreads = 0 ):
     m_classifierStreamPtr( &classifierStream ),
     m_maxWorkerThreads( maxWorkerThreads ),
+    m_parallelizationMode( ParallelizationMode::TREE_PARALLEL ),
+    m_voteCounterWidth( VoteCounterWidth::BITS_32 ),
+    m_earlyStoppingInterval( 0 ),
     m_classWeights( classifierStream.getClassCount(), 1.0 )
     {
     }
@@ -111,6 +341,88 @@ public:
         visitor.visit( *this );
     }
 
+    /**
+     * Returns the strategy used to divide multi-threaded classification work
+     * over the worker threads.
+     */
+    ParallelizationMode getParallelizationMode() const
+    {
+        return m_parallelizationMode;
+    }
+
+    /**
+     * Set the strategy used to divide multi-threaded classification work over
+     * the worker threads.
+     *
+     * In the default tree-parallel mode, each worker applies a subset of the
+     * classifiers to all points, accumulating votes in a thread-private,
+     * full-size vote table that is added to the shared total at the end. In
+     * data-parallel mode, each worker applies every classifier to its own
+     * slice of the points, voting directly into the corresponding rows of the
+     * shared vote table. The data-parallel mode allocates no per-thread
+     * tables and performs no reduction, which makes it the better choice when
+     * the number of points is large compared to the number of classifiers.
+     */
+    void setParallelizationMode( ParallelizationMode mode )
+    {
+        m_parallelizationMode = mode;
+    }
+
+    /**
+     * Returns the width of the vote counters used by classify().
+     */
+    VoteCounterWidth getVoteCounterWidth() const
+    {
+        return m_voteCounterWidth;
+    }
+
+    /**
+     * Set the width of the vote counters used by classify().
+     *
+     * Since each classifier casts at most one vote per point, narrow counters
+     * suffice for all but the largest ensembles: 8-bit counters support up to
+     * 255 classifiers, 16-bit counters up to 65535. Narrower counters shrink
+     * the vote table proportionally, reducing the memory footprint and
+     * bandwidth of classification. An exception is raised during
+     * classification if the ensemble turns out to contain more classifiers
+     * than the counters can accommodate.
+     */
+    void setVoteCounterWidth( VoteCounterWidth width )
+    {
+        m_voteCounterWidth = width;
+    }
+
+    /**
+     * Returns the interval, in classifiers, at which points are checked for
+     * early stopping, or 0 if early stopping is disabled.
+     */
+    unsigned int getEarlyStoppingInterval() const
+    {
+        return m_earlyStoppingInterval;
+    }
+
+    /**
+     * Set the interval, in classifiers, at which points are checked for early
+     * stopping during classification.
+     *
+     * At every interval, points are retired whose leading class can no longer
+     * be overtaken by any other class with the votes that remain, taking the
+     * class weights into account. Retired points are not routed through the
+     * remaining classifiers, which makes classification considerably cheaper
+     * when most points are easy to classify. The final labels are identical
+     * to those of a full evaluation. The vote counts of retired points stop
+     * accumulating, however, so the vote table will generally differ.
+     *
+     * Early stopping requires a classifier stream that knows the ensemble
+     * size in advance (see ClassifierInputStream::getClassifierCount()), and
+     * currently takes effect in the single-threaded case only. An interval of
+     * 0 (the default) disables early stopping.
+     */
+    void setEarlyStoppingInterval( unsigned int interval )
+    {
+        m_earlyStoppingInterval = interval;
+    }
+
     /**
      * Set the relative weights of each class.
      * \param classWeights Multiplication factors that will be applied to each class vote total before determining the maximum score and final label.
@@ -124,34 +436,64 @@ public:
         m_classWeights = classWeights;
     }
 
+    /**
+     * Returns the performance statistics accumulated over all classification
+     * runs since construction.
+     */
+    const Statistics & getStatistics() const
+    {
+        return m_statistics;
+    }
+
     /**
      * Bulk-classifies a sequence of data points.
      */
     template <typename FeatureIterator, typename LabelOutputIterator>
     void classify( FeatureIterator pointsStart, FeatureIterator pointsEnd, LabelOutputIterator labelsStart ) const
     {
-        // Statically check that the FeatureIterator points to an arithmetical type.
-        typedef std::remove_cv_t<typename iterator_value_type<FeatureIterator>::type> FeatureIteratedType;
-        static_assert( std::is_arithmetic<FeatureIteratedType>::value, "Features must be of an integral or floating point type." );
-
-        // Check the dimensions of the input data.
-        unsigned int featureCount = m_classifierStreamPtr->getFeatureCount();
-        auto entryCount = std::distance( pointsStart, pointsEnd );
-        assert( featureCount > 0 );
-        if ( entryCount % featureCount ) throw ClientError( "Malformed dataset." );
-
-        // Determine the number of points in the input data.
-        auto pointCount = entryCount / featureCount;
+        classifyWithSession( pointsStart, pointsEnd, labelsStart, nullptr, nullptr );
+    }
 
-        // Create a table for the label votes.
-        VoteTable voteCounts( pointCount, m_classifierStreamPtr->getClassCount() );
+    /**
+     * Bulk-classifies a sequence of data points, reusing the scratch buffers
+     * of the given session instead of allocating fresh ones (see
+     * ClassificationSession).
+     */
+    template <typename FeatureIterator, typename LabelOutputIterator>
+    void classify( FeatureIterator pointsStart, FeatureIterator pointsEnd, LabelOutputIterator labelsStart, ClassificationSession & session ) const
+    {
+        classifyWithSession( pointsStart, pointsEnd, labelsStart, nullptr, &session );
+    }
 
-        // Let all classifiers vote on the point labels.
-        classifyAndVote( pointsStart, pointsEnd, voteCounts );
+    /**
+     * Bulk-classifies a sequence of data points, also recording the fraction
+     * of the ensemble that voted for each class.
+     *
+     * The vote fractions come out of the same single pass that produces the
+     * labels, so they are essentially free compared to a separate voting run.
+     * N.B. early stopping (see setEarlyStoppingInterval()) truncates the vote
+     * counts of retired points; disable it when accurate vote fractions are
+     * required.
+     *
+     * \param voteFractions A table to receive the vote fractions. The column
+     *  count must match the number of classes, the row count must match the
+     *  number of points.
+     */
+    template <typename FeatureIterator, typename LabelOutputIterator>
+    void classify( FeatureIterator pointsStart, FeatureIterator pointsEnd, LabelOutputIterator labelsStart, Table<float> & voteFractions ) const
+    {
+        classifyWithSession( pointsStart, pointsEnd, labelsStart, &voteFractions, nullptr );
+    }
 
-        // Generate the labels.
-        for ( unsigned int point = 0; point < pointCount; ++point )
-            *labelsStart++ = static_cast<Label>( voteCounts.getColumnOfWeightedRowMaximum( point, m_classWeights ) );
+    /**
+     * Bulk-classifies a sequence of data points, recording the vote fractions
+     * and reusing the scratch buffers of the given session (see
+     * ClassificationSession).
+     */
+    template <typename FeatureIterator, typename LabelOutputIterator>
+    void classify( FeatureIterator pointsStart, FeatureIterator pointsEnd, LabelOutputIterator labelsStart, Table<float> & voteFractions, ClassificationSession & session ) const
+    {
+        classifyWithSession( pointsStart, pointsEnd, labelsStart, &voteFractions, &session );
     }
 
     /**
@@ -161,20 +503,30 @@ public:
      *  the first point.
      * \param pointsEnd An itetartor that points to the end of the block of
      *  point data.
-     * \param table A table for counting votes.
+     * \param table A table for counting votes. The cell type may be any
+     *  unsigned integral type that is wide enough to count the votes of all
+     *  classifiers in the ensemble.
      * \pre The column count of the vote table must match the number of
      *  features, the row count must match the number of points.
      */
-    template <typename FeatureIterator>
-    unsigned int classifyAndVote( FeatureIterator pointsStart, FeatureIterator pointsEnd, VoteTable & table ) const
+    template <typename FeatureIterator, typename VoteCounterType>
+    unsigned int classifyAndVote( FeatureIterator pointsStart, FeatureIterator pointsEnd, Table<VoteCounterType> & table ) const
     {
         // Statically check that the FeatureIterator points to an arithmetical type.
         typedef std::remove_cv_t<typename iterator_value_type<FeatureIterator>::type> FeatureIteratedType;
         static_assert( std::is_arithmetic<FeatureIteratedType>::value, "Features must be of an integral or floating point type." );
 
-        // Dispatch to single- or multithreaded implementation.
+        // Statically check that the vote counter type is an unsigned integral type.
+        static_assert( std::is_unsigned<VoteCounterType>::value, "The vote counter type must be an unsigned integral type." );
+
+        // Dispatch to the single- or multithreaded implementation.
         if ( m_maxWorkerThreads > 0 )
-            return classifyAndVoteMultiThreaded( pointsStart, pointsEnd, table );
+        {
+            if ( m_parallelizationMode == ParallelizationMode::DATA_PARALLEL )
+                return classifyAndVoteDataParallel( pointsStart, pointsEnd, table );
+            else
+                return classifyAndVoteMultiThreaded( pointsStart, pointsEnd, table );
+        }
         else
             return classifyAndVoteSingleThreaded( pointsStart, pointsEnd, table );
     }
@@ -193,7 +545,10 @@ protected:
      */
     explicit EnsembleClassifier():
     m_classifierStreamPtr( nullptr ),
-    m_maxWorkerThreads( 0 )
+    m_maxWorkerThreads( 0 ),
+    m_parallelizationMode( ParallelizationMode::TREE_PARALLEL ),
+    m_voteCounterWidth( VoteCounterWidth::BITS_32 ),
+    m_earlyStoppingInterval( 0 )
     {
     }
 
@@ -218,6 +573,10 @@ private:
     {
     public:
 
+        WorkerJob()
+        {
+        }
+
         WorkerJob( Classifier::ConstSharedPointer classifier ):
         m_classifier( classifier )
         {
@@ -228,21 +587,32 @@ private:
     };
 
     /**
-     * A thread that runs classifyAndVote on a thread-local vote table.
+     * A thread that runs classifyAndVote on a vote table. The table is either
+     * a thread-private table covering all points, or a writable window onto
+     * the rows of a shared table that hold the points assigned to the thread.
      */
-    template <typename FeatureIterator>
+    template <typename FeatureIterator, typename VoteCounterType>
     class WorkerThread
     {
     public:
 
         typedef std::shared_ptr<WorkerThread> SharedPointer;
 
-        WorkerThread( MessageQueue<WorkerJob> & jobQueue, unsigned int classCount, unsigned int featureCount, FeatureIterator pointsStart, FeatureIterator pointsEnd ):
+        /**
+         * Creates a worker that accumulates votes for all points in a
+         * thread-private vote table. The table itself is allocated by the
+         * worker thread, so on NUMA systems its pages are placed on the
+         * memory node of the core that runs the worker.
+         */
+        WorkerThread( BoundedMessageQueue<WorkerJob> & jobQueue, unsigned int classCount, unsigned int featureCount, FeatureIterator pointsStart, FeatureIterator pointsEnd ):
         m_running( false ),
         m_jobQueue( jobQueue ),
         m_pointsStart( pointsStart ),
         m_pointsEnd( pointsEnd ),
-        m_voteCounts( 0, 0 ) // Overwrite this below.
+        m_voteCounts( 0, 0 ), // Allocated by the worker thread, see processJobs().
+        m_classCount( classCount ),
+        m_busyTime( 0 ),
+        m_idleTime( 0 )
         {
             // Check the dimensions of the input data.
             auto entryCount = std::distance( pointsStart, pointsEnd );
@@ -250,10 +620,25 @@ private:
             assert( ( entryCount % featureCount ) == 0 );
 
             // Determine the number of points in the input data.
-            auto pointCount = entryCount / featureCount;
+            m_pointCount = entryCount / featureCount;
+        }
 
-            // Create a table for the label votes.
-            m_voteCounts = VoteTable( pointCount, classCount );
+        /**
+         * Creates a worker that accumulates votes for its own slice of the
+         * points directly in a writable window onto the shared vote table.
+         */
+        WorkerThread( BoundedMessageQueue<WorkerJob> & jobQueue, Table<VoteCounterType> voteSlice, FeatureIterator pointsStart, FeatureIterator pointsEnd ):
+        m_running( false ),
+        m_jobQueue( jobQueue ),
+        m_pointsStart( pointsStart ),
+        m_pointsEnd( pointsEnd ),
+        m_voteCounts( voteSlice ),
+        m_classCount( 0 ),
+        m_pointCount( 0 ),
+        m_busyTime( 0 ),
+        m_idleTime( 0 )
+        {
+            assert( m_voteCounts.isWindow() );
         }
 
         void start()
@@ -261,7 +646,7 @@ private:
             // Launch a thread to process incoming jobs from the job queue.
             assert( !m_running );
             m_running = true;
-            m_thread  = std::thread( &EnsembleClassifier::WorkerThread<FeatureIterator>::processJobs, this );
+            m_thread  = std::thread( &EnsembleClassifier::WorkerThread<FeatureIterator, VoteCounterType>::processJobs, this );
         }
 
         void join()
@@ -272,72 +657,385 @@ private:
             m_running = false;
         }
 
-        const VoteTable & getVoteCounts() const
+        const Table<VoteCounterType> & getVoteCounts() const
         {
             return m_voteCounts;
         }
 
+        /**
+         * Returns the time this worker spent applying classifiers.
+         * \pre The worker has been joined.
+         */
+        StopWatch::Seconds getBusyTime() const
+        {
+            return m_busyTime;
+        }
+
+        /**
+         * Returns the time this worker spent waiting for jobs.
+         * \pre The worker has been joined.
+         */
+        StopWatch::Seconds getIdleTime() const
+        {
+            return m_idleTime;
+        }
+
     private:
 
         void processJobs()
         {
-            // Process incoming jobs until the null job is received.
-            for ( WorkerJob job( m_jobQueue.receive() ); job.m_classifier; job = m_jobQueue.receive() )
+            // Allocate the thread-private vote table, unless this worker was
+            // given a window onto a shared table. Allocating it here, in the
+            // worker thread, first-touches its pages on the local memory node
+            // on NUMA systems, instead of on the node of the calling thread.
+            if ( !m_voteCounts.isWindow() ) m_voteCounts = Table<VoteCounterType>( m_pointCount, m_classCount );
+
+            // Process incoming jobs until the null job is received. Jobs are
+            // taken from the queue in small batches to reduce queue traffic.
+            StopWatch watch;
+            WorkerJob batch[8];
+            for ( bool done = false; !done; )
             {
-                // Let the classifier vote on the data. Accumulate votes in the thread-private vote table.
-                ClassifyAndVoteDispatcher voter( m_pointsStart, m_pointsEnd, m_voteCounts );
-                job.m_classifier->visit( voter );
+                watch.start();
+                const std::size_t count = m_jobQueue.receiveSome( batch, 8 );
+                m_idleTime += watch.stop();
+                for ( std::size_t i = 0; i < count; ++i )
+                {
+                    // A null job ends processing. Any jobs behind it in the
+                    // batch are stop messages for other workers; put them back.
+                    if ( !batch[i].m_classifier )
+                    {
+                        for ( std::size_t j = i + 1; j < count; ++j ) m_jobQueue.send( std::move( batch[j] ) );
+                        done = true;
+                        break;
+                    }
+
+                    // Let the classifier vote on the data. Accumulate votes in the vote table.
+                    watch.start();
+                    ClassifyAndVoteDispatcher voter( m_pointsStart, m_pointsEnd, m_voteCounts );
+                    batch[i].m_classifier->visit( voter );
+                    m_busyTime += watch.stop();
+                }
             }
         }
 
-        bool                      m_running;
-        MessageQueue<WorkerJob> & m_jobQueue;
-        FeatureIterator           m_pointsStart;
-        FeatureIterator           m_pointsEnd;
-        VoteTable                 m_voteCounts;
-        std::thread               m_thread;
+        bool                             m_running;
+        BoundedMessageQueue<WorkerJob> & m_jobQueue;
+        FeatureIterator                  m_pointsStart;
+        FeatureIterator                  m_pointsEnd;
+        Table<VoteCounterType>           m_voteCounts;
+        unsigned int                     m_classCount;
+        std::size_t                      m_pointCount;
+        std::thread                      m_thread;
+        StopWatch::Seconds               m_busyTime;
+        StopWatch::Seconds               m_idleTime;
     };
 
-    template <typename FeatureIterator>
-    unsigned int classifyAndVoteSingleThreaded( FeatureIterator pointsStart, FeatureIterator pointsEnd, VoteTable & table ) const
+    /**
+     * Check the input data and dispatch classification to the configured vote
+     * counter width, optionally recording vote fractions and/or reusing the
+     * scratch buffers of a session.
+     */
+    template <typename FeatureIterator, typename LabelOutputIterator>
+    void classifyWithSession( FeatureIterator pointsStart, FeatureIterator pointsEnd, LabelOutputIterator labelsStart, Table<float> * voteFractions, ClassificationSession * session ) const
     {
+        // Statically check that the FeatureIterator points to an arithmetical type.
+        typedef std::remove_cv_t<typename iterator_value_type<FeatureIterator>::type> FeatureIteratedType;
+        static_assert( std::is_arithmetic<FeatureIteratedType>::value, "Features must be of an integral or floating point type." );
+
+        // Check the dimensions of the input data.
+        unsigned int featureCount = m_classifierStreamPtr->getFeatureCount();
+        auto entryCount = std::distance( pointsStart, pointsEnd );
+        assert( featureCount > 0 );
+        if ( entryCount % featureCount ) throw ClientError( "Malformed dataset." );
+
+        // Determine the number of points in the input data.
+        auto pointCount = entryCount / featureCount;
+
+        // If the model consists of a single compiled forest (see
+        // ForestCompiler), classify through its fused fast path: the leaves
+        // carry precomputed weighted vote increments, so no vote table is
+        // needed. Models made of plain trees fall through to the
+        // vote-counting path below.
+        m_classifierStreamPtr->rewind();
+        auto onlyClassifier = m_classifierStreamPtr->next();
+        if ( onlyClassifier && !m_classifierStreamPtr->next() )
+        {
+            CompiledClassifyDispatcher<FeatureIterator, LabelOutputIterator> dispatcher( pointsStart, pointsEnd, labelsStart, m_classWeights, m_maxWorkerThreads, voteFractions != nullptr );
+            StopWatch                                                        watch;
+            watch.start();
+            onlyClassifier->visit( dispatcher );
+            if ( dispatcher.isHandled() )
+            {
+                m_statistics.m_workerBusyTime += watch.stop();
+                m_statistics.m_classifiersApplied += dispatcher.getTreesApplied();
+                return;
+            }
+        }
+
+        // Classify the points using vote counters of the configured width.
+        switch ( m_voteCounterWidth )
+        {
+            case VoteCounterWidth::BITS_8:
+                classifyWithVoteCounter<uint8_t>( pointsStart, pointsEnd, labelsStart, pointCount, voteFractions, session );
+                break;
+            case VoteCounterWidth::BITS_16:
+                classifyWithVoteCounter<uint16_t>( pointsStart, pointsEnd, labelsStart, pointCount, voteFractions, session );
+                break;
+            case VoteCounterWidth::BITS_32:
+                classifyWithVoteCounter<uint32_t>( pointsStart, pointsEnd, labelsStart, pointCount, voteFractions, session );
+                break;
+        }
+    }
+
+    /**
+     * Create a table of votes of the configured counter type, let all
+     * classifiers vote on the point labels, and generate the labels.
+     * Optionally, also store the fraction of the votes each class received.
+     */
+    template <typename VoteCounterType, typename FeatureIterator, typename LabelOutputIterator>
+    void classifyWithVoteCounter( FeatureIterator pointsStart, FeatureIterator pointsEnd, LabelOutputIterator labelsStart, std::size_t pointCount, Table<float> * voteFractions = nullptr, ClassificationSession * session = nullptr ) const
+    {
+        // Take the reusable vote table from the session if one was provided,
+        // otherwise allocate a fresh local table.
+        Table<VoteCounterType> localVoteCounts;
+        if ( !session ) localVoteCounts = Table<VoteCounterType>( pointCount, m_classifierStreamPtr->getClassCount() );
+        Table<VoteCounterType> & voteCounts = session ? session->getClearedVoteTable<VoteCounterType>( pointCount, m_classifierStreamPtr->getClassCount() ) : localVoteCounts;
+
+        // Let all classifiers vote on the point labels.
+        const unsigned int voterCount = classifyAndVote( pointsStart, pointsEnd, voteCounts );
+
+        // Store the fraction of the votes each class received, if requested.
+        if ( voteFractions )
+        {
+            assert( voteFractions->getRowCount() == pointCount );
+            assert( voteFractions->getColumnCount() == voteCounts.getColumnCount() );
+            const float scale    = voterCount ? 1.0f / voterCount : 0.0f;
+            auto        fraction = voteFractions->begin();
+            for ( auto vote( voteCounts.begin() ), end( voteCounts.end() ); vote != end; ++vote, ++fraction ) *fraction = *vote * scale;
+        }
+
+        // Generate the labels.
+        for ( std::size_t point = 0; point < pointCount; ++point )
+            *labelsStart++ = static_cast<Label>( voteCounts.getColumnOfWeightedRowMaximum( point, m_classWeights ) );
+    }
+
+    /**
+     * Raise an exception if one more classifier would overflow the vote
+     * counters. Since each classifier casts at most one vote per point, the
+     * number of classifiers that have voted is a safe upper bound for any
+     * counter in the table.
+     */
+    template <typename VoteCounterType>
+    static void checkVoteCounterCapacity( unsigned int voterCount )
+    {
+        if ( voterCount >= std::numeric_limits<VoteCounterType>::max() )
+            throw ClientError( "The vote counters are too narrow for the number of classifiers in the ensemble." );
+    }
+
+    template <typename FeatureIterator, typename VoteCounterType>
+    unsigned int classifyAndVoteSingleThreaded( FeatureIterator pointsStart, FeatureIterator pointsEnd, Table<VoteCounterType> & table ) const
+    {
+        // Use the early stopping cascade if it is enabled, and if the stream
+        // knows the ensemble size in advance.
+        if ( m_earlyStoppingInterval > 0 )
+        {
+            const unsigned int ensembleSize = m_classifierStreamPtr->getClassifierCount();
+            if ( ensembleSize > 0 ) return classifyAndVoteCascade( pointsStart, pointsEnd, table, ensembleSize );
+        }
+
         // Reset the stream of classifiers.
         m_classifierStreamPtr->rewind();
 
         // Apply each classifier to the data.
+        StopWatch    watch;
         unsigned int voterCount = 0;
         for ( auto classifier = m_classifierStreamPtr->next(); classifier; classifier = m_classifierStreamPtr->next(), ++voterCount )
         {
+            checkVoteCounterCapacity<VoteCounterType>( voterCount );
+            watch.start();
             ClassifyAndVoteDispatcher voter( pointsStart, pointsEnd, table );
             classifier->visit( voter );
+            m_statistics.m_workerBusyTime += watch.stop();
+        }
+
+        // Return the number of classifiers that have voted.
+        m_statistics.m_classifiersApplied += voterCount;
+        return voterCount;
+    }
+
+    /**
+     * Single-threaded classification with early stopping. At the configured
+     * interval, points whose leading class can no longer be overtaken with
+     * the remaining votes are retired, and the undecided points are gathered
+     * into compact buffers, so that the remaining classifiers only traverse
+     * the shrinking set of points that are still contested.
+     */
+    template <typename FeatureIterator, typename VoteCounterType>
+    unsigned int classifyAndVoteCascade( FeatureIterator pointsStart, FeatureIterator pointsEnd, Table<VoteCounterType> & table, unsigned int ensembleSize ) const
+    {
+        typedef std::remove_cv_t<typename iterator_value_type<FeatureIterator>::type> FeatureType;
+
+        // Reset the stream of classifiers.
+        m_classifierStreamPtr->rewind();
+
+        // Determine the number of points in the input data.
+        const unsigned int classCount   = m_classifierStreamPtr->getClassCount();
+        const unsigned int featureCount = m_classifierStreamPtr->getFeatureCount();
+        const std::size_t  pointCount   = std::distance( pointsStart, pointsEnd ) / featureCount;
+
+        // Decide whether a point is still contested: a point is undecided if
+        // any class other than the current leader could still reach the
+        // leading weighted score with the votes that remain. Ties count as
+        // undecided, because the lowest class wins a tie in the final label
+        // selection. The leader is found with the same arithmetic as
+        // Table::getColumnOfWeightedRowMaximum(), and correctly rounded
+        // multiplication is monotonic, so a retired leader is guaranteed to
+        // win the final selection as well.
+        auto isUndecided = [this, classCount]( const VoteCounterType * votes, unsigned int remaining ) -> bool
+        {
+            double       topScore  = 0;
+            unsigned int topColumn = 0;
+            for ( unsigned int column = 0; column < classCount; ++column )
+            {
+                float score = votes[column] * m_classWeights[column];
+                if ( score <= topScore ) continue;
+                topScore  = score;
+                topColumn = column;
+            }
+            for ( unsigned int column = 0; column < classCount; ++column )
+            {
+                if ( column == topColumn ) continue;
+                float challengerScore = ( votes[column] + remaining ) * m_classWeights[column];
+                if ( !( challengerScore < topScore ) ) return true;
+            }
+            return false;
+        };
+
+        // Compact buffers holding the undecided points. These are unused
+        // until the first early stopping check has been performed.
+        bool                         compacted = false;
+        std::vector<std::size_t>     activePoints;
+        std::vector<FeatureType>     activeFeatures;
+        std::vector<VoteCounterType> activeVotes;
+
+        // Apply each classifier to the points that are still contested.
+        StopWatch    watch;
+        unsigned int voterCount = 0;
+        for ( auto classifier = m_classifierStreamPtr->next(); classifier; classifier = m_classifierStreamPtr->next() )
+        {
+            checkVoteCounterCapacity<VoteCounterType>( voterCount );
+            watch.start();
+            if ( !compacted )
+            {
+                ClassifyAndVoteDispatcher voter( pointsStart, pointsEnd, table );
+                classifier->visit( voter );
+            }
+            else
+            {
+                auto voteWindow = Table<VoteCounterType>::createWindow( activeVotes.data(), activePoints.size(), classCount );
+                ClassifyAndVoteDispatcher voter( activeFeatures.data(), activeFeatures.data() + activeFeatures.size(), voteWindow );
+                classifier->visit( voter );
+            }
+            m_statistics.m_workerBusyTime += watch.stop();
+            ++voterCount;
+
+            // Check for decided points at the configured interval. There is
+            // nothing to retire after the last classifier has voted.
+            if ( voterCount % m_earlyStoppingInterval != 0 || voterCount >= ensembleSize ) continue;
+            const unsigned int remaining = ensembleSize - voterCount;
+            if ( !compacted )
+            {
+                // First check: gather the undecided points into the compact
+                // buffers. The votes of decided points are already final in
+                // the output table.
+                for ( std::size_t point = 0; point < pointCount; ++point )
+                {
+                    const VoteCounterType * votes = table.begin() + point * classCount;
+                    if ( !isUndecided( votes, remaining ) ) continue;
+                    activePoints.push_back( point );
+                    activeFeatures.insert( activeFeatures.end(), pointsStart + point * featureCount, pointsStart + ( point + 1 ) * featureCount );
+                    activeVotes.insert( activeVotes.end(), votes, votes + classCount );
+                }
+                compacted = true;
+            }
+            else
+            {
+                // Later checks: compact the buffers in place, scattering the
+                // final votes of newly decided points back to the output
+                // table.
+                std::size_t kept = 0;
+                for ( std::size_t point = 0; point < activePoints.size(); ++point )
+                {
+                    const VoteCounterType * votes = activeVotes.data() + point * classCount;
+                    if ( !isUndecided( votes, remaining ) )
+                    {
+                        std::copy( votes, votes + classCount, table.begin() + activePoints[point] * classCount );
+                        continue;
+                    }
+                    if ( kept != point )
+                    {
+                        activePoints[kept] = activePoints[point];
+                        std::copy( activeFeatures.begin() + point * featureCount, activeFeatures.begin() + ( point + 1 ) * featureCount, activeFeatures.begin() + kept * featureCount );
+                        std::copy( votes, votes + classCount, activeVotes.begin() + kept * classCount );
+                    }
+                    ++kept;
+                }
+                activePoints.resize( kept );
+                activeFeatures.resize( kept * featureCount );
+                activeVotes.resize( kept * classCount );
+            }
+
+            // Stop early if all points have been decided.
+            if ( activePoints.empty() ) break;
         }
 
+        // Scatter the votes of the points that remained contested back to the
+        // output table.
+        for ( std::size_t point = 0; point < activePoints.size(); ++point )
+            std::copy( activeVotes.begin() + point * classCount, activeVotes.begin() + ( point + 1 ) * classCount, table.begin() + activePoints[point] * classCount );
+
         // Return the number of classifiers that have voted.
+        m_statistics.m_classifiersApplied += voterCount;
         return voterCount;
     }
 
-    template <typename FeatureIterator>
-    unsigned int classifyAndVoteMultiThreaded( FeatureIterator pointsStart, FeatureIterator pointsEnd, VoteTable & table ) const
+    template <typename FeatureIterator, typename VoteCounterType>
+    unsigned int classifyAndVoteMultiThreaded( FeatureIterator pointsStart, FeatureIterator pointsEnd, Table<VoteCounterType> & table ) const
     {
         // Reset the stream of classifiers.
         m_classifierStreamPtr->rewind();
 
-        // Create message queues for communicating with the worker threads.
-        MessageQueue<WorkerJob> jobQueue;
+        // Create a message queue for communicating with the worker threads.
+        BoundedMessageQueue<WorkerJob> jobQueue( 4 * m_maxWorkerThreads );
 
         // Create the workers.
-        std::vector<typename WorkerThread<FeatureIterator>::SharedPointer> workers;
+        std::vector<typename WorkerThread<FeatureIterator, VoteCounterType>::SharedPointer> workers;
         const unsigned int classCount = m_classifierStreamPtr->getClassCount();
         const unsigned int featureCount = m_classifierStreamPtr->getFeatureCount();
         for ( unsigned int i = 0; i < m_maxWorkerThreads; ++i )
-            workers.push_back( typename WorkerThread<FeatureIterator>::SharedPointer( new WorkerThread<FeatureIterator>( jobQueue, classCount, featureCount, pointsStart, pointsEnd ) ) );
+            workers.push_back( typename WorkerThread<FeatureIterator, VoteCounterType>::SharedPointer( new WorkerThread<FeatureIterator, VoteCounterType>( jobQueue, classCount, featureCount, pointsStart, pointsEnd ) ) );
 
         // Start all the workers.
         for ( auto & worker : workers ) worker->start();
 
         // Reset the stream of classifiers, and apply each classifier that comes out of it.
         unsigned int voterCount = 0;
-        for ( auto classifier = m_classifierStreamPtr->next(); classifier; classifier = m_classifierStreamPtr->next(), ++voterCount ) jobQueue.send( WorkerJob( classifier ) );
+        for ( auto classifier = m_classifierStreamPtr->next(); classifier; classifier = m_classifierStreamPtr->next(), ++voterCount )
+        {
+            try
+            {
+                checkVoteCounterCapacity<VoteCounterType>( voterCount );
+            }
+            catch ( ... )
+            {
+                // Shut down the workers before propagating the error.
+                for ( auto i = workers.size(); i > 0; --i ) jobQueue.send( WorkerJob( nullptr ) );
+                for ( auto & worker : workers ) worker->join();
+                throw;
+            }
+            jobQueue.send( WorkerJob( classifier ) );
+        }
 
         // Send stop messages for all workers.
         for ( auto i = workers.size(); i > 0; --i ) jobQueue.send( WorkerJob( nullptr ) );
@@ -346,15 +1044,97 @@ private:
         for ( auto & worker : workers ) worker->join();
 
         // Add the votes accumulated by the workers to the output total.
+        StopWatch watch;
+        watch.start();
         for ( auto & worker : workers ) table += worker->getVoteCounts();
+        m_statistics.m_voteReductionTime += watch.stop();
+
+        // Merge the worker timings into the statistics.
+        for ( auto & worker : workers )
+        {
+            m_statistics.m_workerBusyTime += worker->getBusyTime();
+            m_statistics.m_workerIdleTime += worker->getIdleTime();
+        }
 
         // Return the number of classifiers that have voted.
+        m_statistics.m_classifiersApplied += voterCount;
+        return voterCount;
+    }
+
+    template <typename FeatureIterator, typename VoteCounterType>
+    unsigned int classifyAndVoteDataParallel( FeatureIterator pointsStart, FeatureIterator pointsEnd, Table<VoteCounterType> & table ) const
+    {
+        // Reset the stream of classifiers.
+        m_classifierStreamPtr->rewind();
+
+        // Determine the number of points in the input data.
+        const unsigned int classCount   = m_classifierStreamPtr->getClassCount();
+        const unsigned int featureCount = m_classifierStreamPtr->getFeatureCount();
+        const std::size_t  pointCount   = std::distance( pointsStart, pointsEnd ) / featureCount;
+
+        // Create a worker for each slice of the point range. Each worker has a
+        // private job queue, and votes directly into the rows of the shared
+        // vote table that hold its own points, so there are no thread-private
+        // vote tables to allocate and no reduction step at the end.
+        std::vector<std::unique_ptr<BoundedMessageQueue<WorkerJob>>>                        jobQueues;
+        std::vector<typename WorkerThread<FeatureIterator, VoteCounterType>::SharedPointer> workers;
+        for ( unsigned int i = 0; i < m_maxWorkerThreads; ++i )
+        {
+            const std::size_t      firstPoint = ( pointCount * i ) / m_maxWorkerThreads;
+            const std::size_t      lastPoint  = ( pointCount * ( i + 1 ) ) / m_maxWorkerThreads;
+            Table<VoteCounterType> voteSlice  = Table<VoteCounterType>::createWindow( table.begin() + firstPoint * classCount, lastPoint - firstPoint, classCount );
+            jobQueues.push_back( std::unique_ptr<BoundedMessageQueue<WorkerJob>>( new BoundedMessageQueue<WorkerJob>( 16 ) ) );
+            workers.push_back( typename WorkerThread<FeatureIterator, VoteCounterType>::SharedPointer( new WorkerThread<FeatureIterator, VoteCounterType>( *jobQueues[i], voteSlice, pointsStart + firstPoint * featureCount, pointsStart + lastPoint * featureCount ) ) );
+        }
+
+        // Start all the workers.
+        for ( auto & worker : workers ) worker->start();
+
+        // Broadcast each classifier that comes out of the stream to all workers.
+        unsigned int voterCount = 0;
+        for ( auto classifier = m_classifierStreamPtr->next(); classifier; classifier = m_classifierStreamPtr->next(), ++voterCount )
+        {
+            try
+            {
+                checkVoteCounterCapacity<VoteCounterType>( voterCount );
+            }
+            catch ( ... )
+            {
+                // Shut down the workers before propagating the error.
+                for ( auto & jobQueue : jobQueues ) jobQueue->send( WorkerJob( nullptr ) );
+                for ( auto & worker : workers ) worker->join();
+                throw;
+            }
+            for ( auto & jobQueue : jobQueues ) jobQueue->send( WorkerJob( classifier ) );
+        }
+
+        // Send a stop message to each worker.
+        for ( auto & jobQueue : jobQueues ) jobQueue->send( WorkerJob( nullptr ) );
+
+        // Wait for all the workers to join.
+        for ( auto & worker : workers ) worker->join();
+
+        // Merge the worker timings into the statistics.
+        for ( auto & worker : workers )
+        {
+            m_statistics.m_workerBusyTime += worker->getBusyTime();
+            m_statistics.m_workerIdleTime += worker->getIdleTime();
+        }
+
+        // Return the number of classifiers that have voted.
+        m_statistics.m_classifiersApplied += voterCount;
         return voterCount;
     }
 
     ClassifierInputStream * m_classifierStreamPtr;
     unsigned int            m_maxWorkerThreads;
+    ParallelizationMode     m_parallelizationMode;
+    VoteCounterWidth        m_voteCounterWidth;
+    unsigned int            m_earlyStoppingInterval;
     std::vector<float>      m_classWeights;
+
+    // Performance statistics, updated by the const classification methods.
+    mutable Statistics m_statistics;
 };
 
 template <typename FeatureIterator, typename LabelOutputIterator>
@@ -377,22 +1157,34 @@ void ClassifyDispatcher<FeatureIterator, LabelOutputIterator>::visit( const Deci
     classifier.classify( m_featureStart, m_featureEnd, m_labelStart );
 }
 
-template <typename FeatureIterator>
-void ClassifyAndVoteDispatcher<FeatureIterator>::visit( const EnsembleClassifier & classifier )
+template <typename FeatureIterator, typename LabelOutputIterator>
+void ClassifyDispatcher<FeatureIterator, LabelOutputIterator>::visit( const CompiledForestClassifier<float> & classifier )
+{
+    classifier.classify( m_featureStart, m_featureEnd, m_labelStart );
+}
+
+template <typename FeatureIterator, typename LabelOutputIterator>
+void ClassifyDispatcher<FeatureIterator, LabelOutputIterator>::visit( const CompiledForestClassifier<double> & classifier )
+{
+    classifier.classify( m_featureStart, m_featureEnd, m_labelStart );
+}
+
+template <typename FeatureIterator, typename VoteCounterType>
+void ClassifyAndVoteDispatcher<FeatureIterator, VoteCounterType>::visit( const EnsembleClassifier & classifier )
 {
     (void) classifier;
     assert( false );
     // classifier.classifyAndVote( m_featureStart, m_featureEnd, m_voteTable );
 }
 
-template <typename FeatureIterator>
-void ClassifyAndVoteDispatcher<FeatureIterator>::visit( const DecisionTreeClassifier<float> & classifier )
+template <typename FeatureIterator, typename VoteCounterType>
+void ClassifyAndVoteDispatcher<FeatureIterator, VoteCounterType>::visit( const DecisionTreeClassifier<float> & classifier )
 {
     classifier.classifyAndVote( m_featureStart, m_featureEnd, m_voteTable );
 }
 
-template <typename FeatureIterator>
-void ClassifyAndVoteDispatcher<FeatureIterator>::visit( const DecisionTreeClassifier<double> & classifier )
+template <typename FeatureIterator, typename VoteCounterType>
+void ClassifyAndVoteDispatcher<FeatureIterator, VoteCounterType>::visit( const DecisionTreeClassifier<double> & classifier )
 {
     classifier.classifyAndVote( m_featureStart, m_featureEnd, m_voteTable );
 }
@@ -0,0 +1,209 @@
+#ifndef FEATUREQUANTIZER_H
+#define FEATUREQUANTIZER_H
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+#include <vector>
+
+#include "classifierstream.h"
+#include "datatypes.h"
+#include "decisiontreeclassifier.h"
+#include "exceptions.h"
+#include "table.h"
+
+namespace balsa
+{
+
+/**
+ * Discretizes feature values into compact, unsigned integer codes.
+ *
+ * The quantizer computes a table of bin edges per feature, placed at
+ * (approximately) equally spaced quantiles of the values of that feature. A
+ * feature value is encoded as the number of bin edges that do not exceed it,
+ * so the codes preserve the relative order of the feature values. Since the
+ * code type is much smaller than the feature type, training an
+ * IndexedDecisionTree on codes instead of raw feature values shrinks the
+ * internal feature index several-fold.
+ *
+ * A decision tree trained on codes splits nodes with 'code < c' predicates.
+ * By construction, 'code < c' holds exactly when 'value < edge(c - 1)' holds
+ * for the original feature value, so such a tree can be translated back into
+ * an exactly equivalent tree over the original feature space (see
+ * dequantizeClassifier()). Quantization is lossy only in that candidate split
+ * thresholds are restricted to the bin edges.
+ */
+template <typename FeatureType, typename CodeType>
+class FeatureQuantizer
+{
+public:
+
+    static_assert( std::is_floating_point<FeatureType>::value, "Feature type should be a floating point type." );
+    static_assert( std::is_unsigned<CodeType>::value, "Code type should be an unsigned integral type." );
+    static_assert( sizeof( CodeType ) <= 2, "Code type should be at most 16 bits wide." );
+
+    /**
+     * Constructs a quantizer from a dataset.
+     *
+     * \param pointsStart An iterator that points to the first feature value of
+     *  the first point.
+     * \param pointsEnd An iterator that points to the end of the block of
+     *  point data.
+     * \param featureCount The number of features per data point.
+     * \param binCount The number of bins per feature. Must be at least 2, and
+     *  at most the number of distinct values of the code type.
+     */
+    template <typename FeatureIterator>
+    FeatureQuantizer( FeatureIterator pointsStart, FeatureIterator pointsEnd, unsigned int featureCount, unsigned int binCount = static_cast<unsigned int>( std::numeric_limits<CodeType>::max() ) + 1 )
+    {
+        // Check the parameters.
+        if ( featureCount == 0 ) throw ClientError( "Data points must have at least one feature." );
+        if ( binCount < 2 ) throw ClientError( "The number of quantization bins must be at least 2." );
+        if ( binCount > static_cast<unsigned int>( std::numeric_limits<CodeType>::max() ) + 1 ) throw ClientError( "The number of quantization bins exceeds the range of the code type." );
+        auto entryCount = std::distance( pointsStart, pointsEnd );
+        if ( entryCount % featureCount ) throw ClientError( "Malformed dataset." );
+        std::size_t pointCount = entryCount / featureCount;
+        if ( pointCount == 0 ) throw ClientError( "Dataset contains no points." );
+
+        // Compute a strictly increasing table of bin edges for each feature,
+        // at (approximately) equally spaced quantiles of the feature values.
+        m_binEdges.resize( featureCount );
+        std::vector<FeatureType> column( pointCount );
+        for ( FeatureID feature = 0; feature < featureCount; ++feature )
+        {
+            // Collect and sort the values of this feature.
+            for ( std::size_t point = 0; point < pointCount; ++point ) column[point] = pointsStart[point * featureCount + feature];
+            std::sort( column.begin(), column.end() );
+
+            // Select the quantile edges, dropping duplicates.
+            auto & edges = m_binEdges[feature];
+            edges.reserve( binCount - 1 );
+            for ( unsigned int bin = 1; bin < binCount; ++bin )
+            {
+                auto candidate = column[( static_cast<std::size_t>( pointCount ) * bin ) / binCount];
+                if ( candidate <= ( edges.empty() ? column.front() : edges.back() ) ) continue;
+                edges.push_back( candidate );
+            }
+        }
+    }
+
+    /**
+     * Returns the number of features the quantizer expects.
+     */
+    unsigned int getFeatureCount() const
+    {
+        return m_binEdges.size();
+    }
+
+    /**
+     * Encode a dataset as a table of quantized feature codes.
+     */
+    template <typename FeatureIterator>
+    Table<CodeType> quantize( FeatureIterator pointsStart, FeatureIterator pointsEnd ) const
+    {
+        // Check the dimensions of the input data.
+        unsigned int featureCount = getFeatureCount();
+        auto         entryCount   = std::distance( pointsStart, pointsEnd );
+        if ( entryCount % featureCount ) throw ClientError( "Malformed dataset." );
+        std::size_t pointCount = entryCount / featureCount;
+
+        // Encode each feature value as the number of bin edges that do not exceed it.
+        Table<CodeType> codes( pointCount, featureCount );
+        for ( std::size_t point = 0; point < pointCount; ++point )
+        {
+            for ( FeatureID feature = 0; feature < featureCount; ++feature )
+            {
+                auto & edges                        = m_binEdges[feature];
+                auto   value                        = pointsStart[point * featureCount + feature];
+                codes( point, feature ) = std::upper_bound( edges.begin(), edges.end(), value ) - edges.begin();
+            }
+        }
+        return codes;
+    }
+
+    /**
+     * Translate a decision tree trained on quantized feature codes into an
+     * equivalent tree over the original feature space, by replacing each
+     * split code with the corresponding bin edge.
+     */
+    typename DecisionTreeClassifier<FeatureType>::SharedPointer dequantizeClassifier( const DecisionTreeClassifier<CodeType> & quantizedTree ) const
+    {
+        // Create an empty classifier and copy the tables that are unaffected by quantization.
+        typedef DecisionTreeClassifier<FeatureType> ClassifierType;
+        typename ClassifierType::SharedPointer      classifier( new ClassifierType( quantizedTree.getClassCount(), quantizedTree.getFeatureCount() ) );
+        NodeID                                      nodeCount = quantizedTree.m_leftChildID.getRowCount();
+        classifier->m_leftChildID                             = quantizedTree.m_leftChildID;
+        classifier->m_rightChildID                            = quantizedTree.m_rightChildID;
+        classifier->m_splitFeatureID                          = quantizedTree.m_splitFeatureID;
+        classifier->m_label                                   = quantizedTree.m_label;
+
+        // Replace the split code of each interior node with the bin edge it represents.
+        classifier->m_splitValue = Table<FeatureType>( nodeCount, 1, 0 );
+        for ( NodeID nodeID = 0; nodeID < nodeCount; ++nodeID )
+        {
+            if ( quantizedTree.m_leftChildID( nodeID, 0 ) == 0 ) continue;
+            auto   featureID = quantizedTree.m_splitFeatureID( nodeID, 0 );
+            auto   code      = quantizedTree.m_splitValue( nodeID, 0 );
+            auto & edges     = m_binEdges[featureID];
+            assert( code >= 1 && code <= edges.size() );
+            classifier->m_splitValue( nodeID, 0 ) = edges[code - 1];
+        }
+
+        return classifier;
+    }
+
+private:
+
+    std::vector<std::vector<FeatureType>> m_binEdges;
+};
+
+/**
+ * A classifier output stream decorator that translates decision trees trained
+ * on quantized feature codes back to the original feature space before
+ * passing them on to the wrapped stream.
+ */
+template <typename FeatureType, typename CodeType>
+class DequantizingOutputStream: public ClassifierOutputStream
+{
+public:
+
+    /**
+     * Constructs an open dequantizing output stream.
+     * \param stream The stream the translated classifiers are written to.
+     * \param quantizer The quantizer that produced the feature codes the
+     *  incoming classifiers are trained on.
+     */
+    DequantizingOutputStream( ClassifierOutputStream & stream, const FeatureQuantizer<FeatureType, CodeType> & quantizer ):
+    m_stream( stream ),
+    m_quantizer( quantizer )
+    {
+    }
+
+private:
+
+    /**
+     * Perform subclass-specific operations when the stream is closed.
+     */
+    void onClose()
+    {
+        m_stream.close();
+    }
+
+    /**
+     * Perform the actual write in a subclass-specific way.
+     * This is guaranteed to be called only when the stream is still open.
+     */
+    void onWrite( const Classifier & classifier )
+    {
+        auto quantizedTree = dynamic_cast<const DecisionTreeClassifier<CodeType> *>( &classifier );
+        if ( !quantizedTree ) throw ClientError( "Only decision trees trained on quantized features can be written to this stream." );
+        m_stream.write( *m_quantizer.dequantizeClassifier( *quantizedTree ) );
+    }
+
+    ClassifierOutputStream &                        m_stream;
+    const FeatureQuantizer<FeatureType, CodeType> & m_quantizer;
+};
+
+} // namespace balsa
+
+#endif // FEATUREQUANTIZER_H
@@ -1,6 +1,12 @@
 #include <map>
 #include <variant>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "compiledforestclassifier.h"
 #include "decisiontreeclassifier.h"
 #include "fileio.h"
 #include "serdes.h"
@@ -9,10 +15,13 @@ namespace balsa
 {
 
 /**
- * Balsa file format version.
+ * Balsa file format version. Minor version 1 adds the compressed tree node
+ * encoding, minor version 2 adds the compiled forest block; all other objects
+ * are unchanged, so files written by older versions of the library remain
+ * readable.
  */
 constexpr const unsigned char FILE_FORMAT_MAJOR_VERSION = 1;
-constexpr const unsigned char FILE_FORMAT_MINOR_VERSION = 0;
+constexpr const unsigned char FILE_FORMAT_MINOR_VERSION = 2;
 
 /**
  * Marker names.
@@ -24,10 +33,14 @@ const std::string ENSEMBLE_START_MARKER   = "ensl";
 const std::string ENSEMBLE_END_MARKER     = "lsne";
 const std::string TREE_START_MARKER       = "tree";
 const std::string TREE_END_MARKER         = "eert";
+const std::string FOREST_START_MARKER     = "fore";
+const std::string FOREST_END_MARKER       = "erof";
 const std::string TABLE_START_MARKER      = "tabl";
 const std::string TABLE_END_MARKER        = "lbat";
 const std::string DICTIONARY_START_MARKER = "dict";
 const std::string DICTIONARY_END_MARKER   = "tcid";
+const std::string SAPLING_START_MARKER    = "sapl";
+const std::string SAPLING_END_MARKER      = "lpas";
 
 /**
  * Dictionary key names.
@@ -43,9 +56,22 @@ const std::string ENSEMBLE_HEADER_FEATURE_COUNT_KEY     = "feature_count";
 const std::string TREE_HEADER_CLASS_COUNT_KEY           = ENSEMBLE_HEADER_CLASS_COUNT_KEY;
 const std::string TREE_HEADER_FEATURE_COUNT_KEY         = ENSEMBLE_HEADER_FEATURE_COUNT_KEY;
 const std::string TREE_HEADER_FEATURE_TYPE_ID_KEY       = "feature_type_id";
+const std::string TREE_HEADER_NODE_ENCODING_KEY         = "node_encoding";
+const std::string FOREST_HEADER_CLASS_COUNT_KEY         = ENSEMBLE_HEADER_CLASS_COUNT_KEY;
+const std::string FOREST_HEADER_FEATURE_COUNT_KEY       = ENSEMBLE_HEADER_FEATURE_COUNT_KEY;
+const std::string FOREST_HEADER_FEATURE_TYPE_ID_KEY     = TREE_HEADER_FEATURE_TYPE_ID_KEY;
 const std::string TABLE_HEADER_ROW_COUNT_KEY            = "row_count";
 const std::string TABLE_HEADER_COLUMN_COUNT_KEY         = "column_count";
 const std::string TABLE_HEADER_SCALAR_TYPE_ID_KEY       = "scalar_type_id";
+const std::string SAPLING_HEADER_CLASS_COUNT_KEY        = ENSEMBLE_HEADER_CLASS_COUNT_KEY;
+const std::string SAPLING_HEADER_FEATURE_COUNT_KEY      = ENSEMBLE_HEADER_FEATURE_COUNT_KEY;
+const std::string SAPLING_HEADER_POINT_COUNT_KEY        = "point_count";
+const std::string SAPLING_HEADER_FEATURE_TYPE_ID_KEY    = TREE_HEADER_FEATURE_TYPE_ID_KEY;
+
+/**
+ * Recognized tree node encoding names (see BalsaFileWriter::setCompressedTrees()).
+ */
+const std::string TREE_NODE_ENCODING_COMPRESSED = "cmpr";
 
 /**
  * An enumeration of recognized platform endianness.
@@ -103,6 +129,12 @@ std::string getTypeName<int32_t>()
     return "in32";
 }
 
+template <>
+std::string getTypeName<Float16>()
+{
+    return "fl16";
+}
+
 template <>
 std::string getTypeName<float>()
 {
@@ -146,6 +178,8 @@ std::string getTypeName( ScalarTypeID scalarTypeID )
             return getTypeName<int16_t>();
         case ScalarTypeID::INT32:
             return getTypeName<int32_t>();
+        case ScalarTypeID::FLOAT16:
+            return getTypeName<Float16>();
         case ScalarTypeID::FLOAT:
             return getTypeName<float>();
         case ScalarTypeID::DOUBLE:
@@ -169,6 +203,7 @@ ScalarTypeID getScalarTypeID( const std::string & typeName )
     if ( typeName == getTypeName<int8_t>() ) return ScalarTypeID::INT8;
     if ( typeName == getTypeName<int16_t>() ) return ScalarTypeID::INT16;
     if ( typeName == getTypeName<int32_t>() ) return ScalarTypeID::INT32;
+    if ( typeName == getTypeName<Float16>() ) return ScalarTypeID::FLOAT16;
     if ( typeName == getTypeName<float>() ) return ScalarTypeID::FLOAT;
     if ( typeName == getTypeName<double>() ) return ScalarTypeID::DOUBLE;
     if ( typeName == getTypeName<bool>() ) return ScalarTypeID::BOOL;
@@ -391,7 +426,38 @@ Endianness parseFileEndianness( std::istream & stream )
     throw ParseError( "Invalid endianness marker." );
 }
 
-BalsaFileParser::BalsaFileParser( const std::string & filename )
+MappedFile::MappedFile( const std::string & filename )
+{
+    // Open the file.
+    int fileDescriptor = ::open( filename.c_str(), O_RDONLY );
+    if ( fileDescriptor < 0 ) throw SupplierError( "Could not open file '" + filename + "'." );
+
+    // Determine the file size.
+    struct stat fileStatus;
+    if ( ::fstat( fileDescriptor, &fileStatus ) < 0 )
+    {
+        ::close( fileDescriptor );
+        throw SupplierError( "Could not determine the size of file '" + filename + "'." );
+    }
+    m_size = fileStatus.st_size;
+
+    // Map the file into memory. The file descriptor can be closed once the
+    // mapping is established.
+    m_data = ::mmap( nullptr, m_size, PROT_READ, MAP_SHARED, fileDescriptor, 0 );
+    ::close( fileDescriptor );
+    if ( m_data == MAP_FAILED ) throw SupplierError( "Could not memory-map file '" + filename + "'." );
+}
+
+MappedFile::~MappedFile()
+{
+    ::munmap( m_data, m_size );
+}
+
+BalsaFileParser::BalsaFileParser( const std::string & filename, bool memoryMap ):
+m_tableRowsLeft( 0 ),
+m_tableColumnCount( 0 ),
+m_tableScalarTypeID( ScalarTypeID::UINT8 ),
+m_classifiersParsed( 0 )
 {
     // Configure the file input stream to throw an exception on error.
     m_stream.exceptions( std::ifstream::failbit | std::ifstream::badbit );
@@ -399,6 +465,9 @@ BalsaFileParser::BalsaFileParser( const std::string & filename )
     // Open the model file.
     m_stream.open( filename, std::ios::binary );
 
+    // Map the file into memory, if requested.
+    if ( memoryMap ) m_mappedFile.reset( new MappedFile( filename ) );
+
     parseFileSignature();
 
     Endianness fileEndianness = parseFileEndianness( m_stream );
@@ -414,7 +483,10 @@ BalsaFileParser::BalsaFileParser( const std::string & filename )
         throw SupplierError( "File format major version number mismatch." );
     }
 
-    if ( fileMinorVersion < FILE_FORMAT_MINOR_VERSION )
+    // Minor version increments are backward compatible additions: files with
+    // an older minor version remain readable, files with a newer one may
+    // contain objects this version cannot parse.
+    if ( fileMinorVersion > FILE_FORMAT_MINOR_VERSION )
     {
         throw SupplierError( "File format minor version number mismatch." );
     }
@@ -494,6 +566,21 @@ bool BalsaFileParser::atTreeOfType( FeatureTypeID typeID )
     return result;
 }
 
+bool BalsaFileParser::atForest()
+{
+    return ( peekFixedSizeToken( m_stream, FOREST_START_MARKER.size() ) == FOREST_START_MARKER );
+}
+
+bool BalsaFileParser::atClassifier()
+{
+    return atTree() || atForest();
+}
+
+bool BalsaFileParser::atSapling()
+{
+    return ( peekFixedSizeToken( m_stream, SAPLING_START_MARKER.size() ) == SAPLING_START_MARKER );
+}
+
 bool BalsaFileParser::atEnsemble()
 {
     return ( peekFixedSizeToken( m_stream, ENSEMBLE_START_MARKER.size() ) == ENSEMBLE_START_MARKER );
@@ -522,20 +609,92 @@ void BalsaFileParser::leaveEnsemble()
     expect( m_stream, ENSEMBLE_END_MARKER, "Missing ensemble end marker." );
 }
 
+SaplingHeader BalsaFileParser::enterSapling()
+{
+    expect( m_stream, SAPLING_START_MARKER, "Missing sapling start marker." );
+    return parseSaplingHeader();
+}
+
+void BalsaFileParser::leaveSapling()
+{
+    parseSaplingEndMarker();
+}
+
 void BalsaFileParser::reenterEnsemble()
 {
     if ( m_treeOffset == 0 ) throw ClientError( "No ensemble was entered yet." );
     m_stream.seekg( m_treeOffset );
 }
 
+TableHeader BalsaFileParser::enterTable()
+{
+    parseTableStartMarker();
+    TableHeader header  = parseTableHeader();
+    m_tableRowsLeft     = header.rowCount;
+    m_tableColumnCount  = header.columnCount;
+    m_tableScalarTypeID = header.scalarTypeID;
+    return header;
+}
+
+void BalsaFileParser::leaveTable()
+{
+    if ( m_tableRowsLeft != 0 ) throw ClientError( "Not all rows of the table have been read." );
+    parseTableEndMarker();
+}
+
 Classifier::SharedPointer BalsaFileParser::parseClassifier()
 {
+    // Parse compiled forests through the dedicated parser.
+    if ( atForest() )
+    {
+        parseForestStartMarker();
+        ForestHeader              header = parseForestHeader();
+        Classifier::SharedPointer result;
+        switch ( header.featureTypeID )
+        {
+            case FeatureTypeID::FLOAT:
+                result = parseCompiledForest<float>( header );
+                break;
+            case FeatureTypeID::DOUBLE:
+                result = parseCompiledForest<double>( header );
+                break;
+            default:
+                assert( false );
+        }
+        parseForestEndMarker();
+        ++m_classifiersParsed;
+        return result;
+    }
+
     // Parse the tree start marker.
     parseTreeStartMarker();
 
     // Parse the header.
     TreeHeader header = parseTreeHeader();
 
+    // Parse compressed node data through the dedicated decoder. Compressed
+    // trees are always decoded into memory, also when the file is
+    // memory-mapped, because the in-memory node tables do not exist in the
+    // file.
+    if ( header.compressedNodes )
+    {
+        Classifier::SharedPointer result;
+        switch ( header.featureTypeID )
+        {
+            case FeatureTypeID::FLOAT:
+                result = parseCompressedTree<float>( header );
+                break;
+            case FeatureTypeID::DOUBLE:
+                result = parseCompressedTree<double>( header );
+                break;
+            default:
+                assert( false );
+        }
+        parseTreeEndMarker();
+        ++m_classifiersParsed;
+        return result;
+    }
+
     // Check the feature type.
     Classifier::SharedPointer result;
     switch ( header.featureTypeID )
@@ -545,12 +704,25 @@ Classifier::SharedPointer BalsaFileParser::parseClassifier()
             // Create an empty classifier.
             DecisionTreeClassifier<float>::SharedPointer classifier( new DecisionTreeClassifier<float>( header.classCount, header.featureCount ) );
 
-            // Move assign the internal tables.
-            classifier->m_leftChildID    = parseTable<NodeID>();
-            classifier->m_rightChildID   = parseTable<NodeID>();
-            classifier->m_splitFeatureID = parseTable<FeatureID>();
-            classifier->m_splitValue     = parseTable<float>();
-            classifier->m_label          = parseTable<Label>();
+            if ( m_mappedFile )
+            {
+                // Create views of the tables in the mapped file, and keep the mapping alive.
+                classifier->m_leftChildID    = parseTableView<NodeID>();
+                classifier->m_rightChildID   = parseTableView<NodeID>();
+                classifier->m_splitFeatureID = parseTableView<FeatureID>();
+                classifier->m_splitValue     = parseTableView<float>();
+                classifier->m_label          = parseTableView<Label>();
+                classifier->m_backingStore   = m_mappedFile;
+            }
+            else
+            {
+                // Move assign the internal tables.
+                classifier->m_leftChildID    = parseTable<NodeID>();
+                classifier->m_rightChildID   = parseTable<NodeID>();
+                classifier->m_splitFeatureID = parseTable<FeatureID>();
+                classifier->m_splitValue     = parseTable<float>();
+                classifier->m_label          = parseTable<Label>();
+            }
 
             result = classifier;
         }
@@ -560,12 +732,25 @@ Classifier::SharedPointer BalsaFileParser::parseClassifier()
             // Create an empty classifier.
             DecisionTreeClassifier<double>::SharedPointer classifier( new DecisionTreeClassifier<double>( header.classCount, header.featureCount ) );
 
-            // Move assign the internal tables.
-            classifier->m_leftChildID    = parseTable<NodeID>();
-            classifier->m_rightChildID   = parseTable<NodeID>();
-            classifier->m_splitFeatureID = parseTable<FeatureID>();
-            classifier->m_splitValue     = parseTable<double>();
-            classifier->m_label          = parseTable<Label>();
+            if ( m_mappedFile )
+            {
+                // Create views of the tables in the mapped file, and keep the mapping alive.
+                classifier->m_leftChildID    = parseTableView<NodeID>();
+                classifier->m_rightChildID   = parseTableView<NodeID>();
+                classifier->m_splitFeatureID = parseTableView<FeatureID>();
+                classifier->m_splitValue     = parseTableView<double>();
+                classifier->m_label          = parseTableView<Label>();
+                classifier->m_backingStore   = m_mappedFile;
+            }
+            else
+            {
+                // Move assign the internal tables.
+                classifier->m_leftChildID    = parseTable<NodeID>();
+                classifier->m_rightChildID   = parseTable<NodeID>();
+                classifier->m_splitFeatureID = parseTable<FeatureID>();
+                classifier->m_splitValue     = parseTable<double>();
+                classifier->m_label          = parseTable<Label>();
+            }
 
             result = classifier;
         }
@@ -577,10 +762,102 @@ Classifier::SharedPointer BalsaFileParser::parseClassifier()
     // Parse the tree end marker.
     parseTreeEndMarker();
 
+    // Count the classifier for the performance statistics.
+    ++m_classifiersParsed;
+
     // Return the result.
     return result;
 }
 
+template <typename FeatureType>
+Classifier::SharedPointer BalsaFileParser::parseCompressedTree( const TreeHeader & header )
+{
+    typename DecisionTreeClassifier<FeatureType>::SharedPointer classifier( new DecisionTreeClassifier<FeatureType>( header.classCount, header.featureCount ) );
+
+    // Parse the node count and the structure bitmap, which holds a set bit
+    // for every interior node.
+    const NodeID               nodeCount = deserializeVarUInt( m_stream );
+    std::vector<unsigned char> interiorNodes( ( nodeCount + 7 ) / 8 );
+    m_stream.read( reinterpret_cast<char *>( interiorNodes.data() ), interiorNodes.size() );
+
+    // Allocate zero-initialized node tables. Fields that are not stored in
+    // the compressed encoding (the split data of leaf nodes, and the label of
+    // interior nodes) remain zero; they are never consulted during traversal.
+    classifier->m_leftChildID    = Table<NodeID>( nodeCount, 1, 0 );
+    classifier->m_rightChildID   = Table<NodeID>( nodeCount, 1, 0 );
+    classifier->m_splitFeatureID = Table<FeatureID>( nodeCount, 1, 0 );
+    classifier->m_splitValue     = Table<FeatureType>( nodeCount, 1, 0 );
+    classifier->m_label          = Table<Label>( nodeCount, 1, 0 );
+
+    // Parse the interior node records.
+    std::int64_t previousLeft = 0;
+    for ( NodeID node = 0; node < nodeCount; ++node )
+    {
+        if ( !( interiorNodes[node / 8] & ( 1 << ( node % 8 ) ) ) ) continue;
+        const std::int64_t left  = previousLeft + zigZagDecode( deserializeVarUInt( m_stream ) );
+        const std::int64_t right = left + zigZagDecode( deserializeVarUInt( m_stream ) );
+
+        classifier->m_leftChildID( node, 0 )    = static_cast<NodeID>( left );
+        classifier->m_rightChildID( node, 0 )   = static_cast<NodeID>( right );
+        classifier->m_splitFeatureID( node, 0 ) = deserialize<FeatureID>( m_stream );
+        classifier->m_splitValue( node, 0 )     = deserialize<FeatureType>( m_stream );
+        previousLeft                            = left;
+    }
+
+    // Parse the leaf node labels.
+    for ( NodeID node = 0; node < nodeCount; ++node )
+    {
+        if ( !( interiorNodes[node / 8] & ( 1 << ( node % 8 ) ) ) ) classifier->m_label( node, 0 ) = deserialize<Label>( m_stream );
+    }
+
+    return classifier;
+}
+
+template <typename FeatureType>
+Classifier::SharedPointer BalsaFileParser::parseCompiledForest( const ForestHeader & header )
+{
+    typename CompiledForestClassifier<FeatureType>::SharedPointer classifier( new CompiledForestClassifier<FeatureType>( header.classCount, header.featureCount ) );
+
+    if ( m_mappedFile )
+    {
+        // Create views of the tables in the mapped file, and keep the mapping alive.
+        classifier->m_treeRoots      = parseTableView<NodeID>();
+        classifier->m_leftChildID    = parseTableView<NodeID>();
+        classifier->m_rightChildID   = parseTableView<NodeID>();
+        classifier->m_splitFeatureID = parseTableView<FeatureID>();
+        classifier->m_splitValue     = parseTableView<FeatureType>();
+        classifier->m_label          = parseTableView<Label>();
+        classifier->m_voteWeight     = parseTableView<float>();
+        classifier->m_backingStore   = m_mappedFile;
+    }
+    else
+    {
+        // Move assign the internal tables.
+        classifier->m_treeRoots      = parseTable<NodeID>();
+        classifier->m_leftChildID    = parseTable<NodeID>();
+        classifier->m_rightChildID   = parseTable<NodeID>();
+        classifier->m_splitFeatureID = parseTable<FeatureID>();
+        classifier->m_splitValue     = parseTable<FeatureType>();
+        classifier->m_label          = parseTable<Label>();
+        classifier->m_voteWeight     = parseTable<float>();
+    }
+
+    return classifier;
+}
+
+std::uint64_t BalsaFileParser::getBytesRead()
+{
+    // Clear a sticky end-of-file condition, so tellg() reports the current
+    // offset rather than failing after the last object has been read.
+    if ( m_stream.eof() ) m_stream.clear();
+    return static_cast<std::uint64_t>( m_stream.tellg() );
+}
+
+std::uint64_t BalsaFileParser::getClassifiersParsed() const
+{
+    return m_classifiersParsed;
+}
+
 void BalsaFileParser::parseFileSignature()
 {
     expect( m_stream, FILE_SIGNATURE, "Invalid file signature." );
@@ -596,6 +873,16 @@ void BalsaFileParser::parseTreeEndMarker()
     expect( m_stream, TREE_END_MARKER, "Missing tree end tag." );
 }
 
+void BalsaFileParser::parseForestStartMarker()
+{
+    expect( m_stream, FOREST_START_MARKER, "Missing forest start tag." );
+}
+
+void BalsaFileParser::parseForestEndMarker()
+{
+    expect( m_stream, FOREST_END_MARKER, "Missing forest end tag." );
+}
+
 void BalsaFileParser::parseTableStartMarker()
 {
     expect( m_stream, TABLE_START_MARKER, "Invalid table start marker." );
@@ -606,6 +893,11 @@ void BalsaFileParser::parseTableEndMarker()
     expect( m_stream, TABLE_END_MARKER, "Invalid table end marker." );
 }
 
+void BalsaFileParser::parseSaplingEndMarker()
+{
+    expect( m_stream, SAPLING_END_MARKER, "Missing sapling end marker." );
+}
+
 EnsembleHeader BalsaFileParser::parseEnsembleHeader()
 {
     EnsembleHeader result;
@@ -622,6 +914,34 @@ TreeHeader BalsaFileParser::parseTreeHeader()
     result.classCount     = dictionary.get<uint8_t>( TREE_HEADER_CLASS_COUNT_KEY );
     result.featureCount   = dictionary.get<uint8_t>( TREE_HEADER_FEATURE_COUNT_KEY );
     result.featureTypeID  = getFeatureTypeID( dictionary.get<std::string>( TREE_HEADER_FEATURE_TYPE_ID_KEY ) );
+
+    // The node encoding key is absent in files that predate the compressed
+    // encoding, which implies the plain table encoding.
+    auto encoding          = dictionary.find<std::string>( TREE_HEADER_NODE_ENCODING_KEY );
+    result.compressedNodes = encoding.has_value();
+    if ( encoding && *encoding != TREE_NODE_ENCODING_COMPRESSED )
+        throw ParseError( "Unknown tree node encoding: '" + *encoding + "'." );
+    return result;
+}
+
+ForestHeader BalsaFileParser::parseForestHeader()
+{
+    ForestHeader result;
+    Dictionary   dictionary = Dictionary::deserialize( m_stream );
+    result.classCount       = dictionary.get<uint8_t>( FOREST_HEADER_CLASS_COUNT_KEY );
+    result.featureCount     = dictionary.get<uint8_t>( FOREST_HEADER_FEATURE_COUNT_KEY );
+    result.featureTypeID    = getFeatureTypeID( dictionary.get<std::string>( FOREST_HEADER_FEATURE_TYPE_ID_KEY ) );
+    return result;
+}
+
+SaplingHeader BalsaFileParser::parseSaplingHeader()
+{
+    SaplingHeader result;
+    Dictionary    dictionary = Dictionary::deserialize( m_stream );
+    result.classCount        = dictionary.get<uint8_t>( SAPLING_HEADER_CLASS_COUNT_KEY );
+    result.featureCount      = dictionary.get<uint8_t>( SAPLING_HEADER_FEATURE_COUNT_KEY );
+    result.pointCount        = dictionary.get<uint32_t>( SAPLING_HEADER_POINT_COUNT_KEY );
+    result.featureTypeID     = getFeatureTypeID( dictionary.get<std::string>( SAPLING_HEADER_FEATURE_TYPE_ID_KEY ) );
     return result;
 }
 
@@ -636,7 +956,8 @@ TableHeader BalsaFileParser::parseTableHeader()
 }
 
 BalsaFileWriter::BalsaFileWriter( const std::string & filename, std::optional<std::string> creatorName, std::optional<unsigned char> creatorMajorVersion, std::optional<unsigned char> creatorMinorVersion, std::optional<unsigned char> creatorPatchVersion ):
-m_insideEnsemble( false )
+m_insideEnsemble( false ),
+m_compressTrees( false )
 {
     // Configure the file input stream to throw an exception on error.
     m_stream.exceptions( std::ofstream::failbit | std::ofstream::badbit );
@@ -672,12 +993,29 @@ void BalsaFileWriter::leaveEnsemble()
     m_insideEnsemble = false;
 }
 
+void BalsaFileWriter::enterSapling( unsigned char classCount, unsigned char featureCount, unsigned int pointCount, FeatureTypeID featureType )
+{
+    assert( !m_insideEnsemble );
+    m_stream.write( SAPLING_START_MARKER.data(), SAPLING_START_MARKER.size() );
+    writeSaplingHeader( classCount, featureCount, pointCount, featureType );
+}
+
+void BalsaFileWriter::leaveSapling()
+{
+    m_stream.write( SAPLING_END_MARKER.data(), SAPLING_END_MARKER.size() );
+}
+
 void BalsaFileWriter::writeClassifier( const Classifier & classifier )
 {
     ClassifierWriteDispatcher writer( *this );
     classifier.visit( writer );
 }
 
+void BalsaFileWriter::setCompressedTrees( bool enabled )
+{
+    m_compressTrees = enabled;
+}
+
 void BalsaFileWriter::ClassifierWriteDispatcher::visit( const EnsembleClassifier & classifier )
 {
     // Writing ensemble classifiers is not supported yet.
@@ -688,27 +1026,114 @@ void BalsaFileWriter::ClassifierWriteDispatcher::visit( const EnsembleClassifier
 void BalsaFileWriter::ClassifierWriteDispatcher::visit( const DecisionTreeClassifier<float> & classifier )
 {
     m_writer.writeTreeStartMarker();
-    m_writer.writeTreeHeader( classifier.m_classCount, classifier.m_featureCount, getFeatureTypeID<float>() );
-    m_writer.writeTable( classifier.m_leftChildID );
-    m_writer.writeTable( classifier.m_rightChildID );
-    m_writer.writeTable( classifier.m_splitFeatureID );
-    m_writer.writeTable( classifier.m_splitValue );
-    m_writer.writeTable( classifier.m_label );
+    m_writer.writeTreeHeader( classifier.m_classCount, classifier.m_featureCount, getFeatureTypeID<float>(), m_writer.m_compressTrees );
+    if ( m_writer.m_compressTrees )
+    {
+        m_writer.writeCompressedTreeNodes( classifier );
+    }
+    else
+    {
+        m_writer.writeTable( classifier.m_leftChildID );
+        m_writer.writeTable( classifier.m_rightChildID );
+        m_writer.writeTable( classifier.m_splitFeatureID );
+        m_writer.writeTable( classifier.m_splitValue );
+        m_writer.writeTable( classifier.m_label );
+    }
     m_writer.writeTreeEndMarker();
 }
 
 void BalsaFileWriter::ClassifierWriteDispatcher::visit( const DecisionTreeClassifier<double> & classifier )
 {
     m_writer.writeTreeStartMarker();
-    m_writer.writeTreeHeader( classifier.m_classCount, classifier.m_featureCount, getFeatureTypeID<double>() );
-    m_writer.writeTable( classifier.m_leftChildID );
-    m_writer.writeTable( classifier.m_rightChildID );
-    m_writer.writeTable( classifier.m_splitFeatureID );
-    m_writer.writeTable( classifier.m_splitValue );
-    m_writer.writeTable( classifier.m_label );
+    m_writer.writeTreeHeader( classifier.m_classCount, classifier.m_featureCount, getFeatureTypeID<double>(), m_writer.m_compressTrees );
+    if ( m_writer.m_compressTrees )
+    {
+        m_writer.writeCompressedTreeNodes( classifier );
+    }
+    else
+    {
+        m_writer.writeTable( classifier.m_leftChildID );
+        m_writer.writeTable( classifier.m_rightChildID );
+        m_writer.writeTable( classifier.m_splitFeatureID );
+        m_writer.writeTable( classifier.m_splitValue );
+        m_writer.writeTable( classifier.m_label );
+    }
     m_writer.writeTreeEndMarker();
 }
 
+void BalsaFileWriter::ClassifierWriteDispatcher::visit( const CompiledForestClassifier<float> & classifier )
+{
+    m_writer.writeForestStartMarker();
+    m_writer.writeForestHeader( classifier.m_classCount, classifier.m_featureCount, getFeatureTypeID<float>() );
+    m_writer.writeCompiledForestTables( classifier );
+    m_writer.writeForestEndMarker();
+}
+
+void BalsaFileWriter::ClassifierWriteDispatcher::visit( const CompiledForestClassifier<double> & classifier )
+{
+    m_writer.writeForestStartMarker();
+    m_writer.writeForestHeader( classifier.m_classCount, classifier.m_featureCount, getFeatureTypeID<double>() );
+    m_writer.writeCompiledForestTables( classifier );
+    m_writer.writeForestEndMarker();
+}
+
+template <typename FeatureType>
+void BalsaFileWriter::writeCompiledForestTables( const CompiledForestClassifier<FeatureType> & classifier )
+{
+    writeTable( classifier.m_treeRoots );
+    writeTable( classifier.m_leftChildID );
+    writeTable( classifier.m_rightChildID );
+    writeTable( classifier.m_splitFeatureID );
+    writeTable( classifier.m_splitValue );
+    writeTable( classifier.m_label );
+    writeTable( classifier.m_voteWeight );
+}
+
+template <typename FeatureType>
+void BalsaFileWriter::writeCompressedTreeNodes( const DecisionTreeClassifier<FeatureType> & classifier )
+{
+    // Write the node count.
+    const NodeID nodeCount = classifier.m_leftChildID.getRowCount();
+    serializeVarUInt( m_stream, nodeCount );
+
+    // Write the structure bitmap, with a set bit for every interior node.
+    unsigned char bits = 0;
+    for ( NodeID node = 0; node < nodeCount; ++node )
+    {
+        if ( classifier.m_leftChildID( node, 0 ) != 0 ) bits |= 1 << ( node % 8 );
+        if ( node % 8 == 7 )
+        {
+            serialize( m_stream, bits );
+            bits = 0;
+        }
+    }
+    if ( nodeCount % 8 != 0 ) serialize( m_stream, bits );
+
+    // Write the interior node records. Child IDs are near-sequential in
+    // trained trees, so the left child ID is stored as a varint delta against
+    // the previous left child ID, and the right child ID as a varint delta
+    // against the left child ID of the same node.
+    std::int64_t previousLeft = 0;
+    for ( NodeID node = 0; node < nodeCount; ++node )
+    {
+        const std::int64_t left = classifier.m_leftChildID( node, 0 );
+        if ( left == 0 ) continue;
+        const std::int64_t right = classifier.m_rightChildID( node, 0 );
+
+        serializeVarUInt( m_stream, zigZagEncode( left - previousLeft ) );
+        serializeVarUInt( m_stream, zigZagEncode( right - left ) );
+        serialize( m_stream, classifier.m_splitFeatureID( node, 0 ) );
+        serialize( m_stream, classifier.m_splitValue( node, 0 ) );
+        previousLeft = left;
+    }
+
+    // Write the leaf node labels.
+    for ( NodeID node = 0; node < nodeCount; ++node )
+    {
+        if ( classifier.m_leftChildID( node, 0 ) == 0 ) serialize( m_stream, classifier.m_label( node, 0 ) );
+    }
+}
+
 void BalsaFileWriter::writeEnsembleHeader( unsigned char classCount, unsigned char featureCount )
 {
     Dictionary header;
@@ -717,12 +1142,32 @@ void BalsaFileWriter::writeEnsembleHeader( unsigned char classCount, unsigned ch
     header.serialize( m_stream );
 }
 
-void BalsaFileWriter::writeTreeHeader( unsigned char classCount, unsigned char featureCount, FeatureTypeID featureType )
+void BalsaFileWriter::writeTreeHeader( unsigned char classCount, unsigned char featureCount, FeatureTypeID featureType, bool compressedNodes )
 {
     Dictionary header;
     header.set<uint8_t>( TREE_HEADER_CLASS_COUNT_KEY, classCount );
     header.set<uint8_t>( TREE_HEADER_FEATURE_COUNT_KEY, featureCount );
     header.set<std::string>( TREE_HEADER_FEATURE_TYPE_ID_KEY, getTypeName( featureType ) );
+    if ( compressedNodes ) header.set<std::string>( TREE_HEADER_NODE_ENCODING_KEY, TREE_NODE_ENCODING_COMPRESSED );
+    header.serialize( m_stream );
+}
+
+void BalsaFileWriter::writeForestHeader( unsigned char classCount, unsigned char featureCount, FeatureTypeID featureType )
+{
+    Dictionary header;
+    header.set<uint8_t>( FOREST_HEADER_CLASS_COUNT_KEY, classCount );
+    header.set<uint8_t>( FOREST_HEADER_FEATURE_COUNT_KEY, featureCount );
+    header.set<std::string>( FOREST_HEADER_FEATURE_TYPE_ID_KEY, getTypeName( featureType ) );
+    header.serialize( m_stream );
+}
+
+void BalsaFileWriter::writeSaplingHeader( unsigned char classCount, unsigned char featureCount, unsigned int pointCount, FeatureTypeID featureType )
+{
+    Dictionary header;
+    header.set<uint8_t>( SAPLING_HEADER_CLASS_COUNT_KEY, classCount );
+    header.set<uint8_t>( SAPLING_HEADER_FEATURE_COUNT_KEY, featureCount );
+    header.set<uint32_t>( SAPLING_HEADER_POINT_COUNT_KEY, pointCount );
+    header.set<std::string>( SAPLING_HEADER_FEATURE_TYPE_ID_KEY, getTypeName( featureType ) );
     header.serialize( m_stream );
 }
 
@@ -757,6 +1202,16 @@ void BalsaFileWriter::writeTreeEndMarker()
     m_stream.write( TREE_END_MARKER.data(), TREE_END_MARKER.size() );
 }
 
+void BalsaFileWriter::writeForestStartMarker()
+{
+    m_stream.write( FOREST_START_MARKER.data(), FOREST_START_MARKER.size() );
+}
+
+void BalsaFileWriter::writeForestEndMarker()
+{
+    m_stream.write( FOREST_END_MARKER.data(), FOREST_END_MARKER.size() );
+}
+
 void BalsaFileWriter::writeTableStartMarker()
 {
     m_stream.write( TABLE_START_MARKER.data(), TABLE_START_MARKER.size() );
@@ -803,6 +1258,12 @@ ScalarTypeID getScalarTypeID<int32_t>()
     return ScalarTypeID::INT32;
 }
 
+template <>
+ScalarTypeID getScalarTypeID<Float16>()
+{
+    return ScalarTypeID::FLOAT16;
+}
+
 template <>
 ScalarTypeID getScalarTypeID<float>()
 {
@@ -9,6 +9,7 @@
 #include "classifiervisitor.h"
 #include "datatypes.h"
 #include "exceptions.h"
+#include "float16.h"
 #include "table.h"
 
 namespace balsa
@@ -25,6 +26,7 @@ enum class ScalarTypeID
     INT8,
     INT16,
     INT32,
+    FLOAT16,
     FLOAT,
     DOUBLE,
     BOOL
@@ -73,8 +75,31 @@ struct EnsembleHeader
  */
 struct TreeHeader
 {
-    unsigned char classCount;    // Number of classes distinguished by the tree.
-    unsigned char featureCount;  // Number of features the tree was trained on.
+    unsigned char classCount;      // Number of classes distinguished by the tree.
+    unsigned char featureCount;    // Number of features the tree was trained on.
+    FeatureTypeID featureTypeID;   // Numeric type used for features.
+    bool          compressedNodes; // Whether the node data uses the compressed encoding.
+};
+
+/**
+ * Description of a compiled forest (see CompiledForestClassifier).
+ */
+struct ForestHeader
+{
+    unsigned char classCount;    // Number of classes distinguished by the forest.
+    unsigned char featureCount;  // Number of features the forest was trained on.
+    FeatureTypeID featureTypeID; // Numeric type used for features.
+};
+
+/**
+ * Description of a serialized sapling: the pre-sorted training index of a
+ * single-node IndexedDecisionTree.
+ */
+struct SaplingHeader
+{
+    unsigned char classCount;    // Number of classes distinguished by the sapling.
+    unsigned char featureCount;  // Number of features the sapling was built on.
+    unsigned int  pointCount;    // Number of data points in the index.
     FeatureTypeID featureTypeID; // Numeric type used for features.
 };
 
@@ -88,6 +113,61 @@ struct TableHeader
     ScalarTypeID scalarTypeID; // Numeric type of the elements of the table.
 };
 
+/**
+ * A read-only memory mapping of a file.
+ *
+ * The mapping is established on construction and released on destruction.
+ * Mapped files can be shared between owners (e.g. classifiers that hold views
+ * of the mapped data) using the shared pointer type.
+ */
+class MappedFile
+{
+public:
+
+    typedef std::shared_ptr<MappedFile> SharedPointer;
+
+    /**
+     * Constructor; maps the specified file into memory.
+     */
+    MappedFile( const std::string & filename );
+
+    /**
+     * Destructor; releases the mapping.
+     */
+    ~MappedFile();
+
+    /**
+     * Copy constructor (deleted). Mapped files cannot be copied.
+     */
+    MappedFile( const MappedFile & ) = delete;
+
+    /**
+     * Assignment operator (deleted). Mapped files cannot be assigned.
+     */
+    MappedFile & operator=( const MappedFile & ) = delete;
+
+    /**
+     * Returns a pointer to the first byte of the mapped file data.
+     */
+    const char * getData() const
+    {
+        return static_cast<const char *>( m_data );
+    }
+
+    /**
+     * Returns the size of the mapped file in bytes.
+     */
+    std::size_t getSize() const
+    {
+        return m_size;
+    }
+
+private:
+
+    void *      m_data;
+    std::size_t m_size;
+};
+
 /**
  * A parser for files written in the balsa file format.
  */
@@ -97,8 +177,15 @@ public:
 
     /**
      * Constructor; opens the specified file for parsing.
+     *
+     * If \c memoryMap is true, the file is additionally mapped into memory,
+     * and the node tables of parsed classifiers will be lightweight read-only
+     * views of the mapped file data instead of owned copies. Opening large
+     * models is then practically free, and the OS page cache is shared between
+     * concurrent processes that map the same model file. The mapping is kept
+     * alive for as long as any parsed classifier refers to it.
      */
-    BalsaFileParser( const std::string & filename );
+    BalsaFileParser( const std::string & filename, bool memoryMap = false );
 
     /**
      * Returns the major version number of the balsa file format specification
@@ -135,6 +222,16 @@ public:
      */
     std::optional<unsigned int> getCreatorPatchVersion() const;
 
+    /**
+     * Returns the number of bytes read from the file so far.
+     */
+    std::uint64_t getBytesRead();
+
+    /**
+     * Returns the number of classifiers parsed from the file so far.
+     */
+    std::uint64_t getClassifiersParsed() const;
+
     /**
      * Returns true iff the reader is positioned at the end of the file.
      */
@@ -155,11 +252,27 @@ public:
      */
     bool atTree();
 
+    /**
+     * Returns true iff the reader is positioned at a compiled forest.
+     */
+    bool atForest();
+
+    /**
+     * Returns true iff the reader is positioned at a classifier of any kind
+     * (a decision tree or a compiled forest).
+     */
+    bool atClassifier();
+
     /**
      * Returns true iff the reader is positioned at a table.
      */
     bool atTable();
 
+    /**
+     * Returns true iff the reader is positioned at a sapling.
+     */
+    bool atSapling();
+
     /**
      * Returns true iff the reader is positioned at a decision tree using
      * features of the specified type.
@@ -209,6 +322,29 @@ public:
      */
     void reenterEnsemble();
 
+    /**
+     * Parses a sapling start marker and description.
+     *
+     * After calling this function, the tables that compose the sapling index
+     * can be read using the table parsing functions. Once all tables have been
+     * read, the sapling should be finalized using a call to \c leaveSapling().
+     *
+     * \pre The parser is positioned at a sapling.
+     * \post The parser will be positioned at the first table of the sapling.
+     * \returns Sapling description.
+     */
+    SaplingHeader enterSapling();
+
+    /**
+     * Parses and discards a sapling end marker.
+     *
+     * \pre All tables of the sapling that was entered using \c enterSapling()
+     *  have been read.
+     * \post The parser will be positioned at the next object in the file, or at
+     *  the end of the file if it contains no more objects.
+     */
+    void leaveSapling();
+
     /**
      * Parses a classifier.
      *
@@ -249,6 +385,55 @@ public:
         return result;
     }
 
+    /**
+     * Parses a table start marker and table header, without reading the cell
+     * data.
+     *
+     * After calling this function, the cell data can be read in chunks of rows
+     * using \c parseTableRowsAs(). Once all rows have been read, the table
+     * should be finalized using a call to \c leaveTable().
+     *
+     * \pre The parser is positioned at a table.
+     * \post The parser will be positioned at the first row of the table.
+     * \returns Table description.
+     */
+    TableHeader enterTable();
+
+    /**
+     * Parses up to the specified number of rows of the table that was entered
+     * using \c enterTable(), converting the elements to the requested scalar
+     * type if necessary.
+     *
+     * \pre A table was entered using \c enterTable().
+     * \returns A table containing the parsed rows. The table will contain fewer
+     *  than \c maxRows rows if the end of the table is reached, and no rows at
+     *  all if the table is exhausted.
+     */
+    template <typename ScalarType>
+    Table<ScalarType> parseTableRowsAs( std::size_t maxRows )
+    {
+        // Determine the number of rows left to read.
+        std::size_t rowCount = std::min<std::size_t>( maxRows, m_tableRowsLeft );
+
+        // Allocate a table for the chunk and read the cell data, converting if necessary.
+        Table<ScalarType> result( rowCount, m_tableColumnCount );
+        readTableCellDataAs( result, m_tableScalarTypeID );
+        m_tableRowsLeft -= rowCount;
+
+        // Return the result.
+        return result;
+    }
+
+    /**
+     * Parses and discards a table end marker.
+     *
+     * \pre All rows of the table that was entered using \c enterTable() have
+     *  been read using \c parseTableRowsAs().
+     * \post The parser will be positioned at the next object in the file, or at
+     *  the end of the file if it contains no more objects.
+     */
+    void leaveTable();
+
     /**
      * Parses a table containing elements of the specified scalar type. If the
      * table stored in the file contains elements of a different scalar type,
@@ -268,69 +453,143 @@ public:
         // Parse the table header.
         TableHeader header = parseTableHeader();
 
-        // Allocate a table.
+        // Allocate a table and read the cell data, converting if necessary.
         Table<ScalarType> result( header.rowCount, header.columnCount );
+        readTableCellDataAs( result, header.scalarTypeID );
+
+        // Parse the table end marker.
+        parseTableEndMarker();
+
+        // Return the result.
+        return result;
+    }
 
-        // Read the table, convert if necessary.
-        auto sourceType      = header.scalarTypeID;
+private:
+
+    /**
+     * Read the cell data of a (chunk of a) table from the stream, converting
+     * the elements from the specified source type if necessary.
+     */
+    template <typename ScalarType>
+    void readTableCellDataAs( Table<ScalarType> & table, ScalarTypeID sourceType )
+    {
         auto destinationType = getScalarTypeID<ScalarType>();
         if ( destinationType == sourceType )
         {
             // No conversion is necessary if source and destination types are the same.
-            result.readCellData( m_stream );
+            table.readCellData( m_stream );
         }
         else if ( sourceType == getScalarTypeID<float>() )
         {
             // Read as floats, convert to target type.
-            result.template readCellDataAs<float>( m_stream );
+            table.template readCellDataAs<float>( m_stream );
+        }
+        else if ( sourceType == getScalarTypeID<double>() )
+        {
+            // Read as doubles, convert to target type.
+            table.template readCellDataAs<double>( m_stream );
         }
         else if ( sourceType == getScalarTypeID<int32_t>() )
         {
-            // Read as floats, convert to target type.
-            result.template readCellDataAs<int32_t>( m_stream );
+            // Read as 32-bit signed integers, convert to target type.
+            table.template readCellDataAs<int32_t>( m_stream );
         }
         else if ( sourceType == getScalarTypeID<uint8_t>() )
         {
-            // Read as floats, convert to target type.
-            result.template readCellDataAs<uint8_t>( m_stream );
+            // Read as 8-bit unsigned integers, convert to target type.
+            table.template readCellDataAs<uint8_t>( m_stream );
+        }
+        else if ( sourceType == getScalarTypeID<Float16>() )
+        {
+            // Read as half precision floats, convert to target type.
+            table.template readCellDataAs<Float16>( m_stream );
         }
         else
         {
             throw ParseError( "Unsupported type conversion." );
         }
+    }
 
-        // Parse the table end marker.
+    /**
+     * Parses a table containing elements of the specified scalar type as a
+     * read-only view of the memory-mapped file data, without copying the cell
+     * data.
+     *
+     * N.B. the cell data is accessed at its natural file offset, which is not
+     * necessarily aligned to the element size. This is harmless on the
+     * platforms supported by the memory-mapped mode.
+     *
+     * \pre The file was opened with memory mapping enabled.
+     */
+    template <typename ScalarType>
+    Table<ScalarType> parseTableView()
+    {
+        assert( m_mappedFile );
+
+        // Parse the table start marker.
+        parseTableStartMarker();
+
+        // Parse the table header.
+        TableHeader header = parseTableHeader();
+
+        // Check the scalar type.
+        if ( header.scalarTypeID != getScalarTypeID<ScalarType>() )
+            throw ParseError( "Table has incompatible scalar type." );
+
+        // Create a view of the cell data in the mapped file.
+        std::size_t offset    = static_cast<std::size_t>( m_stream.tellg() );
+        std::size_t byteCount = static_cast<std::size_t>( header.rowCount ) * header.columnCount * sizeof( ScalarType );
+        if ( offset + byteCount > m_mappedFile->getSize() ) throw ParseError( "Table data extends beyond the end of the file." );
+        auto cellData = reinterpret_cast<const ScalarType *>( m_mappedFile->getData() + offset );
+        auto result   = Table<ScalarType>::createView( cellData, header.rowCount, header.columnCount );
+
+        // Skip past the cell data and parse the table end marker.
+        m_stream.seekg( byteCount, std::ios::cur );
         parseTableEndMarker();
 
         // Return the result.
         return result;
     }
 
-private:
-
     void parseFileSignature();
     void parseEnsembleStartMarker();
     void parseEnsembleEndMarker();
     void parseTreeStartMarker();
     void parseTreeEndMarker();
+    void parseForestStartMarker();
+    void parseForestEndMarker();
     void parseTableStartMarker();
     void parseTableEndMarker();
+    void parseSaplingEndMarker();
 
     bool atTableOfType( ScalarTypeID typeID );
     bool atTreeOfType( FeatureTypeID typeID );
 
     EnsembleHeader parseEnsembleHeader();
     TreeHeader     parseTreeHeader();
+    ForestHeader   parseForestHeader();
     TableHeader    parseTableHeader();
+    SaplingHeader  parseSaplingHeader();
+
+    template <typename FeatureType>
+    Classifier::SharedPointer parseCompressedTree( const TreeHeader & header );
+
+    template <typename FeatureType>
+    Classifier::SharedPointer parseCompiledForest( const ForestHeader & header );
 
     std::ifstream               m_stream;
+    MappedFile::SharedPointer   m_mappedFile;
     std::streampos              m_treeOffset;
+    std::size_t                 m_tableRowsLeft;
+    std::size_t                 m_tableColumnCount;
+    ScalarTypeID                m_tableScalarTypeID;
     unsigned int                m_fileMajorVersion;
     unsigned int                m_fileMinorVersion;
     std::optional<std::string>  m_creatorName;
     std::optional<unsigned int> m_creatorMajorVersion;
     std::optional<unsigned int> m_creatorMinorVersion;
     std::optional<unsigned int> m_creatorPatchVersion;
+    std::uint64_t               m_classifiersParsed;
 };
 
 /**
@@ -405,6 +664,26 @@ public:
      */
     void leaveEnsemble();
 
+    /**
+     * Write a sapling start marker and sapling description.
+     *
+     * After calling this function, the tables that compose the sapling index
+     * can be written using the \c writeTable() function. Once all tables have
+     * been written, the sapling should be finalized using a call to the \c
+     * leaveSapling() function.
+     *
+     * \pre The writer is not positioned inside an ensemble.
+     */
+    void enterSapling( unsigned char classCount, unsigned char featureCount, unsigned int pointCount, FeatureTypeID featureType );
+
+    /**
+     * Write a sapling end marker.
+     *
+     * This function should be called after all tables that compose the sapling
+     * index have been written.
+     */
+    void leaveSapling();
+
     /**
      * Write a model to the file.
      *
@@ -413,6 +692,19 @@ public:
      */
     void writeClassifier( const Classifier & classifier );
 
+    /**
+     * Enable or disable the compressed node encoding for trees written with
+     * \c writeClassifier().
+     *
+     * The compressed encoding stores child node IDs as delta/varint values,
+     * and omits the fields that are meaningless for a node (the split data of
+     * leaf nodes, and the label of interior nodes), which typically shrinks
+     * models by a factor of three or more. Compressed trees require a reader
+     * that supports file format version 1.1 or later; readers of older
+     * versions can still read all other objects in the file.
+     */
+    void setCompressedTrees( bool enabled );
+
     /**
      * Write a table to the file.
      *
@@ -427,6 +719,45 @@ public:
         writeTableEndMarker();
     }
 
+    /**
+     * Write a table start marker and table header, without writing any cell
+     * data.
+     *
+     * After calling this function, the cell data can be written in chunks of
+     * rows using \c writeTableRows(). Once exactly \c rowCount rows have been
+     * written, the table should be finalized using a call to \c finishTable().
+     *
+     * \pre The writer is not positioned inside an ensemble.
+     */
+    template <typename ScalarType>
+    void startTable( unsigned int rowCount, unsigned int columnCount )
+    {
+        writeTableStartMarker();
+        writeTableHeader( rowCount, columnCount, getScalarTypeID<ScalarType>() );
+    }
+
+    /**
+     * Append rows of cell data to the table that was started using \c
+     * startTable().
+     *
+     * \pre The column count of the chunk must match the column count that was
+     *  passed to \c startTable().
+     */
+    template <typename ScalarType>
+    void writeTableRows( const Table<ScalarType> & rows )
+    {
+        rows.writeCellData( m_stream );
+    }
+
+    /**
+     * Write a table end marker, finalizing the table that was started using \c
+     * startTable().
+     */
+    void finishTable()
+    {
+        writeTableEndMarker();
+    }
+
 private:
 
     class ClassifierWriteDispatcher: public ClassifierVisitor
@@ -441,6 +772,8 @@ private:
         void visit( const EnsembleClassifier & classifier );
         void visit( const DecisionTreeClassifier<float> & classifier );
         void visit( const DecisionTreeClassifier<double> & classifier );
+        void visit( const CompiledForestClassifier<float> & classifier );
+        void visit( const CompiledForestClassifier<double> & classifier );
 
     private:
 
@@ -451,14 +784,25 @@ private:
     void writeEndiannessMarker();
     void writeTreeStartMarker();
     void writeTreeEndMarker();
+    void writeForestStartMarker();
+    void writeForestEndMarker();
     void writeTableStartMarker();
     void writeTableEndMarker();
     void writeEnsembleHeader( unsigned char classCount, unsigned char featureCount );
-    void writeTreeHeader( unsigned char classCount, unsigned char featureCount, FeatureTypeID featureType );
+    void writeTreeHeader( unsigned char classCount, unsigned char featureCount, FeatureTypeID featureType, bool compressedNodes );
+    void writeForestHeader( unsigned char classCount, unsigned char featureCount, FeatureTypeID featureType );
     void writeTableHeader( unsigned int rowCount, unsigned int columnCount, ScalarTypeID scalarType );
+    void writeSaplingHeader( unsigned char classCount, unsigned char featureCount, unsigned int pointCount, FeatureTypeID featureType );
+
+    template <typename FeatureType>
+    void writeCompressedTreeNodes( const DecisionTreeClassifier<FeatureType> & classifier );
+
+    template <typename FeatureType>
+    void writeCompiledForestTables( const CompiledForestClassifier<FeatureType> & classifier );
 
     std::ofstream m_stream;
     bool          m_insideEnsemble;
+    bool          m_compressTrees;
 };
 
 /**
@@ -485,6 +829,8 @@ ScalarTypeID getScalarTypeID<int16_t>();
 template <>
 ScalarTypeID getScalarTypeID<int32_t>();
 template <>
+ScalarTypeID getScalarTypeID<Float16>();
+template <>
 ScalarTypeID getScalarTypeID<float>();
 template <>
 ScalarTypeID getScalarTypeID<double>();
@@ -0,0 +1,144 @@
+#ifndef FLOAT16_H
+#define FLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace balsa
+{
+
+/**
+ * A half precision (IEEE 754 binary16) floating point value, used as a compact
+ * storage type for feature data.
+ *
+ * Half precision halves the on-disk and in-memory size of a dataset compared
+ * to single precision, at the cost of a shorter (11-bit) significand. It is a
+ * pure storage type: values are converted to single precision for computation,
+ * so tables of this type are typically read through the converting parser
+ * functions (e.g. parseTableAs()). The conversions are implemented in portable
+ * integer arithmetic, with round-to-nearest-even on narrowing.
+ */
+class Float16
+{
+public:
+
+    Float16() = default;
+
+    /**
+     * Constructor; narrows a single precision value to half precision,
+     * rounding to nearest-even. Values beyond the half precision range become
+     * infinities.
+     */
+    explicit Float16( float value )
+    {
+        std::uint32_t bits;
+        std::memcpy( &bits, &value, sizeof( bits ) );
+        const std::uint32_t sign     = ( bits >> 16 ) & 0x8000;
+        const std::uint32_t exponent = ( bits >> 23 ) & 0xFF;
+        const std::uint32_t mantissa = bits & 0x7FFFFF;
+
+        if ( exponent == 0xFF )
+        {
+            // Infinities and NaNs. NaN payloads are not preserved, but NaNs stay NaNs.
+            m_bits = sign | 0x7C00 | ( mantissa ? 0x200 : 0 );
+        }
+        else if ( exponent > 112 + 0x1E )
+        {
+            // Too large to represent, round to infinity.
+            m_bits = sign | 0x7C00;
+        }
+        else if ( exponent > 112 )
+        {
+            // Normal numbers: rebias the exponent and round the mantissa to
+            // 10 bits. A round-up may carry into the exponent, which is
+            // exactly what restores the correctly rounded result.
+            std::uint32_t half      = sign | ( ( exponent - 112 ) << 10 ) | ( mantissa >> 13 );
+            std::uint32_t remainder = mantissa & 0x1FFF;
+            if ( remainder > 0x1000 || ( remainder == 0x1000 && ( half & 1 ) ) ) ++half;
+            m_bits = half;
+        }
+        else if ( exponent >= 102 )
+        {
+            // Subnormal numbers: shift out the rebiased exponent, and round.
+            const unsigned int  shift     = 126 - exponent;
+            std::uint32_t       half      = ( mantissa | 0x800000 ) >> shift;
+            const std::uint32_t remainder = ( mantissa | 0x800000 ) & ( ( 1u << shift ) - 1 );
+            const std::uint32_t halfway   = 1u << ( shift - 1 );
+            if ( remainder > halfway || ( remainder == halfway && ( half & 1 ) ) ) ++half;
+            m_bits = sign | half;
+        }
+        else
+        {
+            // Too small to represent, round to (signed) zero.
+            m_bits = sign;
+        }
+    }
+
+    /**
+     * Widens the value to single precision. The conversion is exact, so it is
+     * allowed to occur implicitly; only the narrowing direction requires an
+     * explicit conversion.
+     */
+    operator float() const
+    {
+        const std::uint32_t sign     = static_cast<std::uint32_t>( m_bits & 0x8000 ) << 16;
+        const std::uint32_t exponent = ( m_bits >> 10 ) & 0x1F;
+        std::uint32_t       mantissa = m_bits & 0x3FF;
+        std::uint32_t       bits;
+
+        if ( exponent == 0x1F )
+        {
+            // Infinities and NaNs.
+            bits = sign | 0x7F800000 | ( mantissa << 13 );
+        }
+        else if ( exponent != 0 )
+        {
+            // Normal numbers: rebias the exponent.
+            bits = sign | ( ( exponent + 112 ) << 23 ) | ( mantissa << 13 );
+        }
+        else if ( mantissa != 0 )
+        {
+            // Subnormal numbers: normalize, since every half precision
+            // subnormal is a normal number in single precision.
+            unsigned int renormalization = 0;
+            while ( !( mantissa & 0x400 ) )
+            {
+                mantissa <<= 1;
+                ++renormalization;
+            }
+            bits = sign | ( ( 113 - renormalization ) << 23 ) | ( ( mantissa & 0x3FF ) << 13 );
+        }
+        else
+        {
+            // (Signed) zero.
+            bits = sign;
+        }
+
+        float result;
+        std::memcpy( &result, &bits, sizeof( result ) );
+        return result;
+    }
+
+    /**
+     * Bitwise equality. N.B. unlike floating point equality, this considers
+     * two NaNs with the same bit pattern equal, and positive and negative
+     * zero distinct.
+     */
+    bool operator==( const Float16 & other ) const
+    {
+        return m_bits == other.m_bits;
+    }
+
+    bool operator!=( const Float16 & other ) const
+    {
+        return m_bits != other.m_bits;
+    }
+
+private:
+
+    std::uint16_t m_bits;
+};
+
+} // namespace balsa
+
+#endif // FLOAT16_H
@@ -2,14 +2,23 @@
 #define INDEXEDDECISIONTREE_H
 
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
 #include <deque>
+#include <exception>
 #include <fstream>
+#include <mutex>
+#include <numeric>
+#include <queue>
+#include <thread>
+#include <type_traits>
 #include <valarray>
 #include <vector>
 
 #include "datatools.h"
 #include "datatypes.h"
 #include "decisiontreeclassifier.h"
+#include "fileio.h"
 #include "iteratortools.h"
 #include "table.h"
 #include "weightedcoin.h"
@@ -17,6 +26,16 @@
 namespace balsa
 {
 
+/**
+ * An enumeration of the available strategies for finding the best split of a
+ * node during training.
+ */
+enum class SplitFindingMode
+{
+    EXACT_SPLITS,    // Evaluate a candidate split at every distinct feature value.
+    HISTOGRAM_SPLITS // Bin feature values into a fixed number of buckets and evaluate splits at bucket edges.
+};
+
 /**
  * A decision tree with an internal search index for fast training.
  */
@@ -40,45 +59,84 @@ public:
     static_assert( std::is_arithmetic<FeatureType>::value, "Feature type should be an integral or floating point type." );
     static_assert( std::is_same<LabelType, Label>::value, "Label type should an unsigned, 8 bits wide, integral type." );
 
+    /**
+     * A floating-point type used to calculate the information gain of splits.
+     * For integral feature types (e.g. quantized feature codes) double
+     * precision is used, since impurities are fractions in [0, 1].
+     */
+    typedef typename std::conditional<std::is_floating_point<FeatureType>::value, FeatureType, double>::type ImpurityType;
+
     /**
      * Creates an indexed decision tree with one root node from scratch.
      * N.B. this is an expensive operation, because construction builds sorted
      * indices. When training multiple trees on the same data, it is much more
      * efficient to create one tree and to copy the initial tree multiple times.
+     * Copies share the sorted indices immutably, and only allocate a compact
+     * per-tree entry permutation per feature, so copies are much cheaper than
+     * the original in both time and memory.
+     * The sorted per-feature indices are independent of each other, so their
+     * construction can be distributed over multiple threads by setting
+     * \c indexThreadCount to a value greater than one.
      */
-    IndexedDecisionTree( FeatureIterator dataPoints, LabelIterator labels, unsigned int featureCount, unsigned int pointCount, unsigned int featuresToConsider, unsigned int maximumDistanceToRoot = std::numeric_limits<unsigned int>::max(), FeatureType impurityTreshold = 0.0 ):
+    IndexedDecisionTree( FeatureIterator dataPoints, LabelIterator labels, unsigned int featureCount, unsigned int pointCount, unsigned int featuresToConsider, unsigned int maximumDistanceToRoot = std::numeric_limits<unsigned int>::max(), ImpurityType impurityTreshold = 0.0, unsigned int indexThreadCount = 1 ):
     m_dataPoints( dataPoints ),
     m_pointCount( pointCount ),
     m_featureCount( featureCount ),
     m_featuresToConsider( featuresToConsider ),
     m_maximumDistanceToRoot( maximumDistanceToRoot ),
-    m_impurityThreshold( impurityTreshold ) // Between 0 and 1. A value of 0 means any split that is an improvement will be made, while any value >= (M - 1)/M, with M the number of features, means no splits will be made.
+    m_impurityThreshold( impurityTreshold ), // Between 0 and 1. A value of 0 means any split that is an improvement will be made, while any value >= (M - 1)/M, with M the number of features, means no splits will be made.
+    m_splitFindingMode( SplitFindingMode::EXACT_SPLITS ),
+    m_histogramBinCount( 256 ),
+    m_nodeBudget( 0 ),
+    m_activeSplits( 0 )
     {
         // Check pre-conditions.
         assert( featuresToConsider > 0 && featuresToConsider <= featureCount );
         assert( impurityTreshold >= 0.0 && m_impurityThreshold <= 1.0 );
 
-        // Build a sorted point index for each feature.
-        for ( FeatureID feature = 0; feature < featureCount; ++feature )
+        // Build a sorted point index for each feature. The per-feature builds
+        // are independent, so they can be distributed over multiple threads.
+        // The sorted indices are immutable once built, and shared between all
+        // copies of this tree.
+        auto         sortedIndex  = std::make_shared<std::vector<SingleFeatureIndex>>( featureCount );
+        unsigned int builderCount = std::min( indexThreadCount, featureCount );
+        if ( builderCount <= 1 )
         {
-            // Create an empty index for this feature with enough capacity for one entry per data point.
-            m_featureIndex.push_back( SingleFeatureIndex() );
-            auto & singleFeatureIndex = *m_featureIndex.rbegin();
-            singleFeatureIndex.reserve( pointCount );
-
-            // Add all the data points to the single-feature index.
-            for ( DataPointID point = 0; point < pointCount; ++point )
+            buildFeatureIndices( *sortedIndex, 0, featureCount, labels );
+        }
+        else
+        {
+            // Divide the features as evenly as possible over the builder
+            // threads. Exceptions cannot propagate out of a thread, so they are
+            // captured and re-thrown after all builders have joined.
+            std::vector<std::thread>        builders;
+            std::vector<std::exception_ptr> exceptions( builderCount );
+            for ( unsigned int builder = 0; builder < builderCount; ++builder )
             {
-                auto index = point * m_featureCount + feature;
-                assert( index < ( pointCount * featureCount ) );
-                auto featureValue = dataPoints[point * m_featureCount + feature];
-                if ( std::isnan( featureValue ) ) throw ClientError( "Feature value is not a number." );
-                singleFeatureIndex.push_back( FeatureIndexEntry( featureValue, point, labels[point] ) );
+                FeatureID    firstFeature = ( static_cast<std::size_t>( featureCount ) * builder ) / builderCount;
+                unsigned int lastFeature  = ( static_cast<std::size_t>( featureCount ) * ( builder + 1 ) ) / builderCount;
+                builders.push_back( std::thread(
+                    [this, &sortedIndex, firstFeature, lastFeature, labels, &exceptions, builder]()
+                    {
+                        try
+                        {
+                            buildFeatureIndices( *sortedIndex, firstFeature, lastFeature, labels );
+                        }
+                        catch ( ... )
+                        {
+                            exceptions[builder] = std::current_exception();
+                        }
+                    } ) );
             }
-
-            // Sort the index by feature value.
-            std::sort( singleFeatureIndex.begin(), singleFeatureIndex.end() );
+            for ( auto & builder : builders ) builder.join();
+            for ( auto & exception : exceptions )
+                if ( exception ) std::rethrow_exception( exception );
         }
+        m_sortedIndex = sortedIndex;
+
+        // Visit the entries of each feature in the shared sorted order, i.e.
+        // start with the identity permutation.
+        createIdentityEntryOrder();
 
         // Create a frequency table for all labels in the data set.
         LabelFrequencyTable labelCounts( labels, labels + pointCount );
@@ -92,6 +150,209 @@ public:
         if ( isGrowableNode( 0 ) ) m_growableLeaves.push_back( 0 );
     }
 
+    /**
+     * Copy constructor. The copy shares the immutable sorted indices with the
+     * original, and starts with fresh growth synchronization state.
+     */
+    IndexedDecisionTree( const IndexedDecisionTree & other ):
+    m_dataPoints( other.m_dataPoints ),
+    m_pointCount( other.m_pointCount ),
+    m_featureCount( other.m_featureCount ),
+    m_growableLeaves( other.m_growableLeaves ),
+    m_nodes( other.m_nodes ),
+    m_sortedIndex( other.m_sortedIndex ),
+    m_entryOrder( other.m_entryOrder ),
+    m_coin( other.m_coin ),
+    m_featuresToConsider( other.m_featuresToConsider ),
+    m_maximumDistanceToRoot( other.m_maximumDistanceToRoot ),
+    m_impurityThreshold( other.m_impurityThreshold ),
+    m_splitFindingMode( other.m_splitFindingMode ),
+    m_histogramBinCount( other.m_histogramBinCount ),
+    m_nodeBudget( other.m_nodeBudget ),
+    m_activeSplits( 0 )
+    {
+    }
+
+    /**
+     * Creates a subsampled copy of a single-node tree (sapling).
+     *
+     * The copy is built on the subset of the data points selected by the
+     * supplied per-point multiplicities: points with multiplicity zero are
+     * excluded, points with a higher multiplicity are included that many times
+     * (as produced by bootstrap sampling with replacement). The entry order of
+     * the original sapling is filtered in a single order-preserving pass per
+     * feature, which is much cheaper than building a sorted index for the
+     * subsample from scratch; the sorted indices themselves are shared with
+     * the original sapling.
+     *
+     * \param other The sapling to copy. Must consist of a single root node.
+     * \param multiplicities The number of times each data point is included in
+     *  the subsample. Must contain one entry per data point, and at least one
+     *  non-zero entry.
+     */
+    IndexedDecisionTree( const IndexedDecisionTree & other, const std::vector<unsigned int> & multiplicities ):
+    m_dataPoints( other.m_dataPoints ),
+    m_pointCount( 0 ),
+    m_featureCount( other.m_featureCount ),
+    m_sortedIndex( other.m_sortedIndex ),
+    m_featuresToConsider( other.m_featuresToConsider ),
+    m_maximumDistanceToRoot( other.m_maximumDistanceToRoot ),
+    m_impurityThreshold( other.m_impurityThreshold ),
+    m_splitFindingMode( other.m_splitFindingMode ),
+    m_histogramBinCount( other.m_histogramBinCount ),
+    m_nodeBudget( other.m_nodeBudget ),
+    m_activeSplits( 0 )
+    {
+        // Check pre-conditions.
+        assert( other.m_nodes.size() == 1 );
+        assert( multiplicities.size() == other.m_pointCount );
+
+        // Determine the size of the subsample.
+        std::size_t sampleCount = 0;
+        for ( auto multiplicity : multiplicities ) sampleCount += multiplicity;
+        assert( sampleCount > 0 );
+        m_pointCount = sampleCount;
+
+        // Filter the entry order of each feature, preserving the sort order.
+        m_entryOrder.reserve( other.m_entryOrder.size() );
+        for ( FeatureID feature = 0; feature < other.m_entryOrder.size(); ++feature )
+        {
+            const auto & entries = ( *m_sortedIndex )[feature];
+            m_entryOrder.push_back( EntryPermutation() );
+            auto & filteredOrder = *m_entryOrder.rbegin();
+            filteredOrder.reserve( sampleCount );
+            for ( auto offset : other.m_entryOrder[feature] )
+                for ( auto count = multiplicities[entries[offset].m_pointID]; count > 0; --count ) filteredOrder.push_back( offset );
+        }
+
+        // Create a frequency table for the labels of the sampled points.
+        const auto &        firstFeatureEntries = m_sortedIndex->front();
+        LabelFrequencyTable labelCounts( other.getClassCount() );
+        for ( auto offset : m_entryOrder.front() ) labelCounts.increment( firstFeatureEntries[offset].m_label );
+        assert( labelCounts.getTotal() == sampleCount );
+
+        // Create the root node (it contains all sampled points).
+        m_nodes.push_back( Node( labelCounts, 0, 0 ) );
+
+        // If the root node is still growable, add it to the list of growable nodes.
+        if ( isGrowableNode( 0 ) ) m_growableLeaves.push_back( 0 );
+    }
+
+    /**
+     * Creates a single-node tree (sapling) from a serialized sapling index.
+     *
+     * The sorted feature index is read from the file instead of being built
+     * from scratch, which makes repeated training runs on the same frozen
+     * dataset start growing trees almost immediately. The sapling must have
+     * been written by writeSapling() for the same dataset and labels; the
+     * growth parameters are not part of the serialized sapling and are free to
+     * vary between runs.
+     *
+     * \param parser A parser positioned at a sapling.
+     * \param dataPoints An iterator to the first feature value of the dataset
+     *  the sapling was built on.
+     */
+    IndexedDecisionTree( BalsaFileParser & parser, FeatureIterator dataPoints, unsigned int featureCount, unsigned int pointCount, unsigned int featuresToConsider, unsigned int maximumDistanceToRoot = std::numeric_limits<unsigned int>::max(), ImpurityType impurityTreshold = 0.0 ):
+    m_dataPoints( dataPoints ),
+    m_pointCount( pointCount ),
+    m_featureCount( featureCount ),
+    m_featuresToConsider( featuresToConsider ),
+    m_maximumDistanceToRoot( maximumDistanceToRoot ),
+    m_impurityThreshold( impurityTreshold ),
+    m_splitFindingMode( SplitFindingMode::EXACT_SPLITS ),
+    m_histogramBinCount( 256 ),
+    m_nodeBudget( 0 ),
+    m_activeSplits( 0 )
+    {
+        // Check pre-conditions.
+        assert( featuresToConsider > 0 && featuresToConsider <= featureCount );
+        assert( impurityTreshold >= 0.0 && m_impurityThreshold <= 1.0 );
+
+        // Read and check the sapling description.
+        SaplingHeader header = parser.enterSapling();
+        if ( header.featureTypeID != getFeatureTypeID<FeatureType>() ) throw ClientError( "Sapling has an incompatible feature type." );
+        if ( header.featureCount != featureCount ) throw ClientError( "Sapling was built on a different number of features." );
+        if ( header.pointCount != pointCount ) throw ClientError( "Sapling was built on a different number of data points." );
+
+        // Read the per-point labels.
+        Table<Label> labels = parser.parseTable<Label>();
+        if ( labels.getRowCount() != pointCount || labels.getColumnCount() != 1 ) throw ParseError( "Malformed sapling label table." );
+
+        // Read the sorted index of each feature. The sorted indices are
+        // immutable once read, and shared between all copies of this tree.
+        auto sortedIndex = std::make_shared<std::vector<SingleFeatureIndex>>();
+        sortedIndex->reserve( featureCount );
+        for ( FeatureID feature = 0; feature < featureCount; ++feature )
+        {
+            auto featureValues = parser.parseTable<FeatureType>();
+            auto pointIDs      = parser.parseTable<DataPointID>();
+            if ( featureValues.getRowCount() != pointCount || pointIDs.getRowCount() != pointCount ) throw ParseError( "Malformed sapling index table." );
+            sortedIndex->push_back( SingleFeatureIndex() );
+            auto & singleFeatureIndex = *sortedIndex->rbegin();
+            singleFeatureIndex.reserve( pointCount );
+            for ( DataPointID entry = 0; entry < pointCount; ++entry )
+            {
+                auto pointID = pointIDs( entry, 0 );
+                if ( pointID >= pointCount ) throw ParseError( "Sapling index table contains an out of range point ID." );
+                singleFeatureIndex.push_back( FeatureIndexEntry( featureValues( entry, 0 ), pointID, labels( pointID, 0 ) ) );
+            }
+        }
+        parser.leaveSapling();
+        m_sortedIndex = sortedIndex;
+
+        // Visit the entries of each feature in the shared sorted order, i.e.
+        // start with the identity permutation.
+        createIdentityEntryOrder();
+
+        // Create a frequency table for all labels in the data set.
+        LabelFrequencyTable labelCounts( labels.begin(), labels.end() );
+        assert( pointCount == labelCounts.getTotal() );
+
+        // Create the root node (it contains all points).
+        m_nodes.push_back( Node( labelCounts, 0, 0 ) );
+
+        // If the root node is still growable, add it to the list of growable nodes.
+        if ( isGrowableNode( 0 ) ) m_growableLeaves.push_back( 0 );
+    }
+
+    /**
+     * Write the sapling (the sorted feature index and the per-point labels) to
+     * a balsa file, so future training runs on the same dataset can skip index
+     * construction entirely.
+     * \pre The tree consists of a single root node.
+     */
+    void writeSapling( BalsaFileWriter & writer ) const
+    {
+        // Check the precondition.
+        assert( m_nodes.size() == 1 );
+
+        // Write the sapling description.
+        writer.enterSapling( getClassCount(), m_featureCount, m_pointCount, getFeatureTypeID<FeatureType>() );
+
+        // Write the per-point labels, recovered from the first single-feature index.
+        Table<Label> labels( m_pointCount, 1 );
+        for ( auto & entry : m_sortedIndex->front() ) labels( entry.m_pointID, 0 ) = entry.m_label;
+        writer.writeTable( labels );
+
+        // Write the sorted index of each feature as a table of feature values
+        // and a table of point IDs.
+        Table<FeatureType> featureValues( m_pointCount, 1 );
+        Table<DataPointID> pointIDs( m_pointCount, 1 );
+        for ( auto & singleFeatureIndex : *m_sortedIndex )
+        {
+            for ( DataPointID entry = 0; entry < m_pointCount; ++entry )
+            {
+                featureValues( entry, 0 ) = singleFeatureIndex[entry].m_featureValue;
+                pointIDs( entry, 0 )      = singleFeatureIndex[entry].m_pointID;
+            }
+            writer.writeTable( featureValues );
+            writer.writeTable( pointIDs );
+        }
+
+        // Finalize the sapling.
+        writer.leaveSapling();
+    }
+
     /**
      * Returns the number of classes distinguished by this decision tree.
      */
@@ -101,6 +362,100 @@ public:
         return rootNode.getLabelCounts().size();
     }
 
+    /**
+     * Returns the number of features in the dataset the tree is trained on.
+     */
+    unsigned int getFeatureCount() const
+    {
+        return m_featureCount;
+    }
+
+    /**
+     * Returns the number of data points the tree is trained on.
+     */
+    unsigned int getPointCount() const
+    {
+        return m_pointCount;
+    }
+
+    /**
+     * Returns the current number of nodes in the tree.
+     */
+    unsigned int getNodeCount() const
+    {
+        return m_nodes.size();
+    }
+
+    /**
+     * Returns the current number of growable leaves, a measure of the amount
+     * of growth work remaining. Safe to call while the tree is being grown.
+     */
+    unsigned int getGrowableLeafCount() const
+    {
+        std::lock_guard<std::mutex> lock( m_frontierMutex );
+        return m_growableLeaves.size();
+    }
+
+    /**
+     * Returns the split finding mode used during training.
+     */
+    SplitFindingMode getSplitFindingMode() const
+    {
+        return m_splitFindingMode;
+    }
+
+    /**
+     * Set the split finding mode used during training.
+     *
+     * In the (default) exact mode, a candidate split is evaluated at every
+     * distinct feature value within a node. In histogram mode, the feature
+     * values within a node are binned into a fixed number of buckets, and
+     * candidate splits are only evaluated at bucket edges. This bounds the
+     * amount of work per node and feature, at the cost of a slightly less
+     * optimal split. Copies of this tree inherit the mode, so setting it on a
+     * sapling before training applies it to the entire forest.
+     *
+     * \param mode The split finding mode to use.
+     * \param histogramBinCount The number of buckets used in histogram mode
+     *  (ignored in exact mode). Must be at least 2.
+     */
+    void setSplitFindingMode( SplitFindingMode mode, unsigned int histogramBinCount = 256 )
+    {
+        if ( histogramBinCount < 2 ) throw ClientError( "The number of histogram bins must be at least 2." );
+        m_splitFindingMode  = mode;
+        m_histogramBinCount = histogramBinCount;
+    }
+
+    /**
+     * Returns the node budget used during training (0 means unlimited).
+     */
+    unsigned int getNodeBudget() const
+    {
+        return m_nodeBudget;
+    }
+
+    /**
+     * Set the node budget used during training.
+     *
+     * With the (default) unlimited budget, every growable leaf is grown until
+     * the depth- and purity limits are reached. With a non-zero budget, the
+     * tree is grown best-first instead: the growable leaf whose best split
+     * removes the most impurity (impurity reduction times point count) is
+     * always split first, and growth stops as soon as another split would
+     * exceed the budget. This caps the size of the tree directly, while
+     * spending the available nodes where they improve the tree the most. A
+     * budget below 3 leaves the tree a single node. Copies of this tree
+     * inherit the budget, so setting it on a sapling before training applies
+     * it to the entire forest.
+     *
+     * \param maximumNodeCount The maximum number of nodes in the tree, or 0
+     *  for unlimited growth.
+     */
+    void setNodeBudget( unsigned int maximumNodeCount )
+    {
+        m_nodeBudget = maximumNodeCount;
+    }
+
     /**
      * Reinitialize the state of the random engine used to select features to
      * consider when deciding where to split.
@@ -111,11 +466,63 @@ public:
     }
 
     /**
-     * Grows the entire tree until no more progress is possible.
+     * Grows the entire tree until no more progress is possible, or until the
+     * node budget is spent (see setNodeBudget()).
+     *
+     * With a thread count greater than one, the growable leaves are processed
+     * by a pool of threads over the shared frontier (as in
+     * growCooperatively()), and the entry order partitioning of large nodes is
+     * itself distributed over the idle threads, so a single tree can saturate
+     * the machine even while the frontier is still narrow. The threads are
+     * seeded from the master seed sequence, and which thread claims which leaf
+     * depends on thread timing, so the grown tree is not reproducible from the
+     * seeds alone. With a node budget, growth is best-first, which is strictly
+     * ordered, so it always runs on the calling thread.
+     *
+     * \param threadCount Number of threads used to grow the tree.
      */
-    void grow()
+    void grow( unsigned int threadCount = 1 )
     {
-        while ( isGrowable() ) growNextLeaf();
+        // With a node budget, growth is best-first and inherently sequential.
+        if ( m_nodeBudget != 0 )
+        {
+            growBestFirst();
+            return;
+        }
+
+        // Without extra threads, grow the leaves on the calling thread.
+        if ( threadCount <= 1 )
+        {
+            while ( isGrowable() ) growNextLeaf();
+            return;
+        }
+
+        // Grow the frontier with a pool of threads. Exceptions cannot
+        // propagate out of a thread, so they are captured and re-thrown after
+        // all growers have joined.
+        std::vector<std::thread>        growers;
+        std::vector<std::exception_ptr> exceptions( threadCount );
+        for ( unsigned int grower = 0; grower < threadCount; ++grower )
+        {
+            auto seed = getMasterSeedSequence().next();
+            growers.push_back( std::thread(
+                [this, seed, threadCount, &exceptions, grower]()
+                {
+                    try
+                    {
+                        WeightedCoinType coin;
+                        coin.seed( seed );
+                        cooperativeGrowthLoop( coin, threadCount );
+                    }
+                    catch ( ... )
+                    {
+                        exceptions[grower] = std::current_exception();
+                    }
+                } ) );
+        }
+        for ( auto & grower : growers ) grower.join();
+        for ( auto & exception : exceptions )
+            if ( exception ) std::rethrow_exception( exception );
     }
 
     /**
@@ -141,6 +548,35 @@ public:
         growLeaf( leaf );
     }
 
+    /**
+     * Grows the tree until no more progress is possible, cooperating with any
+     * other threads that call this method on the same tree concurrently. The
+     * cooperating threads claim growable leaves from the shared frontier;
+     * distinct leaves cover disjoint ranges of the entry order, so the
+     * expensive split search and index partitioning run concurrently, and only
+     * the structural changes to the tree are serialized. A single caller grows
+     * the exact same tree as seed() followed by grow().
+     *
+     * \param seed Seed for the caller-local random engine used to select the
+     *  features to consider when splitting the leaves claimed by this caller.
+     *  Which thread claims which leaf depends on thread timing, so when
+     *  several threads cooperate, the grown tree is not reproducible from the
+     *  seeds alone.
+     * \pre The node budget is unlimited (best-first growth is inherently
+     *  ordered, see setNodeBudget()).
+     */
+    void growCooperatively( SeedType seed )
+    {
+        // Check precondition.
+        assert( m_nodeBudget == 0 );
+
+        // Feature selection uses a caller-local coin, so concurrent growers
+        // do not contend for the tree-level random engine.
+        WeightedCoinType coin;
+        coin.seed( seed );
+        cooperativeGrowthLoop( coin, 1 );
+    }
+
     /**
      * Write the tree model to a Dotty file, suitable for visualization
      */
@@ -215,14 +651,27 @@ public:
 private:
 
     /**
-     * A floating-point type used to calculate the information gain of splits.
+     * A list of points and labels, sorted by one particular feature. The
+     * sorted lists are built once, and shared immutably between all copies of
+     * a tree.
+     */
+    typedef std::vector<FeatureIndexEntry> SingleFeatureIndex;
+
+    /**
+     * A per-tree visiting order over a shared single-feature index, as a list
+     * of offsets into that index. Growing a tree partitions the permutations,
+     * never the shared entries, so each copy of a tree only owns these
+     * compact buffers.
      */
-    typedef FeatureType ImpurityType;
+    typedef std::uint32_t            EntryOffset;
+    typedef std::vector<EntryOffset> EntryPermutation;
 
     /**
-     * A list of points and labels, sorted by one particular feature.
+     * Minimum number of points in a node for which the entry order
+     * partitioning is distributed over idle grower threads. For smaller
+     * nodes, the partitioning is cheaper than the thread hand-off.
      */
-    typedef std::vector<FeatureIndexEntry> SingleFeatureIndex;
+    static const std::size_t PARALLEL_PARTITION_MINIMUM = 32768;
 
     /**
      * The combination of a Split (i.e. the separation of a set of points along one feature axis) and the label frequency tables
@@ -239,7 +688,7 @@ private:
         SplitCandidate():
         m_leftCounts( 0 ),
         m_rightCounts( 0 ),
-        m_impurity( std::numeric_limits<FeatureType>::max() )
+        m_impurity( std::numeric_limits<ImpurityType>::max() )
         {
         }
 
@@ -299,6 +748,32 @@ private:
         ImpurityType        m_impurity;
     };
 
+    /**
+     * A leaf on the best-first growth frontier: the best split found for the
+     * leaf, ordered by the total amount of impurity that split removes.
+     */
+    class FrontierLeaf
+    {
+    public:
+
+        FrontierLeaf( ImpurityType impurityReduction, NodeID node, const SplitCandidate & split ):
+        m_impurityReduction( impurityReduction ),
+        m_node( node ),
+        m_split( split )
+        {
+        }
+
+        bool operator<( const FrontierLeaf & other ) const
+        {
+            // Leaves are to be ordered by impurity reduction only.
+            return m_impurityReduction < other.m_impurityReduction;
+        }
+
+        ImpurityType   m_impurityReduction;
+        NodeID         m_node;
+        SplitCandidate m_split;
+    };
+
     /**
      * Internal representation of a node in the decision tree.
      */
@@ -454,32 +929,126 @@ private:
         Label       m_label;
     };
 
+    /**
+     * Build and sort the single-feature indices for a contiguous range of
+     * features. The target entries of the supplied index must already exist.
+     */
+    void buildFeatureIndices( std::vector<SingleFeatureIndex> & sortedIndex, FeatureID firstFeature, unsigned int lastFeature, LabelIterator labels )
+    {
+        for ( FeatureID feature = firstFeature; feature < lastFeature; ++feature )
+        {
+            // Reserve enough capacity for one entry per data point.
+            auto & singleFeatureIndex = sortedIndex[feature];
+            singleFeatureIndex.reserve( m_pointCount );
+
+            // Add all the data points to the single-feature index.
+            for ( DataPointID point = 0; point < m_pointCount; ++point )
+            {
+                auto index = point * m_featureCount + feature;
+                assert( index < ( static_cast<std::size_t>( m_pointCount ) * m_featureCount ) );
+                auto featureValue = m_dataPoints[index];
+                if ( std::isnan( featureValue ) ) throw ClientError( "Feature value is not a number." );
+                singleFeatureIndex.push_back( FeatureIndexEntry( featureValue, point, labels[point] ) );
+            }
+
+            // Sort the index by feature value.
+            std::sort( singleFeatureIndex.begin(), singleFeatureIndex.end() );
+        }
+    }
+
+    /**
+     * Create the identity entry permutation for each feature, which visits
+     * the entries of the shared sorted index in their sorted order.
+     */
+    void createIdentityEntryOrder()
+    {
+        m_entryOrder.resize( m_sortedIndex->size() );
+        for ( auto & order : m_entryOrder )
+        {
+            order.resize( m_pointCount );
+            std::iota( order.begin(), order.end(), EntryOffset( 0 ) );
+        }
+    }
+
     /**
      * Apply the specified split to the node.
      * \pre The node must be a leaf node.
      */
     void splitNode( NodeID nodeID, const SplitCandidate & splitCandidate )
+    {
+        partitionEntryOrder( m_nodes[nodeID], splitCandidate );
+        commitSplit( nodeID, splitCandidate );
+    }
+
+    /**
+     * Partition the entry order of each feature along the specified split of
+     * the node. This touches only the entry order ranges owned by the node,
+     * which no other leaf overlaps. The per-feature partitions are
+     * independent, so they can be distributed over multiple threads.
+     * \pre The node must be a leaf node.
+     */
+    void partitionEntryOrder( const Node & node, const SplitCandidate & splitCandidate, unsigned int threadCount = 1 )
     {
         // Check the precondition.
-        Node & node = m_nodes[nodeID];
         assert( node.isLeafNode() );
 
+        // Without extra threads, partition all features on the calling thread.
+        unsigned int partitionerCount = std::min( threadCount, m_featureCount );
+        if ( partitionerCount <= 1 )
+        {
+            partitionEntryOrderRange( node, splitCandidate, 0, m_entryOrder.size() );
+            return;
+        }
+
+        // Divide the features as evenly as possible over the partitioner
+        // threads. Exceptions cannot propagate out of a thread, so they are
+        // captured and re-thrown after all partitioners have joined.
+        std::vector<std::thread>        partitioners;
+        std::vector<std::exception_ptr> exceptions( partitionerCount );
+        for ( unsigned int partitioner = 0; partitioner < partitionerCount; ++partitioner )
+        {
+            FeatureID    firstFeature = ( static_cast<std::size_t>( m_featureCount ) * partitioner ) / partitionerCount;
+            unsigned int lastFeature  = ( static_cast<std::size_t>( m_featureCount ) * ( partitioner + 1 ) ) / partitionerCount;
+            partitioners.push_back( std::thread(
+                [this, &node, &splitCandidate, firstFeature, lastFeature, &exceptions, partitioner]()
+                {
+                    try
+                    {
+                        partitionEntryOrderRange( node, splitCandidate, firstFeature, lastFeature );
+                    }
+                    catch ( ... )
+                    {
+                        exceptions[partitioner] = std::current_exception();
+                    }
+                } ) );
+        }
+        for ( auto & partitioner : partitioners ) partitioner.join();
+        for ( auto & exception : exceptions )
+            if ( exception ) std::rethrow_exception( exception );
+    }
+
+    /**
+     * Partition the entry order of a contiguous range of features along the
+     * specified split of the node (see partitionEntryOrder()).
+     */
+    void partitionEntryOrderRange( const Node & node, const SplitCandidate & splitCandidate, FeatureID firstFeature, unsigned int lastFeature )
+    {
         // Split the feature index.
         std::size_t leftPointCount = splitCandidate.getLeftCounts().getTotal();
-        assert( node.isLeafNode() );
-        for ( FeatureID featureID = 0; featureID < m_featureIndex.size(); ++featureID )
+        for ( FeatureID featureID = firstFeature; featureID < lastFeature; ++featureID )
         {
             // No work is necessary for the feature on which the split is performed.
             auto splitFeature = splitCandidate.getSplit().getFeatureID();
             auto splitValue   = splitCandidate.getSplit().getFeatureValue();
             if ( featureID == splitFeature ) continue;
 
-            // For other features, partition the points in the index along the split edge, but keep them sorted.
-            auto nodeDataStart = m_featureIndex[featureID].begin() + node.getIndexOffset();
-            auto nodeDataEnd   = nodeDataStart + node.getPointCount();
-            auto predicate     = [this, splitFeature, splitValue]( const auto & entry ) -> bool
+            // For other features, partition the points in the entry order along the split edge, but keep them sorted.
+            const auto & entries       = ( *m_sortedIndex )[featureID];
+            auto         nodeDataStart = m_entryOrder[featureID].begin() + node.getIndexOffset();
+            auto         nodeDataEnd   = nodeDataStart + node.getPointCount();
+            auto         predicate     = [this, &entries, splitFeature, splitValue]( EntryOffset offset ) -> bool
             {
-                return this->m_dataPoints[entry.m_pointID * this->m_featureCount + splitFeature] < splitValue;
+                return this->m_dataPoints[entries[offset].m_pointID * this->m_featureCount + splitFeature] < splitValue;
             };
 
             auto secondNodeData = std::stable_partition( nodeDataStart, nodeDataEnd, predicate );
@@ -492,10 +1061,23 @@ private:
             assert( newLeftPointCount == leftPointCount );
         }
         assert( node.isLeafNode() );
+    }
+
+    /**
+     * Record the specified split in the node, and append the two child nodes.
+     * \pre The entry order has been partitioned along the split (see
+     *  partitionEntryOrder()).
+     */
+    void commitSplit( NodeID nodeID, const SplitCandidate & splitCandidate )
+    {
+        // Check the precondition.
+        Node & node = m_nodes[nodeID];
+        assert( node.isLeafNode() );
 
         // Create the child nodes before adding them to the node table, because that will invalidate the 'node' reference.
-        NodeID leftChildID  = m_nodes.size();
-        NodeID rightChildID = leftChildID + 1;
+        std::size_t leftPointCount = splitCandidate.getLeftCounts().getTotal();
+        NodeID      leftChildID    = m_nodes.size();
+        NodeID      rightChildID   = leftChildID + 1;
         assert( leftPointCount );
         Node leftChild  = Node( splitCandidate.getLeftCounts(), node.getIndexOffset(), node.getDistanceToRoot() + 1 );
         Node rightChild = Node( splitCandidate.getRightCounts(), node.getIndexOffset() + splitCandidate.getLeftCounts().getTotal(), node.getDistanceToRoot() + 1 );
@@ -515,43 +1097,51 @@ private:
      * selected features into account.
      */
     SplitCandidate findBestSplit( NodeID node )
+    {
+        return findBestSplit( m_nodes[node], m_coin );
+    }
+
+    /**
+     * Find the best possible split for the specified leaf node, taking
+     * randomly selected features into account. The features are selected with
+     * the supplied random engine, so concurrent growers can search with their
+     * own engines.
+     */
+    SplitCandidate findBestSplit( const Node & node, WeightedCoinType & coin ) const
     {
         // Check precondition.
         assert( m_featuresToConsider <= m_featureCount );
 
-        // Randomly scan the required number of features.
+        // Draw the feature subset for this node in a single batched call.
+        std::vector<FeatureID> selectedFeatures;
+        coin.drawSubset( m_featuresToConsider, m_featureCount, selectedFeatures );
+
+        // Scan the selected features.
         SplitCandidate bestSplit;
-        assert( bestSplit.getImpurity() > m_nodes[node].getLabelCounts().template giniImpurity<ImpurityType>() );
-        auto                   featuresToScan = m_featuresToConsider;
-        std::vector<FeatureID> skippedFeatures;
-        for ( FeatureID featureID = 0; featureID < m_featureCount; ++featureID )
+        assert( bestSplit.getImpurity() > node.getLabelCounts().template giniImpurity<ImpurityType>() );
+        for ( auto featureID : selectedFeatures )
         {
-            // Decide whether or not to consider this feature.
-            auto featuresLeft        = m_featureCount - featureID;
-            bool considerThisFeature = m_coin.flip( featuresToScan, featuresLeft );
-            if ( !considerThisFeature )
-            {
-                skippedFeatures.push_back( featureID );
-                continue;
-            }
-
-            // Use up one 'credit'.
-            assert( featuresToScan > 0 );
-            --featuresToScan;
-
             // Scan the feature for a split that is better than what was already found.
-            bestSplit = findBestSplitForFeature( m_nodes[node], featureID, bestSplit );
+            bestSplit = findBestSplitForFeature( node, featureID, bestSplit );
         }
-        assert( skippedFeatures.size() == m_featureCount - m_featuresToConsider );
 
         // If a valid split has been found, return it.
         if ( bestSplit.isValid() ) return bestSplit;
 
         // Since no valid split was found, scan all features that were initially skipped.
-        for ( auto featureID : skippedFeatures )
+        auto selected = selectedFeatures.begin();
+        for ( FeatureID featureID = 0; featureID < m_featureCount; ++featureID )
         {
+            // Skip the features that were already scanned. The drawn subset is
+            // in ascending order.
+            if ( selected != selectedFeatures.end() && *selected == featureID )
+            {
+                ++selected;
+                continue;
+            }
+
             // Return the first candidate split.
-            bestSplit = findBestSplitForFeature( m_nodes[node], featureID, bestSplit );
+            bestSplit = findBestSplitForFeature( node, featureID, bestSplit );
             if ( bestSplit.isValid() ) return bestSplit;
         }
 
@@ -570,40 +1160,248 @@ private:
      */
     SplitCandidate findBestSplitForFeature( const Node & node, FeatureID featureID, const SplitCandidate & minimalBestSplit ) const
     {
-        // Find the region of the index that covers this node and feature.
-        auto begin = m_featureIndex[featureID].begin() + node.getIndexOffset();
-        auto end   = begin + node.getPointCount();
+        // Use the histogram engine if it is enabled and the node is large
+        // enough for binning to pay off. For small nodes, the exact scan is
+        // both cheaper and better.
+        if ( m_splitFindingMode == SplitFindingMode::HISTOGRAM_SPLITS && node.getPointCount() > m_histogramBinCount )
+            return findBestSplitForFeatureHistogram( node, featureID, minimalBestSplit );
+        return findBestSplitForFeatureExact( node, featureID, minimalBestSplit );
+    }
+
+    /**
+     * Exact split finding engine: evaluate a candidate split at every distinct
+     * feature value within the node.
+     */
+    SplitCandidate findBestSplitForFeatureExact( const Node & node, FeatureID featureID, const SplitCandidate & minimalBestSplit ) const
+    {
+        // Find the region of the entry order that covers this node and feature.
+        const auto & entries = ( *m_sortedIndex )[featureID];
+        auto         begin   = m_entryOrder[featureID].begin() + node.getIndexOffset();
+        auto         end     = begin + node.getPointCount();
         assert( begin != end );
 
-        // Search for a better split than the supplied minimal best split.
-        auto                bestSplit         = minimalBestSplit;
-        FeatureType         currentBlockValue = begin->m_featureValue;
+        // Search for a better split than the supplied minimal best split. The
+        // running left- and right-hand label counts live in pre-allocated
+        // tables, and the best split found so far is tracked as plain values,
+        // so the innermost scan does not allocate. A SplitCandidate (which
+        // copies the label count tables) is constructed at most once per
+        // feature, after the scan.
+        FeatureType         currentBlockValue = entries[*begin].m_featureValue;
         LabelFrequencyTable leftSideLabelCounts( node.getLabelCounts().size() );
         LabelFrequencyTable rightSideLabelCounts( node.getLabelCounts() );
+        LabelFrequencyTable bestLeftCounts( node.getLabelCounts().size() );
+        ImpurityType        bestImpurity = minimalBestSplit.getImpurity();
+        FeatureType         bestValue    = 0;
+        bool                foundBetter  = false;
+        const std::size_t   totalCount   = node.getPointCount();
 
         assert( leftSideLabelCounts.invariant() );
         assert( rightSideLabelCounts.invariant() );
         for ( auto it( begin ); it != end; ++it )
         {
             // If this is the end of a block of equal-valued points, test if this split would be an improvement over the current best.
-            if ( it->m_featureValue > currentBlockValue )
+            const FeatureIndexEntry & entry = entries[*it];
+            if ( entry.m_featureValue > currentBlockValue )
             {
-                SplitCandidate possibleSplit( Split( featureID, it->m_featureValue ), leftSideLabelCounts, rightSideLabelCounts );
-                if ( possibleSplit.getImpurity() < bestSplit.getImpurity() )
+                auto         leftCount  = leftSideLabelCounts.getTotal();
+                auto         rightCount = rightSideLabelCounts.getTotal();
+                ImpurityType impurity   = ( leftSideLabelCounts.giniImpurity<ImpurityType>() * leftCount + rightSideLabelCounts.giniImpurity<ImpurityType>() * rightCount ) / totalCount;
+                if ( impurity < bestImpurity )
                 {
-                    bestSplit = possibleSplit;
+                    bestImpurity   = impurity;
+                    bestValue      = entry.m_featureValue;
+                    bestLeftCounts = leftSideLabelCounts;
+                    foundBetter    = true;
                 }
             }
 
             // Move the current block value to the value of the currently visited point.
-            currentBlockValue = it->m_featureValue;
+            currentBlockValue = entry.m_featureValue;
 
             // Update the left- and right-hand label counts as the point is visited.
-            leftSideLabelCounts.increment( it->m_label );
-            rightSideLabelCounts.decrement( it->m_label );
+            leftSideLabelCounts.increment( entry.m_label );
+            rightSideLabelCounts.decrement( entry.m_label );
         }
 
-        return bestSplit;
+        // If no improvement was found, the supplied split stands.
+        if ( !foundBetter ) return minimalBestSplit;
+
+        // Reconstruct the right-hand counts of the best split, and build the result.
+        LabelFrequencyTable bestRightCounts( node.getLabelCounts() );
+        for ( Label label = 0; label < bestLeftCounts.size(); ++label ) bestRightCounts.subtract( label, bestLeftCounts.getCount( label ) );
+        return SplitCandidate( Split( featureID, bestValue ), bestLeftCounts, bestRightCounts );
+    }
+
+    /**
+     * Histogram-based split finding engine: bin the feature values within the
+     * node into a fixed number of buckets, and evaluate candidate splits at
+     * bucket edges only. This bounds the number of SplitCandidate evaluations
+     * per node and feature to the bin count, instead of the number of distinct
+     * feature values.
+     */
+    SplitCandidate findBestSplitForFeatureHistogram( const Node & node, FeatureID featureID, const SplitCandidate & minimalBestSplit ) const
+    {
+        // Find the region of the entry order that covers this node and feature.
+        const auto & entries = ( *m_sortedIndex )[featureID];
+        auto         begin   = m_entryOrder[featureID].begin() + node.getIndexOffset();
+        auto         end     = begin + node.getPointCount();
+        assert( begin != end );
+
+        // If all points have the same feature value, there is nothing to split.
+        const FeatureType lowestValue  = entries[*begin].m_featureValue;
+        const FeatureType highestValue = entries[*( end - 1 )].m_featureValue;
+        if ( !( lowestValue < highestValue ) ) return minimalBestSplit;
+
+        // Accumulate per-bucket label counts. The bucket mapping is a
+        // monotonic function of the feature value, so the sort order of the
+        // index carries over to the buckets. Because of that, the lowest
+        // actual feature value in each bucket is the value of the first point
+        // that lands in it.
+        const unsigned int       binCount = m_histogramBinCount;
+        const double             scale    = binCount / ( static_cast<double>( highestValue ) - static_cast<double>( lowestValue ) );
+        std::vector<std::size_t> binLabelCounts( static_cast<std::size_t>( binCount ) * node.getLabelCounts().size(), 0 );
+        std::vector<FeatureType> binLowestValue( binCount );
+        std::vector<bool>        binOccupied( binCount, false );
+        const std::size_t        classCount = node.getLabelCounts().size();
+        for ( auto it( begin ); it != end; ++it )
+        {
+            const FeatureIndexEntry & entry = entries[*it];
+            unsigned int              bin   = ( static_cast<double>( entry.m_featureValue ) - static_cast<double>( lowestValue ) ) * scale;
+            if ( bin >= binCount ) bin = binCount - 1;
+            if ( !binOccupied[bin] )
+            {
+                binOccupied[bin]    = true;
+                binLowestValue[bin] = entry.m_featureValue;
+            }
+            ++binLabelCounts[static_cast<std::size_t>( bin ) * classCount + entry.m_label];
+        }
+
+        // Scan the bucket edges from left to right, maintaining the label
+        // counts on either side. The split value at the edge after a bucket is
+        // the lowest actual feature value in the next occupied bucket, so the
+        // 'feature < value' split predicate separates the points exactly as
+        // counted here, regardless of rounding in the bucket mapping. As in
+        // the exact engine, the best split is tracked as plain values, and a
+        // SplitCandidate is constructed at most once, after the scan.
+        LabelFrequencyTable leftSideLabelCounts( classCount );
+        LabelFrequencyTable rightSideLabelCounts( node.getLabelCounts() );
+        LabelFrequencyTable bestLeftCounts( classCount );
+        ImpurityType        bestImpurity = minimalBestSplit.getImpurity();
+        FeatureType         bestValue    = 0;
+        bool                foundBetter  = false;
+        const std::size_t   totalCount   = node.getPointCount();
+        for ( unsigned int bin = 0; bin + 1 < binCount; ++bin )
+        {
+            // Move the counts of this bucket to the left side.
+            if ( !binOccupied[bin] ) continue;
+            for ( Label label = 0; label < classCount; ++label )
+            {
+                auto count = binLabelCounts[static_cast<std::size_t>( bin ) * classCount + label];
+                if ( count == 0 ) continue;
+                leftSideLabelCounts.add( label, count );
+                rightSideLabelCounts.subtract( label, count );
+            }
+
+            // If there are no points to the right of this edge, there are no further splits.
+            if ( rightSideLabelCounts.getTotal() == 0 ) break;
+
+            // Find the lowest feature value in the next occupied bucket, and
+            // test if splitting there would be an improvement over the current best.
+            unsigned int nextBin = bin + 1;
+            while ( !binOccupied[nextBin] ) ++nextBin;
+            auto         leftCount  = leftSideLabelCounts.getTotal();
+            auto         rightCount = rightSideLabelCounts.getTotal();
+            ImpurityType impurity   = ( leftSideLabelCounts.giniImpurity<ImpurityType>() * leftCount + rightSideLabelCounts.giniImpurity<ImpurityType>() * rightCount ) / totalCount;
+            if ( impurity < bestImpurity )
+            {
+                bestImpurity   = impurity;
+                bestValue      = binLowestValue[nextBin];
+                bestLeftCounts = leftSideLabelCounts;
+                foundBetter    = true;
+            }
+        }
+
+        // If no improvement was found, the supplied split stands.
+        if ( !foundBetter ) return minimalBestSplit;
+
+        // Reconstruct the right-hand counts of the best split, and build the result.
+        LabelFrequencyTable bestRightCounts( node.getLabelCounts() );
+        for ( Label label = 0; label < bestLeftCounts.size(); ++label ) bestRightCounts.subtract( label, bestLeftCounts.getCount( label ) );
+        return SplitCandidate( Split( featureID, bestValue ), bestLeftCounts, bestRightCounts );
+    }
+
+    /**
+     * Grow leaves from the shared frontier until the tree is fully grown,
+     * cooperating with any other threads that run this loop on the same tree.
+     * The cooperating threads claim growable leaves from the shared frontier;
+     * distinct leaves cover disjoint ranges of the entry order, so the
+     * expensive split search and index partitioning run concurrently, and
+     * only the structural changes to the tree are serialized.
+     *
+     * \param coin The caller-local random engine used to select the features
+     *  to consider when splitting the leaves claimed by this caller.
+     * \param threadCount The total number of threads running this loop, used
+     *  to distribute the partitioning of large nodes over the threads that
+     *  are idle while the frontier is narrower than the pool.
+     */
+    void cooperativeGrowthLoop( WeightedCoinType & coin, unsigned int threadCount )
+    {
+        std::unique_lock<std::mutex> lock( m_frontierMutex );
+        while ( true )
+        {
+            // Wait until a growable leaf is available. An empty frontier does
+            // not mean the tree is fully grown: splits that are still in
+            // flight in other threads may yet add growable children.
+            while ( m_growableLeaves.empty() && m_activeSplits != 0 ) m_frontierChanged.wait( lock );
+            if ( m_growableLeaves.empty() ) return;
+
+            // Claim the next growable leaf, and copy its node so the split
+            // search can run without the lock. (Concurrently committed splits
+            // may relocate the node table.)
+            auto leaf = m_growableLeaves.front();
+            m_growableLeaves.pop_front();
+            ++m_activeSplits;
+            Node node = m_nodes[leaf];
+
+            // Estimate the number of idle threads: threads that are neither
+            // splitting a leaf, nor about to claim one from the frontier.
+            unsigned int busyThreads = m_activeSplits + m_growableLeaves.size();
+            unsigned int idleThreads = threadCount > busyThreads ? threadCount - busyThreads : 0;
+            lock.unlock();
+
+            // Find the best split for the leaf, and partition the entry order
+            // of the leaf along it. This is the expensive part: it touches
+            // only the shared, immutable sorted indices and the entry order
+            // ranges owned by the leaf, so it runs concurrently with the
+            // growth of other leaves. Large nodes distribute their per-feature
+            // partitioning over the idle threads, which keeps the whole pool
+            // busy while the frontier is still narrow (near the root).
+            SplitCandidate split;
+            try
+            {
+                split = findBestSplit( node, coin );
+                if ( split.isValid() )
+                {
+                    unsigned int partitionerCount = node.getPointCount() >= PARALLEL_PARTITION_MINIMUM ? idleThreads + 1 : 1;
+                    partitionEntryOrder( node, split, partitionerCount );
+                }
+            }
+            catch ( ... )
+            {
+                // Roll back the claim, so the other growers are not left
+                // waiting for a split that will never complete.
+                lock.lock();
+                --m_activeSplits;
+                m_frontierChanged.notify_all();
+                throw;
+            }
+
+            // Commit the structural changes to the tree.
+            lock.lock();
+            if ( split.isValid() ) commitSplit( leaf, split );
+            --m_activeSplits;
+            m_frontierChanged.notify_all();
+        }
     }
 
     void growLeaf( NodeID nodeID )
@@ -617,6 +1415,56 @@ private:
         if ( split.isValid() ) splitNode( nodeID, split );
     }
 
+    /**
+     * Grows the tree best-first: the growable leaf whose best split removes
+     * the most impurity is always split first, until the node budget is spent
+     * or no growable leaves remain.
+     * \pre m_nodeBudget != 0
+     */
+    void growBestFirst()
+    {
+        // Check precondition.
+        assert( m_nodeBudget != 0 );
+
+        // Score the initial growable leaves (normally just the root).
+        std::priority_queue<FrontierLeaf> frontier;
+        for ( auto leaf : m_growableLeaves ) scoreLeaf( leaf, frontier );
+        m_growableLeaves.clear();
+
+        // Repeatedly apply the best-scoring split, until the budget does not
+        // allow the two nodes of another split.
+        while ( !frontier.empty() && ( m_nodes.size() + 2 <= m_nodeBudget ) )
+        {
+            // Split the best leaf on the frontier. The best split was already
+            // found when the leaf was scored, so it is applied directly.
+            splitNode( frontier.top().m_node, frontier.top().m_split );
+            frontier.pop();
+
+            // Score the growable children of the split (splitNode() appends
+            // them to the growable list), and move them to the frontier.
+            for ( auto leaf : m_growableLeaves ) scoreLeaf( leaf, frontier );
+            m_growableLeaves.clear();
+        }
+    }
+
+    /**
+     * Find the best split for the given leaf, and add the leaf to the
+     * best-first growth frontier, scored by the total amount of impurity its
+     * best split removes. Leaves that cannot be split are not added.
+     */
+    void scoreLeaf( NodeID leaf, std::priority_queue<FrontierLeaf> & frontier )
+    {
+        // Find the best split for the leaf. If there is none, the leaf is never grown.
+        SplitCandidate split = findBestSplit( leaf );
+        if ( !split.isValid() ) return;
+
+        // Score the split by the total amount of impurity it removes: the
+        // impurity reduction within the leaf, times the leaf point count.
+        const Node & node      = m_nodes[leaf];
+        ImpurityType reduction = ( node.getLabelCounts().template giniImpurity<ImpurityType>() - split.getImpurity() ) * node.getPointCount();
+        frontier.push( FrontierLeaf( reduction, leaf, split ) );
+    }
+
     /**
      * Returns true iff it is still meaningful to grow the specified node.
      * \pre Node must be a leaf node.
@@ -639,16 +1487,23 @@ private:
 
 private:
 
-    FeatureIterator                 m_dataPoints;
-    unsigned int                    m_pointCount;
-    unsigned int                    m_featureCount;
-    std::deque<NodeID>              m_growableLeaves;
-    std::vector<Node>               m_nodes;
-    std::vector<SingleFeatureIndex> m_featureIndex;
-    WeightedCoinType                m_coin;
-    std::size_t                     m_featuresToConsider;
-    unsigned int                    m_maximumDistanceToRoot;
-    ImpurityType                    m_impurityThreshold;
+    FeatureIterator                                        m_dataPoints;
+    unsigned int                                           m_pointCount;
+    unsigned int                                           m_featureCount;
+    std::deque<NodeID>                                     m_growableLeaves;
+    std::vector<Node>                                      m_nodes;
+    std::shared_ptr<const std::vector<SingleFeatureIndex>> m_sortedIndex; // Shared immutably between all copies of a tree.
+    std::vector<EntryPermutation>                          m_entryOrder;  // Per-tree visiting order over the shared index.
+    WeightedCoinType                                       m_coin;
+    std::size_t                                            m_featuresToConsider;
+    unsigned int                                           m_maximumDistanceToRoot;
+    ImpurityType                                           m_impurityThreshold;
+    SplitFindingMode                                       m_splitFindingMode;
+    unsigned int                                           m_histogramBinCount;
+    unsigned int                                           m_nodeBudget;
+    mutable std::mutex                                     m_frontierMutex;   // Guards the frontier and node table during cooperative growth.
+    std::condition_variable                                m_frontierChanged; // Signalled when the frontier changes or a split completes.
+    unsigned int                                           m_activeSplits;    // Number of cooperative splits that are in flight.
 };
 
 } // namespace balsa
@@ -1,9 +1,15 @@
 #ifndef MESSAGEQUEUE_H
 #define MESSAGEQUEUE_H
 
+#include <atomic>
+#include <cassert>
+#include <chrono>
 #include <condition_variable>
+#include <cstddef>
 #include <mutex>
 #include <queue>
+#include <thread>
+#include <vector>
 
 namespace balsa
 {
@@ -58,6 +64,192 @@ private:
     std::condition_variable m_condition;
 };
 
+/**
+ * A bounded, lock-free, multi-producer/multi-consumer queue for distributing
+ * messages over threads.
+ *
+ * Unlike MessageQueue, which serializes all access through a single mutex,
+ * this queue exchanges messages through a fixed-size ring buffer using only
+ * atomic operations (after Vyukov's bounded MPMC queue). Messages are moved
+ * rather than copied, and consumers can dequeue small batches at a time, so
+ * queue overhead does not limit scaling at high thread counts.
+ *
+ * Threads that find the queue full (on send) or empty (on receive) yield at
+ * first, and then back off to short sleeps, so a blocked thread does not burn
+ * a full core.
+ *
+ * \tparam Message The message type. It must be default-constructible and
+ *  move-assignable.
+ */
+template <typename Message>
+class BoundedMessageQueue
+{
+public:
+
+    /**
+     * Constructs a queue that holds at least the given number of messages.
+     * \param capacity The minimum capacity (rounded up to a power of two).
+     */
+    explicit BoundedMessageQueue( std::size_t capacity ):
+    m_cells( roundUpToPowerOfTwo( capacity ) ),
+    m_mask( m_cells.size() - 1 ),
+    m_head( 0 ),
+    m_tail( 0 )
+    {
+        assert( capacity > 0 );
+
+        // Mark all cells as empty and ready to be filled.
+        for ( std::size_t i = 0; i < m_cells.size(); ++i ) m_cells[i].m_sequence.store( i, std::memory_order_relaxed );
+    }
+
+    /**
+     * Copy constructor (deleted). Message queues cannot be copied.
+     */
+    BoundedMessageQueue( const BoundedMessageQueue & ) = delete;
+
+    /**
+     * Append a message to the back of the queue, waiting for room if the queue
+     * is full.
+     */
+    void send( Message message )
+    {
+        // Claim a free slot at the back of the queue.
+        Cell *       cell;
+        std::size_t  pos     = m_tail.load( std::memory_order_relaxed );
+        unsigned int attempt = 0;
+        while ( true )
+        {
+            cell = &m_cells[pos & m_mask];
+            const std::size_t    sequence = cell->m_sequence.load( std::memory_order_acquire );
+            const std::ptrdiff_t distance = static_cast<std::ptrdiff_t>( sequence - pos );
+            if ( distance == 0 )
+            {
+                // The slot is free. Try to claim it.
+                if ( m_tail.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) break;
+            }
+            else if ( distance < 0 )
+            {
+                // The queue is full. Back off and re-examine.
+                backOff( attempt );
+                pos = m_tail.load( std::memory_order_relaxed );
+            }
+            else
+            {
+                // Another producer claimed the slot. Re-examine.
+                pos = m_tail.load( std::memory_order_relaxed );
+            }
+        }
+
+        // Move the message into the slot, and publish it to the consumers.
+        cell->m_message = std::move( message );
+        cell->m_sequence.store( pos + 1, std::memory_order_release );
+    }
+
+    /**
+     * Remove one message from the front of the queue, waiting for one to
+     * arrive if the queue is empty.
+     */
+    Message receive()
+    {
+        Message      message;
+        unsigned int attempt = 0;
+        while ( !tryReceive( message ) ) backOff( attempt );
+        return message;
+    }
+
+    /**
+     * Remove one message from the front of the queue, returning false
+     * immediately if the queue is empty.
+     */
+    bool tryReceive( Message & message )
+    {
+        // Claim a filled slot at the front of the queue.
+        Cell *      cell;
+        std::size_t pos = m_head.load( std::memory_order_relaxed );
+        while ( true )
+        {
+            cell = &m_cells[pos & m_mask];
+            const std::size_t    sequence = cell->m_sequence.load( std::memory_order_acquire );
+            const std::ptrdiff_t distance = static_cast<std::ptrdiff_t>( sequence - ( pos + 1 ) );
+            if ( distance == 0 )
+            {
+                // The slot is filled. Try to claim it.
+                if ( m_head.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) ) break;
+            }
+            else if ( distance < 0 )
+            {
+                // The queue is empty.
+                return false;
+            }
+            else
+            {
+                // Another consumer claimed the slot. Re-examine.
+                pos = m_head.load( std::memory_order_relaxed );
+            }
+        }
+
+        // Move the message out of the slot, and recycle the slot for the producers.
+        message = std::move( cell->m_message );
+        cell->m_sequence.store( pos + m_mask + 1, std::memory_order_release );
+        return true;
+    }
+
+    /**
+     * Remove up to maxCount messages from the front of the queue, waiting for
+     * at least one to arrive. Returns the number of messages received.
+     */
+    template <typename OutputIterator>
+    std::size_t receiveSome( OutputIterator messages, std::size_t maxCount )
+    {
+        assert( maxCount > 0 );
+        *messages++       = receive();
+        std::size_t count = 1;
+        for ( Message message; count < maxCount && tryReceive( message ); ++count ) *messages++ = std::move( message );
+        return count;
+    }
+
+private:
+
+    /**
+     * A slot in the ring buffer. The sequence number encodes whether the slot
+     * is free or filled, and for which lap of the ring.
+     */
+    struct Cell
+    {
+        std::atomic<std::size_t> m_sequence;
+        Message                  m_message;
+    };
+
+    static std::size_t roundUpToPowerOfTwo( std::size_t value )
+    {
+        std::size_t result = 1;
+        while ( result < value ) result *= 2;
+        return result;
+    }
+
+    static void backOff( unsigned int & attempt )
+    {
+        // Yield at first; fall back to short sleeps so a blocked thread does
+        // not burn a full core.
+        if ( attempt < 64 )
+        {
+            ++attempt;
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+        }
+    }
+
+    std::vector<Cell> m_cells;
+    std::size_t       m_mask;
+
+    // Keep the producer- and consumer cursors on separate cache lines.
+    alignas( 64 ) std::atomic<std::size_t> m_head;
+    alignas( 64 ) std::atomic<std::size_t> m_tail;
+};
+
 } // namespace balsa
 
 #endif // MESSAGEQUEUE_H
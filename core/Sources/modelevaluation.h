@@ -1,9 +1,14 @@
 #ifndef MODELEVALUATION_H
 #define MODELEVALUATION_H
 
+#include <atomic>
 #include <random>
+#include <thread>
+#include <vector>
 
+#include "classifierstream.h"
 #include "datatypes.h"
+#include "ensembleclassifier.h"
 #include "iteratortools.h"
 #include "table.h"
 
@@ -14,8 +19,31 @@ class ModelStatistics
 {
 public:
 
+    /**
+     * Constructor. Computes the confusion matrix and all derived statistics
+     * for a set of ground truth labels and classifier predictions.
+     *
+     * This is equivalent to creating empty statistics, accumulating the whole
+     * label range in one call, and finalizing.
+     */
     template <typename GroundTruthLabelIterator, typename ClassifierLabelIterator>
-    ModelStatistics( GroundTruthLabelIterator groundTruthBegin, GroundTruthLabelIterator groundTruthEnd, ClassifierLabelIterator classifierLabels, std::size_t numberOfClasses ):
+    ModelStatistics( GroundTruthLabelIterator groundTruthBegin, GroundTruthLabelIterator groundTruthEnd, ClassifierLabelIterator classifierLabels, std::size_t numberOfClasses, unsigned int threadCount = 1 ):
+    ModelStatistics( numberOfClasses )
+    {
+        accumulate( groundTruthBegin, groundTruthEnd, classifierLabels, threadCount );
+        finalize();
+    }
+
+    /**
+     * Constructor. Creates empty statistics for the given number of classes.
+     *
+     * Label pairs can subsequently be binned into the confusion matrix in
+     * chunks using \c accumulate(), so that arbitrarily large label sets can
+     * be evaluated in constant memory. Once all chunks have been accumulated,
+     * the derived statistics must be computed with a single call to
+     * \c finalize().
+     */
+    ModelStatistics( std::size_t numberOfClasses ):
     CM( numberOfClasses, numberOfClasses ),
     P( numberOfClasses, 1 ),
     N( numberOfClasses, 1 ),
@@ -36,59 +64,100 @@ public:
     LRN( numberOfClasses, 1 ),
     DOR( numberOfClasses, 1 ),
     P4( numberOfClasses, 1 ),
-    ACC( 0 )
+    ACC( 0 ),
+    m_numberOfClasses( numberOfClasses ),
+    m_totalPoints( 0 )
     {
-        // Calculate the confusion matrix.
-        for ( auto groundTruthIt( groundTruthBegin ); groundTruthIt != groundTruthEnd; ++groundTruthIt )
+    }
+
+    /**
+     * Bins a range of label pairs into the confusion matrix.
+     *
+     * The label pairs are binned in a single streaming pass. With more than
+     * one thread, each thread bins its own chunk of the label range into a
+     * private partial matrix, and the partial matrices are added together
+     * afterwards; this requires random access label iterators.
+     */
+    template <typename GroundTruthLabelIterator, typename ClassifierLabelIterator>
+    void accumulate( GroundTruthLabelIterator groundTruthBegin, GroundTruthLabelIterator groundTruthEnd, ClassifierLabelIterator classifierLabels, unsigned int threadCount = 1 )
+    {
+        // Calculate the confusion matrix in one streaming pass over the labels.
+        const std::size_t totalPoints = std::distance( groundTruthBegin, groundTruthEnd );
+        if ( threadCount <= 1 )
         {
-            auto classifier = *classifierLabels++;
-            ++CM( classifier, *groundTruthIt );
+            auto classifierIt = classifierLabels;
+            for ( auto groundTruthIt( groundTruthBegin ); groundTruthIt != groundTruthEnd; ++groundTruthIt, ++classifierIt )
+                ++CM( *classifierIt, *groundTruthIt );
         }
-
-        // Calculate the basic counts.
-        auto         nc                 = numberOfClasses;
-        unsigned int totalTruePositives = 0;
-        for ( Label c = 0; c < nc; ++c )
+        else
         {
-            // Other metrics.
-            for ( Label row = 0; row < nc; ++row )
+            // Bin each chunk of the label range into a private partial matrix,
+            // and add the partial matrices together.
+            std::vector<Table<unsigned int>> partialMatrices( threadCount, Table<unsigned int>( m_numberOfClasses, m_numberOfClasses ) );
+            std::vector<std::thread>         threads;
+            for ( unsigned int i = 0; i < threadCount; ++i )
             {
-                for ( Label col = 0; col < numberOfClasses; ++col )
-                {
-                    // Positives.
-                    if ( col == c ) P( col, 0 ) += CM( row, col );
-
-                    // Negatives.
-                    if ( col != c ) N( c, 0 ) += CM( row, col );
-
-                    // True Postives.
-                    if ( row == c && col == c )
+                const std::size_t firstPoint = ( totalPoints * i ) / threadCount;
+                const std::size_t lastPoint  = ( totalPoints * ( i + 1 ) ) / threadCount;
+                threads.push_back( std::thread(
+                    [&partialMatrices, i, firstPoint, lastPoint, groundTruthBegin, classifierLabels]()
                     {
-                        TP( c, 0 )          = CM( c, c );
-                        totalTruePositives += CM( c, c );
-                    }
-
-                    // True negatives.
-                    if ( row != c && col != c ) TN( c, 0 ) += CM( row, col );
-
-                    // False negatives.
-                    if ( row != c && col == c ) FN( c, 0 ) += CM( row, col );
-
-                    // False positives.
-                    if ( row == c && col != c ) FP( c, 0 ) += CM( row, col );
-                }
+                        Table<unsigned int> & partial      = partialMatrices[i];
+                        auto                  groundTruthIt = groundTruthBegin + firstPoint;
+                        auto                  classifierIt  = classifierLabels + firstPoint;
+                        for ( std::size_t point = firstPoint; point < lastPoint; ++point )
+                            ++partial( *classifierIt++, *groundTruthIt++ );
+                    } ) );
             }
+            for ( auto & thread : threads ) thread.join();
+            for ( auto & partial : partialMatrices ) CM += partial;
+        }
+        m_totalPoints += totalPoints;
+    }
 
-            PP( c, 0 ) = TP( c, 0 ) + FP( c, 0 );
-            PN( c, 0 ) = TN( c, 0 ) + FN( c, 0 );
+    /**
+     * Computes all derived statistics from the accumulated confusion matrix.
+     *
+     * All per-class counts are derived from the row- and column sums of the
+     * confusion matrix, so the work is quadratic in the number of classes.
+     *
+     * \pre All label pairs have been accumulated.
+     */
+    void finalize()
+    {
+        // Derive the per-class counts from the row- and column sums of the
+        // confusion matrix. Rows hold the predicted labels and columns the
+        // ground truth labels, so for a class the column sum is the number of
+        // actual positives, and the row sum the number of predicted positives.
+        const std::size_t totalPoints        = m_totalPoints;
+        unsigned int      totalTruePositives = 0;
+        for ( Label c = 0; c < m_numberOfClasses; ++c )
+        {
+            unsigned int rowSum    = 0;
+            unsigned int columnSum = 0;
+            for ( Label other = 0; other < m_numberOfClasses; ++other )
+            {
+                rowSum    += CM( c, other );
+                columnSum += CM( other, c );
+            }
+            const unsigned int truePositives = CM( c, c );
+
+            P( c, 0 )  = columnSum;
+            N( c, 0 )  = totalPoints - columnSum;
+            TP( c, 0 ) = truePositives;
+            FP( c, 0 ) = rowSum - truePositives;
+            FN( c, 0 ) = columnSum - truePositives;
+            TN( c, 0 ) = totalPoints - rowSum - columnSum + truePositives;
+            PP( c, 0 ) = rowSum;
+            PN( c, 0 ) = totalPoints - rowSum;
+            totalTruePositives += truePositives;
         }
 
         // Calculate the overall accuracy.
-        unsigned int totalPoints = std::distance( groundTruthBegin, groundTruthEnd );
-        ACC                      = static_cast<double>( totalTruePositives ) / totalPoints;
+        ACC = static_cast<double>( totalTruePositives ) / totalPoints;
 
         // Calculate per-class metrics.
-        for ( Label l = 0; l < numberOfClasses; ++l )
+        for ( Label l = 0; l < m_numberOfClasses; ++l )
         {
             TPR( l, 0 ) = static_cast<double>( TP( l, 0 ) ) / P( l, 0 );
             TNR( l, 0 ) = static_cast<double>( TN( l, 0 ) ) / N( l, 0 );
@@ -170,6 +239,11 @@ public:
 
     /** Accuracy (overall). */
     double ACC;
+
+private:
+
+    std::size_t m_numberOfClasses;
+    std::size_t m_totalPoints;
 };
 
 /**
@@ -241,6 +315,112 @@ public:
         }
     }
 
+    /**
+     * Constructor. Performs feature importance analysis using the classifiers
+     * from a stream, distributing the (feature, repetition) grid of shuffling
+     * experiments over multiple threads.
+     *
+     * The stream is drained once, and the loaded classifiers are shared by all
+     * threads, each of which streams over them independently. Each thread
+     * keeps one private copy of the dataset, and overwrites only the column of
+     * the feature under consideration, so the cost per experiment is one
+     * column permutation plus one classification run.
+     */
+    template <typename PointIterator, typename LabelIterator>
+    FeatureImportances( ClassifierInputStream & classifierStream, PointIterator pointsBegin, PointIterator pointsEnd, LabelIterator labelBegin, unsigned int featureCount, unsigned int repetitions, unsigned int threadCount ):
+    m_accImportance( featureCount, 0 )
+    {
+        // Determine the feature type from the point iterator type.
+        typedef std::remove_cv_t<typename iterator_value_type<PointIterator>::type> FeatureType;
+        static_assert( std::is_arithmetic<FeatureType>::value, "Feature type should be an integral or floating point type." );
+
+        // Check preconditions.
+        assert( repetitions > 0 );
+        assert( threadCount > 0 );
+
+        // Load all classifiers from the stream into memory, so the threads can
+        // share one resident copy of the ensemble.
+        std::vector<Classifier::SharedPointer> classifiers;
+        classifierStream.rewind();
+        for ( auto classifier = classifierStream.next(); classifier; classifier = classifierStream.next() ) classifiers.push_back( classifier );
+
+        // Calculate a reference score on the original data.
+        std::size_t                 pointCount = std::distance( pointsBegin, pointsEnd ) / featureCount;
+        Table<Label>                predictions( pointCount, 1 );
+        ClassifierVectorInputStream referenceStream( classifiers );
+        EnsembleClassifier          referenceClassifier( referenceStream );
+        referenceClassifier.classify( pointsBegin, pointsEnd, predictions.begin() );
+        ModelStatistics referenceStats( labelBegin, labelBegin + pointCount, predictions.begin(), referenceClassifier.getClassCount() );
+
+        // Draw a random seed for each thread.
+        std::random_device         rd;
+        std::vector<std::mt19937::result_type> seeds( threadCount );
+        for ( auto & seed : seeds ) seed = rd();
+
+        // Schedule the (feature, repetition) grid of shuffling experiments
+        // over the threads. Each thread accumulates into its own row of
+        // importance totals, which are combined after the threads have joined.
+        const std::size_t                jobCount = static_cast<std::size_t>( featureCount ) * repetitions;
+        std::atomic<std::size_t>         nextJob( 0 );
+        std::vector<std::vector<double>> accTotals( threadCount, std::vector<double>( featureCount, 0 ) );
+        std::vector<std::thread>         threads;
+        for ( unsigned int i = 0; i < threadCount; ++i )
+        {
+            threads.push_back( std::thread(
+                [&classifiers, &nextJob, &accTotals, i, pointsBegin, labelBegin, pointCount, featureCount, repetitions, jobCount]( std::mt19937::result_type seed )
+                {
+                    // Each thread streams over the shared classifiers through
+                    // its own stream, and keeps a private copy of the dataset
+                    // as scratch space for the permuted feature columns.
+                    ClassifierVectorInputStream stream( classifiers );
+                    EnsembleClassifier          classifier( stream );
+                    ClassificationSession       session;
+                    Table<FeatureType>          scratchPoints( 0, featureCount );
+                    scratchPoints.reserveRows( pointCount );
+                    scratchPoints.append( pointsBegin, pointsBegin + pointCount * featureCount );
+                    Table<Label>             shuffledPredictions( pointCount, 1 );
+                    std::vector<std::size_t> shuffling( pointCount, 0 );
+                    std::mt19937             noise( seed );
+
+                    for ( std::size_t job = nextJob++; job < jobCount; job = nextJob++ )
+                    {
+                        const unsigned int featureToShuffle = job / repetitions;
+
+                        // Shuffle the point indices, and apply the shuffling to
+                        // the feature under consideration.
+                        std::iota( shuffling.begin(), shuffling.end(), 0 );
+                        std::shuffle( shuffling.begin(), shuffling.end(), noise );
+                        for ( std::size_t pointID = 0; pointID < pointCount; ++pointID )
+                        {
+                            scratchPoints( pointID, featureToShuffle ) = pointsBegin[shuffling[pointID] * featureCount + featureToShuffle];
+                        }
+
+                        // Apply the classifier to the shuffled data, and add
+                        // the stats to the importance totals of this thread.
+                        classifier.classify( scratchPoints.begin(), scratchPoints.end(), shuffledPredictions.begin(), session );
+                        ModelStatistics shuffledStats( labelBegin, labelBegin + pointCount, shuffledPredictions.begin(), classifier.getClassCount() );
+                        accTotals[i][featureToShuffle] += shuffledStats.ACC;
+
+                        // Restore the original feature column.
+                        for ( std::size_t pointID = 0; pointID < pointCount; ++pointID )
+                        {
+                            scratchPoints( pointID, featureToShuffle ) = pointsBegin[pointID * featureCount + featureToShuffle];
+                        }
+                    }
+                },
+                seeds[i] ) );
+        }
+        for ( auto & thread : threads ) thread.join();
+
+        // Calculate the final importance scores.
+        for ( unsigned int feature = 0; feature < featureCount; ++feature )
+        {
+            double total = 0;
+            for ( unsigned int i = 0; i < threadCount; ++i ) total += accTotals[i][feature];
+            m_accImportance[feature] = referenceStats.ACC - ( total / repetitions );
+        }
+    }
+
     double getAccuracyImportance( unsigned int featureID ) const
     {
         assert( featureID < m_accImportance.size() );
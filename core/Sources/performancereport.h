@@ -0,0 +1,108 @@
+#ifndef PERFORMANCEREPORT_H
+#define PERFORMANCEREPORT_H
+
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace balsa
+{
+
+/**
+ * A collection of named performance counters and timers, grouped into
+ * sections, that can be written as a structured JSON report.
+ *
+ * Components that collect performance statistics (RandomForestTrainer,
+ * EnsembleClassifier, ClassifierFileInputStream) expose them as plain
+ * statistics objects; tools gather those into a report and write it to a
+ * file, so a slow run can be diagnosed offline without rebuilding with a
+ * profiler.
+ */
+class PerformanceReport
+{
+public:
+
+    /**
+     * Add a counter value to the named section of the report.
+     */
+    void add( const std::string & section, const std::string & name, std::uint64_t value )
+    {
+        getSection( section ).push_back( Entry( name, std::to_string( value ) ) );
+    }
+
+    /**
+     * Add a timer value (in seconds) to the named section of the report.
+     */
+    void add( const std::string & section, const std::string & name, double value )
+    {
+        getSection( section ).push_back( Entry( name, format( value ) ) );
+    }
+
+    /**
+     * Add a list of timer values (in seconds) to the named section of the
+     * report.
+     */
+    void add( const std::string & section, const std::string & name, const std::vector<double> & values )
+    {
+        std::string list( "[" );
+        for ( std::size_t i = 0; i < values.size(); ++i )
+        {
+            if ( i ) list += ", ";
+            list += format( values[i] );
+        }
+        list += "]";
+        getSection( section ).push_back( Entry( name, list ) );
+    }
+
+    /**
+     * Write the report to a stream as JSON.
+     */
+    void writeJSON( std::ostream & out ) const
+    {
+        out << '{' << std::endl;
+        for ( std::size_t section = 0; section < m_sections.size(); ++section )
+        {
+            auto & entries = m_sections[section].second;
+            out << "  \"" << m_sections[section].first << "\": {" << std::endl;
+            for ( std::size_t entry = 0; entry < entries.size(); ++entry )
+            {
+                out << "    \"" << entries[entry].first << "\": " << entries[entry].second
+                    << ( entry + 1 < entries.size() ? "," : "" ) << std::endl;
+            }
+            out << "  }" << ( section + 1 < m_sections.size() ? "," : "" ) << std::endl;
+        }
+        out << '}' << std::endl;
+    }
+
+private:
+
+    typedef std::pair<std::string, std::string> Entry;
+    typedef std::vector<Entry>                  Section;
+
+    // Returns the entry list of the named section, creating it if necessary.
+    Section & getSection( const std::string & name )
+    {
+        for ( auto & section : m_sections )
+            if ( section.first == name ) return section.second;
+        m_sections.push_back( std::pair<std::string, Section>( name, Section() ) );
+        return m_sections.back().second;
+    }
+
+    // Formats a timer value as a JSON number.
+    static std::string format( double value )
+    {
+        std::ostringstream ss;
+        ss << std::setprecision( 9 ) << value;
+        return ss.str();
+    }
+
+    std::vector<std::pair<std::string, Section>> m_sections;
+};
+
+} // namespace balsa
+
+#endif // PERFORMANCEREPORT_H
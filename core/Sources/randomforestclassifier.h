@@ -10,12 +10,21 @@ class RandomForestClassifier: public EnsembleClassifier
 {
 public:
 
-    RandomForestClassifier( const std::string & modelFileName, unsigned int maxThreads = 0, unsigned int maxPreload = 1 ):
-    m_classifierStream( modelFileName, maxPreload )
+    RandomForestClassifier( const std::string & modelFileName, unsigned int maxThreads = 0, unsigned int maxPreload = 1, bool memoryMap = false ):
+    m_classifierStream( modelFileName, maxPreload, memoryMap )
     {
         init( m_classifierStream, maxThreads );
     }
 
+    /**
+     * Returns the underlying classifier input stream, e.g. to inspect its
+     * performance statistics.
+     */
+    ClassifierFileInputStream & getClassifierStream()
+    {
+        return m_classifierStream;
+    }
+
 private:
 
     ClassifierFileInputStream m_classifierStream;
@@ -3,11 +3,14 @@
 
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <random>
 #include <semaphore>
 #include <thread>
@@ -19,6 +22,7 @@
 #include "indexeddecisiontree.h"
 #include "messagequeue.h"
 #include "table.h"
+#include "timing.h"
 
 namespace balsa
 {
@@ -38,29 +42,135 @@ class RandomForestTrainer
 
         typedef typename IndexedDecisionTree<FeatureIterator, LabelIterator>::SeedType SeedType;
 
-        TrainingJob( FeatureIterator dataSet, const IndexedDecisionTree<FeatureIterator, LabelIterator> & sapling, SeedType seed, unsigned int maxDepth, bool stop ):
+        TrainingJob():
+        m_dataSet(),
+        m_sapling( nullptr ),
+        m_seed( 0 ),
+        m_maxDepth( 0 ),
+        m_sampleFraction( 1.0 ),
+        m_bootstrap( false ),
+        m_stop( true )
+        {
+        }
+
+        TrainingJob( FeatureIterator dataSet, const IndexedDecisionTree<FeatureIterator, LabelIterator> & sapling, SeedType seed, unsigned int maxDepth, double sampleFraction, bool bootstrap, bool stop ):
         m_dataSet( dataSet ),
-        m_sapling( sapling ),
+        m_sapling( &sapling ),
         m_seed( seed ),
         m_maxDepth( maxDepth ),
+        m_sampleFraction( sampleFraction ),
+        m_bootstrap( bootstrap ),
         m_stop( stop )
         {
         }
 
         FeatureIterator                                             m_dataSet;
-        const IndexedDecisionTree<FeatureIterator, LabelIterator> & m_sapling;
+        const IndexedDecisionTree<FeatureIterator, LabelIterator> * m_sapling;
         SeedType                                                    m_seed;
         unsigned int                                                m_maxDepth;
+        double                                                      m_sampleFraction;
+        bool                                                        m_bootstrap;
         bool                                                        m_stop;
     };
 
-    typedef MessageQueue<TrainingJob>                                                                 JobQueue;
-    typedef MessageQueue<typename IndexedDecisionTree<FeatureIterator, LabelIterator>::SharedPointer> JobResultQueue;
+    /**
+     * A shared registry of the trees that are currently being grown, through
+     * which workers that have run out of training jobs steal growable leaves
+     * from the trees that other workers are still growing (see
+     * IndexedDecisionTree::growCooperatively()).
+     */
+    class GrowingTreeRegistry
+    {
+    public:
+
+        typedef typename IndexedDecisionTree<FeatureIterator, LabelIterator>::SharedPointer TreePointer;
+
+        /**
+         * Constructor.
+         * \param treeCount The total number of trees that will be grown.
+         */
+        GrowingTreeRegistry( unsigned int treeCount ):
+        m_unfinishedTrees( treeCount )
+        {
+        }
+
+        /**
+         * Register a tree that is about to be grown, making it available for
+         * stealing.
+         */
+        void registerTree( TreePointer tree )
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_trees.push_back( tree );
+            m_changed.notify_all();
+        }
+
+        /**
+         * Deregister a fully grown tree.
+         */
+        void deregisterTree( TreePointer tree )
+        {
+            std::lock_guard<std::mutex> lock( m_mutex );
+            m_trees.erase( std::find( m_trees.begin(), m_trees.end(), tree ) );
+            assert( m_unfinishedTrees > 0 );
+            --m_unfinishedTrees;
+            m_changed.notify_all();
+        }
+
+        /**
+         * Return a registered tree to help grow, preferring the tree with the
+         * largest growable frontier (the most remaining work). Blocks while no
+         * tree is registered but unfinished trees remain. Returns an empty
+         * pointer once all trees have been grown.
+         */
+        TreePointer stealTree()
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            while ( m_trees.empty() && m_unfinishedTrees != 0 ) m_changed.wait( lock );
+            if ( m_trees.empty() ) return TreePointer();
+            TreePointer victim = m_trees.front();
+            for ( auto & tree : m_trees )
+                if ( tree->getGrowableLeafCount() > victim->getGrowableLeafCount() ) victim = tree;
+            return victim;
+        }
+
+    private:
+
+        std::vector<TreePointer> m_trees;
+        unsigned int             m_unfinishedTrees;
+        std::mutex               m_mutex;
+        std::condition_variable  m_changed;
+    };
+
+    typedef BoundedMessageQueue<TrainingJob>                                                                 JobQueue;
+    typedef BoundedMessageQueue<typename IndexedDecisionTree<FeatureIterator, LabelIterator>::SharedPointer> JobResultQueue;
 
 public:
 
     typedef typename IndexedDecisionTree<FeatureIterator, LabelIterator>::FeatureType FeatureType;
 
+    /**
+     * Performance statistics collected during the most recent call to train().
+     */
+    class Statistics
+    {
+    public:
+
+        Statistics():
+        m_indexConstructionTime( 0 ),
+        m_workerBusyTime( 0 ),
+        m_workerIdleTime( 0 ),
+        m_modelStoreTime( 0 )
+        {
+        }
+
+        StopWatch::Seconds              m_indexConstructionTime; // Time spent building or loading the shared sapling index.
+        std::vector<StopWatch::Seconds> m_treeGrowthTimes;       // Per-tree clone-and-grow times, in order of completion.
+        StopWatch::Seconds              m_workerBusyTime;        // Total time the worker threads spent training trees.
+        StopWatch::Seconds              m_workerIdleTime;        // Total time the worker threads spent waiting for jobs.
+        StopWatch::Seconds              m_modelStoreTime;        // Time the main thread spent stripping and writing trees.
+    };
+
     /**
      * Constructor.
      * \param outputFile Name of the model file that will be written.
@@ -88,19 +198,81 @@ public:
      *  be used instead of double precision (64-bit) floats. This significantly
      *  reduces the amount of memory used during training, at the expense of
      *  precision.
+     * \param sampleFraction Fraction of the data points each tree is trained
+     *  on. If set to a value below 1.0, each tree is grown on an independent
+     *  random subsample of the given fraction of the data, trading a margin of
+     *  accuracy for training time proportional to the sample size.
+     * \param bootstrap If `true`, the per-tree subsamples are drawn with
+     *  replacement (bootstrap/bagging); otherwise they are drawn without
+     *  replacement. Bootstrap sampling with a sample fraction of 1.0 gives
+     *  classic bagging.
+     * \param histogramBinCount If non-zero, histogram-based (approximate)
+     *  split finding with the given number of bins is used instead of exact
+     *  split finding (see IndexedDecisionTree::setSplitFindingMode()). This
+     *  bounds the split finding cost per node, which substantially speeds up
+     *  training on large, dense datasets.
+     * \param saplingCacheFile If non-empty, the sorted training index
+     *  (sapling) is cached in the given file: it is loaded from the file if it
+     *  exists, and built and written to the file otherwise. This lets repeated
+     *  training runs on the same frozen dataset skip index construction
+     *  entirely. The growth parameters are free to vary between runs, but the
+     *  dataset and labels must not change.
+     * \param outOfBagError If `true`, each tree additionally classifies the
+     *  points that were left out of its training sample, voting on them in a
+     *  shared out-of-bag vote table. After train() finishes, the resulting
+     *  error estimate is available through getOutOfBagError(). This requires a
+     *  sample fraction below 1.0 or bootstrap sampling.
+     * \param nodeBudget If non-zero, each tree is limited to the given number
+     *  of nodes, and grown best-first so the budget is spent on the splits
+     *  that remove the most impurity (see
+     *  IndexedDecisionTree::setNodeBudget()). This caps the model size and
+     *  inference latency directly.
+     * \param workStealing If `true`, worker threads that have run out of
+     *  trees to train help grow the trees that are still being trained, by
+     *  stealing growable leaves from them (see
+     *  IndexedDecisionTree::growCooperatively()). Tree growth times vary
+     *  widely with the random feature selection, so without stealing, the
+     *  tail of a training run leaves most workers idle while the last deep
+     *  trees are ground down by a single worker each. Stealing makes the
+     *  wall-clock time track the aggregate amount of work instead, at the
+     *  cost of making the grown trees dependent on thread timing: a fixed
+     *  seed no longer reproduces the exact same model. Not available in
+     *  combination with a node budget, because best-first growth is
+     *  inherently ordered.
      */
-    RandomForestTrainer( ClassifierOutputStream & stream, unsigned int featuresToConsider = 0, unsigned maxDepth = std::numeric_limits<unsigned int>::max(), double minPurity = 1.0, unsigned int treeCount = 10, unsigned int concurrentTrainers = 10, bool writeGraphviz = false ):
+    RandomForestTrainer( ClassifierOutputStream & stream, unsigned int featuresToConsider = 0, unsigned maxDepth = std::numeric_limits<unsigned int>::max(), double minPurity = 1.0, unsigned int treeCount = 10, unsigned int concurrentTrainers = 10, bool writeGraphviz = false, double sampleFraction = 1.0, bool bootstrap = false, unsigned int histogramBinCount = 0, const std::string & saplingCacheFile = std::string(), bool outOfBagError = false, unsigned int nodeBudget = 0, bool workStealing = false ):
     m_stream( stream ),
     m_featuresToConsider( featuresToConsider ),
     m_maxDepth( maxDepth ),
     m_minPurity( minPurity ),
     m_treeCount( treeCount ),
     m_trainerCount( concurrentTrainers ),
-    m_writeGraphviz( writeGraphviz )
+    m_writeGraphviz( writeGraphviz ),
+    m_sampleFraction( sampleFraction ),
+    m_bootstrap( bootstrap ),
+    m_histogramBinCount( histogramBinCount ),
+    m_saplingCacheFile( saplingCacheFile ),
+    m_outOfBagError( outOfBagError ),
+    m_outOfBagVotes( 0, 0 ),
+    m_outOfBagErrorValue( 0 ),
+    m_nodeBudget( nodeBudget ),
+    m_workStealing( workStealing )
     {
         // Ensure the specified minimum purity is in range.
         if ( m_minPurity < 0.0 || m_minPurity > 1.0 )
             throw ClientError( "The specified minimum purity is out of range [0.0, 1.0]." );
+
+        // Ensure the specified sample fraction is in range.
+        if ( m_sampleFraction <= 0.0 || m_sampleFraction > 1.0 )
+            throw ClientError( "The specified sample fraction is out of range (0.0, 1.0]." );
+
+        // Out-of-bag estimation requires that each tree leaves some points unseen.
+        if ( m_outOfBagError && !( m_sampleFraction < 1.0 || m_bootstrap ) )
+            throw ClientError( "Out-of-bag error estimation requires subsampling or bootstrap sampling." );
+
+        // Work stealing distributes the leaf splits of a tree over threads, which is incompatible with strictly ordered best-first growth.
+        if ( m_workStealing && m_nodeBudget != 0 )
+            throw ClientError( "Work stealing is not available in combination with a node budget." );
     }
 
     /**
@@ -115,6 +287,10 @@ public:
      */
     void train( FeatureIterator pointsStart, FeatureIterator pointsEnd, unsigned int featureCount, LabelIterator labelsStart )
     {
+        // Reset the performance statistics of any earlier run.
+        m_statistics = Statistics();
+        StopWatch watch;
+
         // Check precionditions, etc.
         if ( featureCount == 0 ) throw ClientError( "Data points must have at least one feature." );
         auto dataset    = pointsStart;
@@ -132,25 +308,76 @@ public:
         double impurityTreshold = 1.0 - m_minPurity;
 
         // Create an indexed tree with only one node. This is expensive to build, so it is shared for copying between threads.
-        IndexedDecisionTree<FeatureIterator, LabelIterator> sapling( dataset, labels, featureCount, pointCount, featuresToConsider, m_maxDepth, impurityTreshold );
+        // If a sapling cache file was specified, the pre-built index is loaded from it instead, if it exists.
+        typedef IndexedDecisionTree<FeatureIterator, LabelIterator> SaplingType;
+        std::unique_ptr<SaplingType>                                saplingPtr;
+        watch.start();
+        if constexpr ( std::is_floating_point<FeatureType>::value )
+        {
+            if ( !m_saplingCacheFile.empty() && std::filesystem::exists( m_saplingCacheFile ) )
+            {
+                BalsaFileParser parser( m_saplingCacheFile );
+                saplingPtr.reset( new SaplingType( parser, dataset, featureCount, pointCount, featuresToConsider, m_maxDepth, impurityTreshold ) );
+            }
+        }
+        else
+        {
+            if ( !m_saplingCacheFile.empty() ) throw ClientError( "Sapling caching is not supported for integral feature types." );
+        }
+        if ( !saplingPtr )
+        {
+            // Build the index from scratch. The trainer threads are not running yet at this point, so they can all be used to build the index.
+            saplingPtr.reset( new SaplingType( dataset, labels, featureCount, pointCount, featuresToConsider, m_maxDepth, impurityTreshold, m_trainerCount ) );
+
+            // Write the freshly built index to the cache file, for future runs to reuse.
+            if constexpr ( std::is_floating_point<FeatureType>::value )
+            {
+                if ( !m_saplingCacheFile.empty() )
+                {
+                    BalsaFileWriter writer( m_saplingCacheFile );
+                    saplingPtr->writeSapling( writer );
+                }
+            }
+        }
+        m_statistics.m_indexConstructionTime = watch.stop();
+        SaplingType & sapling                = *saplingPtr;
+
+        // Enable histogram-based split finding, if requested. All copies of the sapling inherit the mode.
+        if ( m_histogramBinCount != 0 ) sapling.setSplitFindingMode( SplitFindingMode::HISTOGRAM_SPLITS, m_histogramBinCount );
+
+        // Enable best-first growth with a node budget, if requested. All copies of the sapling inherit the budget.
+        if ( m_nodeBudget != 0 ) sapling.setNodeBudget( m_nodeBudget );
+
+        // Allocate a shared vote table for out-of-bag estimation, with one row per training point.
+        std::mutex outOfBagMutex;
+        if ( m_outOfBagError ) m_outOfBagVotes = VoteTable( pointCount, sapling.getClassCount() );
 
         // Create message queues for communicating with the worker threads.
-        JobQueue       jobOutbox;
-        JobResultQueue treeInbox;
+        // The tree inbox can hold all results, so a worker never blocks on a
+        // full inbox while the main thread is still blocked filling the
+        // (smaller) job outbox.
+        JobQueue       jobOutbox( 4 * m_trainerCount );
+        JobResultQueue treeInbox( m_treeCount + 1 );
+
+        // Create the shared registry through which workers that have run out
+        // of jobs steal growable leaves from the trees that are still being
+        // grown, if work stealing is enabled.
+        std::unique_ptr<GrowingTreeRegistry> registry;
+        if ( m_workStealing ) registry.reset( new GrowingTreeRegistry( m_treeCount ) );
 
         // Start the worker threads.
         std::vector<std::thread> workers;
         for ( unsigned int i = 0; i < m_trainerCount; ++i )
         {
-            workers.push_back( std::thread( &RandomForestTrainer::workerThread, &jobOutbox, &treeInbox ) );
+            workers.push_back( std::thread( &RandomForestTrainer::workerThread, &jobOutbox, &treeInbox, registry.get(), &m_statistics, &m_statisticsMutex, m_outOfBagError ? &m_outOfBagVotes : nullptr, &outOfBagMutex ) );
         }
 
         // Create jobs for all trees.
         auto & seedSequence = getMasterSeedSequence();
-        for ( unsigned int i = 0; i < m_treeCount; ++i ) jobOutbox.send( TrainingJob( dataset, sapling, seedSequence.next(), m_maxDepth, false ) );
+        for ( unsigned int i = 0; i < m_treeCount; ++i ) jobOutbox.send( TrainingJob( dataset, sapling, seedSequence.next(), m_maxDepth, m_sampleFraction, m_bootstrap, false ) );
 
         // Create 'stop' messages for all threads, to be picked up after all the work is done.
-        for ( unsigned int i = 0; i < workers.size(); ++i ) jobOutbox.send( TrainingJob( dataset, sapling, 0, 0, true ) );
+        for ( unsigned int i = 0; i < workers.size(); ++i ) jobOutbox.send( TrainingJob( dataset, sapling, 0, 0, 1.0, false, true ) );
 
         // Wait for all the trees to come in, and write each tree to a forest file.
         for ( unsigned int i = 0; i < m_treeCount; ++i )
@@ -160,8 +387,10 @@ public:
 
             // Write the tree without the bulky index, which is no longer needed
             // after training.
+            watch.start();
             auto strippedTree = tree->getDecisionTree();
             m_stream.write( *strippedTree );
+            m_statistics.m_modelStoreTime += watch.stop();
 
             // Write a Graphviz file for the tree, if necessary.
             if ( m_writeGraphviz )
@@ -174,27 +403,208 @@ public:
 
         // Wait for all the threads to join.
         for ( auto & worker : workers ) worker.join();
+
+        // Compute the out-of-bag error estimate: the fraction of the covered
+        // points for which the out-of-bag vote differs from the true label.
+        if ( m_outOfBagError )
+        {
+            std::size_t coveredCount = 0;
+            std::size_t errorCount   = 0;
+            for ( std::size_t point = 0; point < static_cast<std::size_t>( pointCount ); ++point )
+            {
+                bool covered = false;
+                for ( std::size_t column = 0; column < m_outOfBagVotes.getColumnCount(); ++column )
+                {
+                    if ( m_outOfBagVotes( point, column ) == 0 ) continue;
+                    covered = true;
+                    break;
+                }
+                if ( !covered ) continue;
+                ++coveredCount;
+                if ( static_cast<Label>( m_outOfBagVotes.getColumnOfRowMaximum( point ) ) != labels[point] ) ++errorCount;
+            }
+            m_outOfBagErrorValue = coveredCount ? static_cast<double>( errorCount ) / coveredCount : 0.0;
+        }
+    }
+
+    /**
+     * Returns the performance statistics collected during the most recent call
+     * to train().
+     */
+    const Statistics & getStatistics() const
+    {
+        return m_statistics;
+    }
+
+    /**
+     * Returns the out-of-bag vote table of the most recent call to train():
+     * for each training point, the votes of the trees that did not see that
+     * point during training.
+     * \pre Out-of-bag error estimation was enabled (see Constructor).
+     */
+    const VoteTable & getOutOfBagVotes() const
+    {
+        return m_outOfBagVotes;
+    }
+
+    /**
+     * Returns the out-of-bag error estimate of the most recent call to
+     * train(): the fraction of the training points that is misclassified by
+     * the trees that did not see the point during training. Points that were
+     * seen by every tree do not contribute to the estimate.
+     * \pre Out-of-bag error estimation was enabled (see Constructor).
+     */
+    double getOutOfBagError() const
+    {
+        return m_outOfBagErrorValue;
     }
 
 private:
 
-    static void workerThread( JobQueue * jobInbox, JobResultQueue * treeOutbox )
+    static void workerThread( JobQueue * jobInbox, JobResultQueue * treeOutbox, GrowingTreeRegistry * registry, Statistics * statistics, std::mutex * statisticsMutex, VoteTable * outOfBagVotes, std::mutex * outOfBagMutex )
     {
+        // Accumulate the performance statistics locally, and merge them once
+        // when the worker finishes.
+        StopWatch                       watch;
+        StopWatch::Seconds              busyTime = 0;
+        StopWatch::Seconds              idleTime = 0;
+        std::vector<StopWatch::Seconds> growthTimes;
+
         // Train trees until it is time to stop.
         while ( true )
         {
             // Get an assignment or stop message from the queue.
+            watch.start();
             TrainingJob job = jobInbox->receive();
+            idleTime += watch.stop();
             if ( job.m_stop ) break;
 
-            // Clone the sapling and grow it. Take care to re-seed the random
-            // generator used for feature selection, otherwise identical trees
-            // will be grown.
-            typename IndexedDecisionTree<FeatureIterator, LabelIterator>::SharedPointer tree( new IndexedDecisionTree<FeatureIterator, LabelIterator>( job.m_sapling ) );
-            tree->seed( job.m_seed );
-            tree->grow();
+            // Clone the sapling, on a subsample of the data if subsampling is
+            // enabled. Take care to re-seed the random generator used for
+            // feature selection, otherwise identical trees will be grown.
+            watch.start();
+            typename IndexedDecisionTree<FeatureIterator, LabelIterator>::SharedPointer tree;
+            std::vector<unsigned int>                                                   multiplicities;
+            if ( job.m_sampleFraction < 1.0 || job.m_bootstrap )
+            {
+                multiplicities = drawSampleMultiplicities( job );
+                tree.reset( new IndexedDecisionTree<FeatureIterator, LabelIterator>( *job.m_sapling, multiplicities ) );
+            }
+            else
+                tree.reset( new IndexedDecisionTree<FeatureIterator, LabelIterator>( *job.m_sapling ) );
+
+            // Grow the tree. With work stealing enabled, the tree is
+            // registered first, so that workers that have run out of jobs can
+            // steal growable leaves from it, and deregistered as soon as it is
+            // fully grown.
+            if ( registry )
+            {
+                registry->registerTree( tree );
+                tree->growCooperatively( job.m_seed );
+                registry->deregisterTree( tree );
+            }
+            else
+            {
+                tree->seed( job.m_seed );
+                tree->grow();
+            }
+
+            // Let the tree vote on the points it did not see during training.
+            if ( outOfBagVotes && !multiplicities.empty() ) voteOutOfBag( job, *tree, multiplicities, *outOfBagVotes, *outOfBagMutex );
+
             treeOutbox->send( tree );
+
+            // Record the time spent on this tree.
+            auto growthTime = watch.stop();
+            busyTime += growthTime;
+            growthTimes.push_back( growthTime );
+        }
+
+        // With work stealing enabled, this worker is out of jobs, but other
+        // workers may still be growing trees. Help grow those until every tree
+        // is finished.
+        if ( registry )
+        {
+            while ( true )
+            {
+                watch.start();
+                auto tree = registry->stealTree();
+                idleTime += watch.stop();
+                if ( !tree ) break;
+                watch.start();
+                tree->growCooperatively( getMasterSeedSequence().next() );
+                busyTime += watch.stop();
+            }
+        }
+
+        // Merge the local statistics into the shared statistics.
+        std::lock_guard<std::mutex> lock( *statisticsMutex );
+        statistics->m_workerBusyTime += busyTime;
+        statistics->m_workerIdleTime += idleTime;
+        statistics->m_treeGrowthTimes.insert( statistics->m_treeGrowthTimes.end(), growthTimes.begin(), growthTimes.end() );
+    }
+
+    /**
+     * Let a grown tree vote on the points that were left out of its training
+     * sample, adding the votes to the shared out-of-bag vote table.
+     */
+    static void voteOutOfBag( const TrainingJob & job, IndexedDecisionTree<FeatureIterator, LabelIterator> & tree, const std::vector<unsigned int> & multiplicities, VoteTable & outOfBagVotes, std::mutex & outOfBagMutex )
+    {
+        // Gather the IDs and features of the out-of-bag points.
+        const unsigned int       featureCount = job.m_sapling->getFeatureCount();
+        std::vector<DataPointID> pointIDs;
+        Table<FeatureType>       points( 0, featureCount );
+        for ( DataPointID pointID = 0; pointID < multiplicities.size(); ++pointID )
+        {
+            if ( multiplicities[pointID] != 0 ) continue;
+            pointIDs.push_back( pointID );
+            points.append( job.m_dataSet + pointID * featureCount, job.m_dataSet + ( pointID + 1 ) * featureCount );
         }
+        if ( pointIDs.empty() ) return;
+
+        // Let the tree vote on the out-of-bag points.
+        VoteTable votes( pointIDs.size(), outOfBagVotes.getColumnCount() );
+        auto      classifier = tree.getDecisionTree();
+        classifier->classifyAndVote( points.begin(), points.end(), votes );
+
+        // Add the votes to the shared vote table.
+        std::lock_guard<std::mutex> lock( outOfBagMutex );
+        for ( std::size_t point = 0; point < pointIDs.size(); ++point )
+            for ( std::size_t column = 0; column < votes.getColumnCount(); ++column )
+                outOfBagVotes( pointIDs[point], column ) += votes( point, column );
+    }
+
+    /**
+     * Draw the per-point sample multiplicities for the subsample of one
+     * training job, using a random generator seeded from the job seed so the
+     * result is reproducible.
+     */
+    static std::vector<unsigned int> drawSampleMultiplicities( const TrainingJob & job )
+    {
+        // Determine the size of the subsample.
+        std::size_t pointCount  = job.m_sapling->getPointCount();
+        std::size_t sampleCount = static_cast<std::size_t>( job.m_sampleFraction * pointCount );
+        if ( sampleCount == 0 ) sampleCount = 1;
+
+        // Draw the sample.
+        std::mt19937              sampler( job.m_seed );
+        std::vector<unsigned int> multiplicities( pointCount, 0 );
+        if ( job.m_bootstrap )
+        {
+            // Draw with replacement.
+            std::uniform_int_distribution<std::size_t> draw( 0, pointCount - 1 );
+            for ( std::size_t i = 0; i < sampleCount; ++i ) ++multiplicities[draw( sampler )];
+        }
+        else
+        {
+            // Draw without replacement: select the first entries of a random permutation.
+            std::vector<DataPointID> pointIDs( pointCount );
+            std::iota( pointIDs.begin(), pointIDs.end(), 0 );
+            std::shuffle( pointIDs.begin(), pointIDs.end(), sampler );
+            for ( std::size_t i = 0; i < sampleCount; ++i ) multiplicities[pointIDs[i]] = 1;
+        }
+
+        return multiplicities;
     }
 
     ClassifierOutputStream & m_stream;
@@ -204,6 +614,17 @@ private:
     unsigned int             m_treeCount;
     unsigned int             m_trainerCount;
     bool                     m_writeGraphviz;
+    double                   m_sampleFraction;
+    bool                     m_bootstrap;
+    unsigned int             m_histogramBinCount;
+    std::string              m_saplingCacheFile;
+    bool                     m_outOfBagError;
+    VoteTable                m_outOfBagVotes;
+    double                   m_outOfBagErrorValue;
+    unsigned int             m_nodeBudget;
+    bool                     m_workStealing;
+    Statistics               m_statistics;
+    std::mutex               m_statisticsMutex;
 };
 
 } // namespace balsa
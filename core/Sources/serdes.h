@@ -1,10 +1,14 @@
 #ifndef SERDES_H
 #define SERDES_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <istream>
 #include <ostream>
 #include <string>
 #include <type_traits>
+#include <vector>
 
 namespace balsa
 {
@@ -45,6 +49,94 @@ T deserialize( std::istream & is )
 template <>
 bool deserialize( std::istream & is );
 
+/**
+ * Deserialize a contiguous block of values from a binary input stream,
+ * converting them from the source type to the destination type.
+ *
+ * The values are read from the stream in large blocks and converted with a
+ * tight loop, instead of being deserialized through the stream one value at a
+ * time. When no conversion is necessary, the values are read directly into the
+ * destination buffer.
+ */
+template <typename SourceType, typename DestinationType>
+void deserializeBlock( std::istream & is, DestinationType * destination, std::size_t count )
+{
+    static_assert( std::is_standard_layout<SourceType>::value && std::is_trivial<SourceType>::value, "Generic deserialization is implemented for POD types only." );
+
+    if constexpr ( std::is_same<SourceType, DestinationType>::value )
+    {
+        // Read directly into the destination buffer if no conversion is needed.
+        is.read( reinterpret_cast<char *>( destination ), count * sizeof( SourceType ) );
+    }
+    else
+    {
+        // Read the values into an intermediate buffer one block at a time, and
+        // convert them to the destination type with a tight loop.
+        constexpr std::size_t   maximumBlockBytes = 1 << 20;
+        const std::size_t       blockSize         = std::min<std::size_t>( count, maximumBlockBytes / sizeof( SourceType ) );
+        std::vector<SourceType> buffer( blockSize );
+        while ( count )
+        {
+            const std::size_t blockCount = std::min( count, blockSize );
+            is.read( reinterpret_cast<char *>( buffer.data() ), blockCount * sizeof( SourceType ) );
+            for ( std::size_t i = 0; i < blockCount; ++i ) destination[i] = static_cast<DestinationType>( buffer[i] );
+            destination += blockCount;
+            count -= blockCount;
+        }
+    }
+}
+
+/**
+ * Serialize an unsigned integer to a binary output stream as a variable-width
+ * (LEB128) integer: seven value bits per byte, with the high bit of each byte
+ * marking whether more bytes follow. Small values take a single byte.
+ */
+inline void serializeVarUInt( std::ostream & os, std::uint64_t value )
+{
+    while ( value >= 0x80 )
+    {
+        os.put( static_cast<char>( ( value & 0x7F ) | 0x80 ) );
+        value >>= 7;
+    }
+    os.put( static_cast<char>( value ) );
+}
+
+/**
+ * Deserialize a variable-width (LEB128) unsigned integer from a binary input
+ * stream.
+ */
+inline std::uint64_t deserializeVarUInt( std::istream & is )
+{
+    std::uint64_t value = 0;
+    unsigned int  shift = 0;
+    while ( true )
+    {
+        const std::uint8_t byte = static_cast<std::uint8_t>( is.get() );
+        value |= static_cast<std::uint64_t>( byte & 0x7F ) << shift;
+        if ( !( byte & 0x80 ) ) break;
+        shift += 7;
+    }
+    return value;
+}
+
+/**
+ * Map a signed integer onto an unsigned integer such that values of small
+ * magnitude of either sign map onto small unsigned values (zigzag encoding),
+ * making them cheap to store as variable-width integers.
+ */
+inline std::uint64_t zigZagEncode( std::int64_t value )
+{
+    return ( static_cast<std::uint64_t>( value ) << 1 ) ^ static_cast<std::uint64_t>( value >> 63 );
+}
+
+/**
+ * Invert the zigzag encoding (see zigZagEncode()).
+ */
+inline std::int64_t zigZagDecode( std::uint64_t value )
+{
+    return static_cast<std::int64_t>( value >> 1 ) ^ -static_cast<std::int64_t>( value & 1 );
+}
+
 /**
  * Read a fixed-size token from a stream.
  */
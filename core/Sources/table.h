@@ -6,6 +6,7 @@
 #include <cstdint>
 #include <fstream>
 #include <iomanip>
+#include <type_traits>
 #include <vector>
 
 #include "exceptions.h"
@@ -17,6 +18,15 @@ namespace balsa
 
 /**
  * A row-major MxN data matrix that can be loaded and stored efficiently.
+ *
+ * A Table normally owns its cell data. Alternatively, a read-only Table can be
+ * created as a lightweight view of externally owned cell data (e.g. a
+ * memory-mapped file) using \c createView(). Views support all read-only
+ * operations; modifying operations are not allowed on views. A writable
+ * variant of a view, created using \c createWindow(), additionally allows the
+ * external cells to be modified in place (e.g. a block of rows of a larger
+ * table).
+ *
  * N.B. the Table does not support linear algebra operations.
  * \tparam CellType The data type of each (x,y) entry.
  */
@@ -26,13 +36,16 @@ class Table
 
 public:
 
-    typedef typename std::vector<CellType>::iterator        Iterator;
-    typedef typename std::vector<CellType>::const_iterator  ConstIterator;
-    typedef typename std::vector<CellType>::reference       Reference;
-    typedef typename std::vector<CellType>::const_reference ConstReference;
+    typedef CellType *       Iterator;
+    typedef const CellType * ConstIterator;
+    typedef CellType &       Reference;
+    typedef const CellType & ConstReference;
 
     Table():
-    m_columnCount( 0 )
+    m_columnCount( 0 ),
+    m_viewData( nullptr ),
+    m_viewSize( 0 ),
+    m_windowData( nullptr )
     {
     }
 
@@ -41,7 +54,10 @@ public:
      * \param columnCount The number of columns in the table.
      */
     Table( std::size_t columnCount ):
-    m_columnCount( columnCount )
+    m_columnCount( columnCount ),
+    m_viewData( nullptr ),
+    m_viewSize( 0 ),
+    m_windowData( nullptr )
     {
     }
 
@@ -50,11 +66,65 @@ public:
      * \param columnCount The number of columns in the table.
      */
     Table( std::size_t rowCount, std::size_t columnCount, CellType initialValue = CellType( 0 ) ):
-    m_columnCount( columnCount )
+    m_columnCount( columnCount ),
+    m_viewData( nullptr ),
+    m_viewSize( 0 ),
+    m_windowData( nullptr )
     {
         m_data.resize( rowCount * columnCount, initialValue );
     }
 
+    /**
+     * Creates a read-only table that is a view of externally owned cell data.
+     *
+     * The external data is not copied, and must outlive the view (and any
+     * copies of the view).
+     *
+     * \param cellData Pointer to the first cell of a row-major block of cell
+     *  data containing rowCount * columnCount cells.
+     */
+    static Table createView( const CellType * cellData, std::size_t rowCount, std::size_t columnCount )
+    {
+        Table result( columnCount );
+        result.m_viewData = cellData;
+        result.m_viewSize = rowCount * columnCount;
+        return result;
+    }
+
+    /**
+     * Creates a writable table that is a window onto externally owned cell
+     * data.
+     *
+     * The external data is not copied, and must outlive the window (and any
+     * copies of the window). Unlike a view, the cells of a window may be
+     * modified in place.
+     *
+     * \param cellData Pointer to the first cell of a row-major block of cell
+     *  data containing rowCount * columnCount cells.
+     */
+    static Table createWindow( CellType * cellData, std::size_t rowCount, std::size_t columnCount )
+    {
+        Table result      = createView( cellData, rowCount, columnCount );
+        result.m_windowData = cellData;
+        return result;
+    }
+
+    /**
+     * Returns true iff this table is a view or window of external cell data.
+     */
+    bool isView() const
+    {
+        return m_viewData != nullptr;
+    }
+
+    /**
+     * Returns true iff this table is a writable window of external cell data.
+     */
+    bool isWindow() const
+    {
+        return m_windowData != nullptr;
+    }
+
     /**
      * Find the largest element in a row and return its column number.
      * In case of a tie, the lowest tied column number is returned.
@@ -62,7 +132,7 @@ public:
      */
     std::size_t getColumnOfRowMaximum( std::size_t rowNumber ) const
     {
-        auto rowData    = m_data.begin() + rowNumber * m_columnCount;
+        auto rowData    = begin() + rowNumber * m_columnCount;
         auto rowDataEnd = rowData + m_columnCount;
         auto largest    = std::max_element( rowData, rowDataEnd );
         return std::distance( rowData, largest );
@@ -77,7 +147,7 @@ public:
     std::size_t getColumnOfWeightedRowMaximum( std::size_t rowNumber, const std::vector<float> & weights ) const
     {
         // Find the maximum of the weighted values.
-        auto        rowData   = m_data.begin() + rowNumber * m_columnCount;
+        auto        rowData   = begin() + rowNumber * m_columnCount;
         double      topScore  = 0;
         std::size_t topColumn = 0;
         for ( std::size_t column = 0; column < m_columnCount; ++column )
@@ -95,15 +165,17 @@ public:
      */
     ConstReference operator()( std::size_t row, std::size_t column ) const
     {
-        return m_data[row * m_columnCount + column];
+        return cellData()[row * m_columnCount + column];
     }
 
     /**
      * Read-write access an element by row and column.
+     * \pre The table is not a view.
      */
     Reference operator()( std::size_t row, std::size_t column )
     {
-        return m_data[row * m_columnCount + column];
+        assert( !isView() || isWindow() );
+        return begin()[row * m_columnCount + column];
     }
 
     /**
@@ -111,7 +183,7 @@ public:
      */
     ConstIterator begin() const
     {
-        return m_data.begin();
+        return cellData();
     }
 
     /**
@@ -119,27 +191,32 @@ public:
      */
     ConstIterator end() const
     {
-        return m_data.end();
+        return cellData() + cellCount();
     }
 
     /**
      * Returns an iterator that traverses all cells in row-major order.
+     * \pre The table is not a read-only view.
      */
     Iterator begin()
     {
-        return m_data.begin();
+        assert( !isView() || isWindow() );
+        if ( m_windowData ) return m_windowData;
+        return reinterpret_cast<CellType *>( m_data.data() );
     }
 
     /**
      * Returns an iterator that points ot the end of the data.
+     * \pre The table is not a read-only view.
      */
     Iterator end()
     {
-        return m_data.end();
+        return begin() + cellCount();
     }
 
     /**
      * Append rows to the table.
+     * \pre The table is not a view.
      * \pre The total number of elements between rowStart and rowEnd must be a
      * multiple of the row length.
      */
@@ -147,15 +224,18 @@ public:
     void append( InputIterator rowStart, InputIterator rowEnd )
     {
         // Copy the rows and check consistency.
+        assert( !isView() );
         std::copy( rowStart, rowEnd, std::back_inserter( m_data ) );
         assert( invariant() );
     }
 
     /**
      * Reserve space for a number of rows.
+     * \pre The table is not a view.
      */
     void reserveRows( std::size_t rowCount )
     {
+        assert( !isView() );
         m_data.reserve( rowCount * m_columnCount );
     }
 
@@ -172,22 +252,24 @@ public:
      */
     std::size_t getRowCount() const
     {
-        return ( m_columnCount == 0 ) ? 0 : ( m_data.size() / m_columnCount );
+        return ( m_columnCount == 0 ) ? 0 : ( cellCount() / m_columnCount );
     }
 
     /**
      * Add the cells of another table to this table element-wise.
+     * \pre The table is not a read-only view.
      * \pre Dimensions must match.
      */
     Table<CellType> & operator+=( const Table<CellType> & other )
     {
         // Check preconditions.
+        assert( !isView() || isWindow() );
         assert( other.m_columnCount == m_columnCount );
-        assert( other.m_data.size() == m_data.size() );
+        assert( other.cellCount() == cellCount() );
 
         // Add the data element-wise.
-        auto it1( m_data.begin() ), end1( m_data.end() ); // Non-const.
-        auto it2( other.m_data.begin() );                 // Const.
+        auto it1( begin() ), end1( end() ); // Non-const.
+        auto it2( other.begin() );          // Const.
         for ( ; it1 != end1; ++it1, ++it2 )
         {
             *it1 += *it2;
@@ -205,9 +287,9 @@ public:
         // Check preconditions.
         if ( other.m_columnCount != m_columnCount )
             return false;
-        if ( other.m_data.size() != m_data.size() )
+        if ( other.cellCount() != cellCount() )
             return false;
-        return std::equal( m_data.begin(), m_data.end(), other.m_data.begin() );
+        return std::equal( begin(), end(), other.begin() );
     }
 
     /**
@@ -221,23 +303,37 @@ public:
 
     /**
      * Read cell data into the table from a binary stream.
+     * \pre The table is not a view.
      */
     void readCellData( std::istream & stream )
     {
         // Read the raw binary data from the stream.
+        assert( !isView() );
         if ( !stream.good() ) throw ParseError( "The stream is not readable." );
         stream.read( reinterpret_cast<char *>( m_data.data() ), m_data.size() * sizeof( CellType ) );
     }
 
     /**
      * Read the cell data from a stream and convert it on the fly.
+     * \pre The table is not a view.
      */
     template <typename SourceType>
     void readCellDataAs( std::istream & stream )
     {
-        for ( auto it( m_data.begin() ), end( m_data.end() ); it != end; ++it )
+        assert( !isView() );
+        if constexpr ( std::is_same<CellType, bool>::value )
+        {
+            // std::vector<bool> has no contiguous storage, so block reads are
+            // not possible. Deserialize one value at a time.
+            for ( auto it( m_data.begin() ), end( m_data.end() ); it != end; ++it )
+            {
+                *it = static_cast<CellType>( balsa::deserialize<SourceType>( stream ) );
+            }
+        }
+        else
         {
-            *it = balsa::deserialize<SourceType>( stream );
+            // Read the data in large blocks, converting the values on the fly.
+            balsa::deserializeBlock<SourceType>( stream, m_data.data(), m_data.size() );
         }
         if ( stream.fail() ) throw ParseError( "Read failed." );
     }
@@ -249,19 +345,41 @@ public:
     {
         // Read the raw binary data from the stream.
         if ( !stream.good() ) throw ParseError( "The stream is not writable." );
-        stream.write( reinterpret_cast<const char *>( m_data.data() ), m_data.size() * sizeof( CellType ) );
+        stream.write( reinterpret_cast<const char *>( cellData() ), cellCount() * sizeof( CellType ) );
     }
 
 private:
 
+    // Returns a pointer to the first cell, regardless of whether the cell data is owned or external.
+    const CellType * cellData() const
+    {
+        return m_viewData ? m_viewData : reinterpret_cast<const CellType *>( m_data.data() );
+    }
+
+    // Returns the total number of cells, regardless of whether the cell data is owned or external.
+    std::size_t cellCount() const
+    {
+        return m_viewData ? m_viewSize : m_data.size();
+    }
+
     // Returns true iff the internal datastructure is consistent.
     bool invariant() const
     {
-        return ( m_columnCount == 0 ) ? ( m_data.size() == 0 ) : ( ( m_data.size() % m_columnCount ) == 0 );
+        return ( m_columnCount == 0 ) ? ( cellCount() == 0 ) : ( ( cellCount() % m_columnCount ) == 0 );
     }
 
-    std::size_t           m_columnCount;
-    std::vector<CellType> m_data;
+    // Storage type for the cell data. Booleans are stored as plain bytes,
+    // because the bit-packed std::vector<bool> specialization cannot expose
+    // contiguous cell data.
+    typedef typename std::conditional<std::is_same<CellType, bool>::value, std::vector<uint8_t>, std::vector<CellType>>::type StorageVector;
+
+    static_assert( !std::is_same<CellType, bool>::value || sizeof( bool ) == 1, "Boolean cells must be byte-sized." );
+
+    std::size_t      m_columnCount;
+    StorageVector    m_data;
+    const CellType * m_viewData;
+    std::size_t      m_viewSize;
+    CellType *       m_windowData;
 };
 
 /**
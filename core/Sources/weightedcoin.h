@@ -1,13 +1,124 @@
 #ifndef WEIGHTEDCOIN_H
 #define WEIGHTEDCOIN_H
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <mutex>
 #include <random>
+#include <vector>
 
 namespace balsa
 {
 
+/**
+ * A counter-based random number engine (Philox 4x32 with 10 rounds).
+ *
+ * Unlike the large-state generators in the standard library, a counter-based
+ * engine derives each output block by encrypting a plain counter with a key,
+ * so its state is tiny, seeding is O(1), and engines seeded with distinct
+ * keys produce statistically independent streams. This makes it well suited
+ * for creating many short-lived, reproducible per-thread generators.
+ *
+ * The engine satisfies the requirements of a standard random number engine
+ * insofar as they are needed by the standard distributions.
+ */
+class PhiloxEngine
+{
+public:
+
+    typedef std::uint32_t result_type;
+
+    /**
+     * Constructs an engine keyed with the given seed value.
+     */
+    explicit PhiloxEngine( result_type value = 0 )
+    {
+        seed( value );
+    }
+
+    /**
+     * Re-key the engine and reset its counter.
+     */
+    void seed( result_type value )
+    {
+        m_key[0]     = value;
+        m_key[1]     = 0x9E3779B9u;
+        m_counter[0] = 0;
+        m_counter[1] = 0;
+        m_counter[2] = 0;
+        m_counter[3] = 0;
+        m_available  = 0;
+    }
+
+    /**
+     * Smallest value the engine can produce.
+     */
+    static constexpr result_type min()
+    {
+        return 0;
+    }
+
+    /**
+     * Largest value the engine can produce.
+     */
+    static constexpr result_type max()
+    {
+        return 0xFFFFFFFFu;
+    }
+
+    /**
+     * Generate a random number.
+     */
+    result_type operator()()
+    {
+        if ( m_available == 0 ) generateBlock();
+        return m_block[--m_available];
+    }
+
+private:
+
+    static void multiplyHighLow( result_type a, result_type b, result_type & high, result_type & low )
+    {
+        std::uint64_t product = static_cast<std::uint64_t>( a ) * b;
+        high                  = product >> 32;
+        low                   = static_cast<result_type>( product );
+    }
+
+    void generateBlock()
+    {
+        // Encrypt the counter with ten Philox rounds.
+        result_type x0 = m_counter[0], x1 = m_counter[1], x2 = m_counter[2], x3 = m_counter[3];
+        result_type k0 = m_key[0], k1 = m_key[1];
+        for ( unsigned int round = 0; round < 10; ++round )
+        {
+            result_type high0, low0, high1, low1;
+            multiplyHighLow( 0xD2511F53u, x0, high0, low0 );
+            multiplyHighLow( 0xCD9E8D57u, x2, high1, low1 );
+            x0 = high1 ^ x1 ^ k0;
+            x1 = low1;
+            x2 = high0 ^ x3 ^ k1;
+            x3 = low0;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        m_block[0] = x0;
+        m_block[1] = x1;
+        m_block[2] = x2;
+        m_block[3] = x3;
+
+        // Advance the 128-bit counter.
+        if ( ++m_counter[0] == 0 && ++m_counter[1] == 0 && ++m_counter[2] == 0 ) ++m_counter[3];
+
+        m_available = 4;
+    }
+
+    result_type  m_key[2];
+    result_type  m_counter[4];
+    result_type  m_block[4];
+    unsigned int m_available;
+};
+
 /**
  * A thread safe random number generator.
  */
@@ -65,7 +176,7 @@ MasterSeedSequence & getMasterSeedSequence();
 /**
  * Coin that can be flipped with a specific probability of being true.
  */
-template <typename T_RNG = std::mt19937>
+template <typename T_RNG = PhiloxEngine>
 class WeightedCoin
 {
 public:
@@ -100,6 +211,32 @@ public:
         return dist( m_rng ) <= numerator;
     }
 
+    /**
+     * Draws a uniformly random subset of \c subsetSize distinct values from
+     * the range [0, rangeSize), in ascending order.
+     *
+     * The subset is produced with one random draw per selected value (Floyd's
+     * algorithm), which is much cheaper than flipping the coin once per range
+     * element when the subset is small relative to the range.
+     */
+    template <typename Value>
+    void drawSubset( unsigned int subsetSize, unsigned int rangeSize, std::vector<Value> & subset )
+    {
+        assert( subsetSize <= rangeSize );
+        subset.clear();
+        subset.reserve( subsetSize );
+        for ( unsigned int candidate = rangeSize - subsetSize; candidate < rangeSize; ++candidate )
+        {
+            std::uniform_int_distribution<unsigned int> dist( 0, candidate );
+            Value                                       value( dist( m_rng ) );
+            if ( std::find( subset.begin(), subset.end(), value ) == subset.end() )
+                subset.push_back( value );
+            else
+                subset.push_back( Value( candidate ) );
+        }
+        std::sort( subset.begin(), subset.end() );
+    }
+
 private:
 
     T_RNG m_rng;
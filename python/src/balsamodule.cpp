@@ -77,6 +77,11 @@ Returns
 -------
 `None`; The trained random forest will be stored as a binary file (see the
 `model_filename` parameter).
+
+Notes
+-----
+The global interpreter lock (GIL) is released while the trainer runs, so other
+Python threads can proceed.
 )###" );
 
 PyDoc_STRVAR( RandomForestClassifier_py_doc, \
@@ -164,7 +169,40 @@ data : array-like
 
 Returns
 -------
-An array of shape [No. of data points] with the predicted labels.
+An array of shape [No. of data points] with the predicted labels. The labels
+are written directly into the returned array, without an intermediate copy.
+
+Notes
+-----
+The global interpreter lock (GIL) is released while the classifier runs, so
+other Python threads can overlap classification with I/O or run a second
+classifier concurrently.
+)###" );
+
+PyDoc_STRVAR( RandomForestClassifier_classify_and_vote_py_doc, \
+R"###(Classifies an array of data points using a pre-trained random forest
+classifier, returning the per-class vote counts instead of the final labels.
+
+Parameters
+----------
+data : array-like
+    Array of data points of shape [No. of data points, No. of features]. See
+    `classify` for the conversion rules that apply. The number of features in
+    `data` must be identical to the number of features expected by the random
+    forest classifier.
+
+Returns
+-------
+An array of shape [No. of data points, No. of classes] of 32-bit unsigned
+integers, where each cell holds the number of trees that voted for that class.
+The votes are accumulated directly into the returned array, without an
+intermediate copy.
+
+Notes
+-----
+The global interpreter lock (GIL) is released while the classifier runs, so
+other Python threads can overlap classification with I/O or run a second
+classifier concurrently.
 )###" );
 
 /* clang-format on */
@@ -228,6 +266,7 @@ static PyObject * RandomForestClassifier_get_class_count( RandomForestClassifier
 static PyObject * RandomForestClassifier_get_feature_count( RandomForestClassifier_py_object * self, PyObject * args );
 static PyObject * RandomForestClassifier_set_class_weights( RandomForestClassifier_py_object * self, PyObject * args );
 static PyObject * RandomForestClassifier_classify( RandomForestClassifier_py_object * self, PyObject * args );
+static PyObject * RandomForestClassifier_classify_and_vote( RandomForestClassifier_py_object * self, PyObject * args );
 
 // Methods of type RandomForestClassifier.
 static PyMethodDef RandomForestClassifier_py_type_methods[] = {
@@ -235,6 +274,7 @@ static PyMethodDef RandomForestClassifier_py_type_methods[] = {
     { "get_feature_count", (PyCFunction) RandomForestClassifier_get_feature_count, METH_NOARGS, RandomForestClassifier_get_feature_count_py_doc },
     { "set_class_weights", (PyCFunction) RandomForestClassifier_set_class_weights, METH_O, RandomForestClassifier_set_class_weights_py_doc },
     { "classify", (PyCFunction) RandomForestClassifier_classify, METH_O, RandomForestClassifier_classify_py_doc },
+    { "classify_and_vote", (PyCFunction) RandomForestClassifier_classify_and_vote, METH_O, RandomForestClassifier_classify_and_vote_py_doc },
     { NULL, NULL } };
 
 // Optional functionality for type RandomForestClassifier.
@@ -463,29 +503,41 @@ static PyObject * RandomForestClassifier_classify( RandomForestClassifier_py_obj
         return NULL;
     }
 
-    // Classify the data.
+    // Classify the data. The GIL is released while the classifier runs, so
+    // other Python threads (e.g. I/O, or a second classifier) can proceed.
     try
     {
-        const int data_type = PyArray_TYPE( data_py_array );
-        if ( data_type == NPY_FLOAT )
-        {
-            const float * data_begin   = (const float *) PyArray_DATA( data_py_array );
-            const float * data_end     = data_begin + PyArray_SIZE( data_py_array );
-            uint8_t *     labels_begin = (uint8_t *) PyArray_DATA( labels_py_array );
-            self->m_classifier->classify( data_begin, data_end, labels_begin );
-        }
-        else if ( data_type == NPY_DOUBLE )
+        const int       data_type    = PyArray_TYPE( data_py_array );
+        PyThreadState * thread_state = PyEval_SaveThread();
+        try
         {
-            const double * data_begin   = (const double *) PyArray_DATA( data_py_array );
-            const double * data_end     = data_begin + PyArray_SIZE( data_py_array );
-            uint8_t *      labels_begin = (uint8_t *) PyArray_DATA( labels_py_array );
-            self->m_classifier->classify( data_begin, data_end, labels_begin );
+            if ( data_type == NPY_FLOAT )
+            {
+                const float * data_begin   = (const float *) PyArray_DATA( data_py_array );
+                const float * data_end     = data_begin + PyArray_SIZE( data_py_array );
+                uint8_t *     labels_begin = (uint8_t *) PyArray_DATA( labels_py_array );
+                self->m_classifier->classify( data_begin, data_end, labels_begin );
+            }
+            else if ( data_type == NPY_DOUBLE )
+            {
+                const double * data_begin   = (const double *) PyArray_DATA( data_py_array );
+                const double * data_end     = data_begin + PyArray_SIZE( data_py_array );
+                uint8_t *      labels_begin = (uint8_t *) PyArray_DATA( labels_py_array );
+                self->m_classifier->classify( data_begin, data_end, labels_begin );
+            }
+            else
+            {
+                // This statement should never be reached.
+                assert( false );
+            }
         }
-        else
+        catch ( ... )
         {
-            // This statement should never be reached.
-            assert( false );
+            // Reacquire the GIL before touching the Python error state.
+            PyEval_RestoreThread( thread_state );
+            throw;
         }
+        PyEval_RestoreThread( thread_state );
     }
     catch ( const Exception & exception )
     {
@@ -507,6 +559,106 @@ static PyObject * RandomForestClassifier_classify( RandomForestClassifier_py_obj
     return (PyObject *) labels_py_array;
 }
 
+// Classify a set of data points, returning the per-class vote counts.
+static PyObject * RandomForestClassifier_classify_and_vote( RandomForestClassifier_py_object * self, PyObject * args )
+{
+    // Convert the data array argument to a NumPy array with a supported data
+    // type (float or double), expected memory layout, and number of
+    // dimensions. This may require a copy of the underlying data.
+    PyArrayObject * data_py_array = data_array_from_object( args );
+    if ( data_py_array == NULL )
+    {
+        return NULL;
+    }
+
+    // Extract the number of features from the shape of the data array.
+    const npy_intp number_of_features_py = PyArray_DIM( data_py_array, 1 );
+    assert( number_of_features_py >= 0 );
+    if ( number_of_features_py > UINT_MAX )
+    {
+        PyErr_SetString( PyExc_ValueError, "The input data contains too many features." );
+        Py_DECREF( data_py_array );
+        return NULL;
+    }
+    const unsigned int number_of_features = (unsigned int) number_of_features_py;
+
+    // Check the number of features against the number expected by the classifier.
+    if ( number_of_features != self->m_classifier->getFeatureCount() )
+    {
+        PyErr_SetString( PyExc_ValueError, "The number of features in the input data differs from the number of features expected by the classifier." );
+        Py_DECREF( data_py_array );
+        return NULL;
+    }
+
+    // Create a zero-initialized array to hold the vote counts. The classifier
+    // accumulates its votes directly into this array, so no copy is made.
+    const unsigned int number_of_points  = (unsigned int) PyArray_DIM( data_py_array, 0 );
+    const unsigned int number_of_classes = self->m_classifier->getClassCount();
+    npy_intp           votes_py_array_dims[2] = { (npy_intp) number_of_points, (npy_intp) number_of_classes };
+    PyArrayObject *    votes_py_array         = (PyArrayObject *) PyArray_ZEROS( 2, votes_py_array_dims, NPY_UINT32, false );
+    if ( votes_py_array == NULL )
+    {
+        Py_DECREF( data_py_array );
+        return NULL;
+    }
+
+    // Classify the data. The GIL is released while the classifier runs, so
+    // other Python threads (e.g. I/O, or a second classifier) can proceed.
+    try
+    {
+        // Wrap the NumPy buffer in a writable table window.
+        auto votes_table = Table<uint32_t>::createWindow( (uint32_t *) PyArray_DATA( votes_py_array ), number_of_points, number_of_classes );
+
+        const int       data_type    = PyArray_TYPE( data_py_array );
+        PyThreadState * thread_state = PyEval_SaveThread();
+        try
+        {
+            if ( data_type == NPY_FLOAT )
+            {
+                const float * data_begin = (const float *) PyArray_DATA( data_py_array );
+                const float * data_end   = data_begin + PyArray_SIZE( data_py_array );
+                self->m_classifier->classifyAndVote( data_begin, data_end, votes_table );
+            }
+            else if ( data_type == NPY_DOUBLE )
+            {
+                const double * data_begin = (const double *) PyArray_DATA( data_py_array );
+                const double * data_end   = data_begin + PyArray_SIZE( data_py_array );
+                self->m_classifier->classifyAndVote( data_begin, data_end, votes_table );
+            }
+            else
+            {
+                // This statement should never be reached.
+                assert( false );
+            }
+        }
+        catch ( ... )
+        {
+            // Reacquire the GIL before touching the Python error state.
+            PyEval_RestoreThread( thread_state );
+            throw;
+        }
+        PyEval_RestoreThread( thread_state );
+    }
+    catch ( const Exception & exception )
+    {
+        PyErr_SetString( PyExc_RuntimeError, exception.getMessage().c_str() );
+        Py_DECREF( votes_py_array );
+        Py_DECREF( data_py_array );
+        return NULL;
+    }
+    catch ( ... )
+    {
+        PyErr_SetString( PyExc_RuntimeError, "Internal error." );
+        Py_DECREF( votes_py_array );
+        Py_DECREF( data_py_array );
+        return NULL;
+    }
+
+    // Clean up.
+    Py_DECREF( data_py_array );
+    return (PyObject *) votes_py_array;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Module-level methods.
 ////////////////////////////////////////////////////////////////////////////////
@@ -585,39 +737,51 @@ static PyObject * balsa_train( PyObject * self, PyObject * args, PyObject * kwar
     }
     const unsigned int number_of_features = (unsigned int) number_of_features_py;
 
-    // Train the random forest.
+    // Train the random forest. The GIL is released while the trainer runs, so
+    // other Python threads can proceed.
     try
     {
-        const int data_type = PyArray_TYPE( data_py_array );
-        if ( data_type == NPY_FLOAT )
-        {
-            // Instantiate single precision trainer.
-            EnsembleFileOutputStream                            output_stream( model_filename );
-            RandomForestTrainer<const float *, const uint8_t *> trainer( output_stream, features_to_consider, max_depth, min_purity, tree_count, concurrent_trainers );
-
-            // Train.
-            const float *   data_begin   = (const float *) PyArray_DATA( data_py_array );
-            const float *   data_end     = data_begin + PyArray_SIZE( data_py_array );
-            const uint8_t * labels_begin = (const uint8_t *) PyArray_DATA( labels_py_array );
-            trainer.train( data_begin, data_end, number_of_features, labels_begin );
-        }
-        else if ( data_type == NPY_DOUBLE )
+        const int       data_type    = PyArray_TYPE( data_py_array );
+        PyThreadState * thread_state = PyEval_SaveThread();
+        try
         {
-            // Instantiate double precision trainer.
-            EnsembleFileOutputStream                             output_stream( model_filename );
-            RandomForestTrainer<const double *, const uint8_t *> trainer( output_stream, features_to_consider, max_depth, min_purity, tree_count, concurrent_trainers );
-
-            // Train.
-            const double *  data_begin   = (const double *) PyArray_DATA( data_py_array );
-            const double *  data_end     = data_begin + PyArray_SIZE( data_py_array );
-            const uint8_t * labels_begin = (const uint8_t *) PyArray_DATA( labels_py_array );
-            trainer.train( data_begin, data_end, number_of_features, labels_begin );
+            if ( data_type == NPY_FLOAT )
+            {
+                // Instantiate single precision trainer.
+                EnsembleFileOutputStream                            output_stream( model_filename );
+                RandomForestTrainer<const float *, const uint8_t *> trainer( output_stream, features_to_consider, max_depth, min_purity, tree_count, concurrent_trainers );
+
+                // Train.
+                const float *   data_begin   = (const float *) PyArray_DATA( data_py_array );
+                const float *   data_end     = data_begin + PyArray_SIZE( data_py_array );
+                const uint8_t * labels_begin = (const uint8_t *) PyArray_DATA( labels_py_array );
+                trainer.train( data_begin, data_end, number_of_features, labels_begin );
+            }
+            else if ( data_type == NPY_DOUBLE )
+            {
+                // Instantiate double precision trainer.
+                EnsembleFileOutputStream                             output_stream( model_filename );
+                RandomForestTrainer<const double *, const uint8_t *> trainer( output_stream, features_to_consider, max_depth, min_purity, tree_count, concurrent_trainers );
+
+                // Train.
+                const double *  data_begin   = (const double *) PyArray_DATA( data_py_array );
+                const double *  data_end     = data_begin + PyArray_SIZE( data_py_array );
+                const uint8_t * labels_begin = (const uint8_t *) PyArray_DATA( labels_py_array );
+                trainer.train( data_begin, data_end, number_of_features, labels_begin );
+            }
+            else
+            {
+                // This statement should never be reached.
+                assert( false );
+            }
         }
-        else
+        catch ( ... )
         {
-            // This statement should never be reached.
-            assert( false );
+            // Reacquire the GIL before touching the Python error state.
+            PyEval_RestoreThread( thread_state );
+            throw;
         }
+        PyEval_RestoreThread( thread_state );
     }
     catch ( const Exception & exception )
     {